@@ -0,0 +1,101 @@
+// Time of generate_tangents on a large mesh: a wavy grid of indexed positions, normals and texture coordinates, the
+// texture mirrored on one half as exporters lay out symmetric models, so that vertices split along the seam. Prints
+// the best of a few runs on one thread and on every thread, in millions of corners per second. Run with meson test
+// --benchmark, or directly with the count of corners in millions.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include <mesh.hxx>
+#include <parallel.hxx>
+#include <tangents.hxx>
+
+namespace {
+
+constexpr std::size_t DEFAULT_MILLIONS_OF_CORNERS = 10;
+constexpr std::size_t RUNS_COUNT = 3;
+constexpr float WAVE_HEIGHT = 0.05f;
+constexpr float COLUMN_WAVE_FREQUENCY = 40.0f;
+constexpr float ROW_WAVE_FREQUENCY = 7.0f;
+
+// A grid of two triangles per cell with at least the given count of corners, every grid vertex having one position,
+// normal and texture coordinates shared by the corners of its cells.
+Mesh make_mesh(const std::size_t corners_count) {
+    auto cells_per_side = static_cast<std::uint32_t>(std::sqrt(static_cast<double>(corners_count) / 6.0));
+    while(std::size_t{cells_per_side} * cells_per_side * 6 < corners_count) {
+        ++cells_per_side;
+    }
+    const auto vertices_per_side = cells_per_side + 1;
+    Mesh mesh{};
+    mesh.present_attributes = POSITIONS_PRESENT | TEX_COORDS_PRESENT | NORMALS_PRESENT;
+    for(std::uint32_t row{}; row < vertices_per_side; ++row) {
+        for(std::uint32_t column{}; column < vertices_per_side; ++column) {
+            const auto u = static_cast<float>(column) / static_cast<float>(cells_per_side);
+            const auto v = static_cast<float>(row) / static_cast<float>(cells_per_side);
+            const auto column_wave = COLUMN_WAVE_FREQUENCY * u;
+            const auto row_wave = ROW_WAVE_FREQUENCY * v;
+            const auto slope_u = WAVE_HEIGHT * COLUMN_WAVE_FREQUENCY * std::cos(column_wave) * std::cos(row_wave);
+            const auto slope_v = -WAVE_HEIGHT * ROW_WAVE_FREQUENCY * std::sin(column_wave) * std::sin(row_wave);
+            const auto length = std::sqrt(slope_u * slope_u + slope_v * slope_v + 1.0f);
+            mesh.positions.push_back({u, v, WAVE_HEIGHT * std::sin(column_wave) * std::cos(row_wave)});
+            mesh.normals.push_back({-slope_u / length, -slope_v / length, 1.0f / length});
+            mesh.tex_coords.push_back({u < 0.5f ? u : 1.0f - u, v});
+        }
+    }
+    for(std::uint32_t row{}; row < cells_per_side; ++row) {
+        for(std::uint32_t column{}; column < cells_per_side; ++column) {
+            const auto corner = row * vertices_per_side + column;
+            for(const auto vertex : {corner, corner + 1, corner + vertices_per_side + 1, corner,
+                    corner + vertices_per_side + 1, corner + vertices_per_side}) {
+                mesh.position_indices.push_back(vertex);
+            }
+        }
+    }
+    mesh.normal_indices = mesh.position_indices;
+    mesh.tex_coords_indices = mesh.position_indices;
+    return mesh;
+}
+
+} // namespace
+
+int main(const int argc, const char* argv[]) {
+    auto millions_of_corners = DEFAULT_MILLIONS_OF_CORNERS;
+    if(argc > 1) {
+        const std::string_view value{argv[1]};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), millions_of_corners);
+        if(error != std::errc{} || end != value.data() + value.size() || millions_of_corners == 0) {
+            std::printf("Usage: generate_tangents_benchmark [millions of corners]\n");
+            return 1;
+        }
+    }
+    const auto source_mesh = make_mesh(millions_of_corners * 1000000);
+    const auto corners_count = source_mesh.position_indices.size();
+    std::printf("Mesh: %zu corners, %zu vertices.\n", corners_count, source_mesh.positions.size());
+    std::vector<std::size_t> threads_counts{1};
+    if(default_threads_count() > 1) {
+        threads_counts.push_back(default_threads_count());
+    }
+    for(const auto threads_count : threads_counts) {
+        auto best = std::chrono::steady_clock::duration::max();
+        for(std::size_t run{}; run < RUNS_COUNT; ++run) {
+            auto mesh = source_mesh;
+            const auto start = std::chrono::steady_clock::now();
+            if(!generate_tangents(mesh, threads_count)) {
+                std::printf("Failed to generate tangents for the generated mesh.\n");
+                return 1;
+            }
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        std::printf("Threads: %zu, %.1f ms, %.1f M corners/s.\n", threads_count,
+                std::chrono::duration<double, std::milli>(best).count(),
+                static_cast<double>(corners_count) / 1e6 / std::chrono::duration<double>(best).count());
+    }
+    return 0;
+}
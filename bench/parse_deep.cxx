@@ -0,0 +1,81 @@
+// Throughput of tinyxml2 on element-heavy documents, where the time goes to XMLNode::ParseDeep walking the tree rather
+// than to text: deep documents of long element chains, wide documents of short chains and flat documents of siblings
+// only. Prints the best of a few runs of Parse for every shape, in MB/s of document text. Run with meson test
+// --benchmark, or directly with the size of the documents in megabytes.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <tinyxml2.hxx>
+
+namespace {
+
+constexpr std::size_t DEFAULT_DOCUMENT_MEGABYTES = 8;
+constexpr std::size_t RUNS_COUNT = 5;
+
+struct Shape {
+    const char* name;
+    // Elements nested in every chain, within the default TINYXML2_MAX_ELEMENT_DEPTH.
+    std::size_t depth;
+};
+
+constexpr Shape SHAPES[] = {{"deep", 400}, {"wide", 10}, {"flat", 1}};
+
+// Chains of depth nested elements with an attribute each and a short text at the bottom, side by side under the
+// root until the document reaches its size.
+std::string make_document(const std::size_t megabytes, const std::size_t depth) {
+    std::string document{"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<root>\n"};
+    for(std::size_t chain{}; document.size() < megabytes << 20; ++chain) {
+        const auto id = std::to_string(chain);
+        for(std::size_t level{}; level < depth; ++level) {
+            document += "<node id=\"n" + id + "-" + std::to_string(level) + "\">";
+        }
+        document += "text " + id;
+        for(std::size_t level{}; level < depth; ++level) {
+            document += "</node>";
+        }
+        document += '\n';
+    }
+    document += "</root>\n";
+    return document;
+}
+
+double megabytes_per_second(const std::size_t bytes, const std::chrono::steady_clock::duration duration) {
+    return static_cast<double>(bytes) / (1 << 20) / std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+int main(const int argc, const char* argv[]) {
+    auto megabytes = DEFAULT_DOCUMENT_MEGABYTES;
+    if(argc > 1) {
+        const std::string_view value{argv[1]};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), megabytes);
+        if(error != std::errc{} || end != value.data() + value.size() || megabytes == 0) {
+            std::printf("Usage: parse_deep_benchmark [megabytes]\n");
+            return 1;
+        }
+    }
+    for(const auto& shape : SHAPES) {
+        const auto document_text = make_document(megabytes, shape.depth);
+        auto best_parse = std::chrono::steady_clock::duration::max();
+        for(std::size_t run{}; run < RUNS_COUNT; ++run) {
+            tinyxml2::XMLDocument document{};
+            const auto parse_start = std::chrono::steady_clock::now();
+            if(document.Parse(document_text.data(), document_text.size()) != tinyxml2::XML_SUCCESS) {
+                std::printf("Failed to parse the generated %s document.\n", shape.name);
+                return 1;
+            }
+            best_parse = std::min(best_parse, std::chrono::steady_clock::now() - parse_start);
+        }
+        std::printf("%s, depth %zu: %zu bytes, parsed in %.1f ms, %.0f MB/s.\n", shape.name, shape.depth,
+                document_text.size(), std::chrono::duration<double, std::milli>(best_parse).count(),
+                megabytes_per_second(document_text.size(), best_parse));
+    }
+    return 0;
+}
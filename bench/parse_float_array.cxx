@@ -0,0 +1,116 @@
+// Throughput of tinyxml2 on text-heavy documents: float_array payloads like those of large COLLADA scenes, which is
+// where the block scanners of ParseText, GetStr and CollapseWhitespace spend their time. Prints the best of a few runs
+// of Parse and of reading the text of every element, in MB/s of document text, for the default mode, which tracks
+// lines and reads with GetText, and for the lean mode dae2obm parses in, which does not and reads with GetTextSpan.
+// Run with meson test --benchmark, or directly with the size of the document in megabytes.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <tinyxml2.hxx>
+
+namespace {
+
+constexpr std::size_t DEFAULT_DOCUMENT_MEGABYTES = 32;
+constexpr std::size_t RUNS_COUNT = 5;
+constexpr std::size_t FLOATS_PER_ARRAY = 30000;
+constexpr std::size_t FLOATS_PER_LINE = 9;
+
+struct Mode {
+    const char* name;
+    bool track_lines;
+    // Reads texts with GetTextSpan rather than GetText.
+    bool text_spans;
+};
+
+constexpr Mode MODES[] = {{"default", true, false}, {"lean", false, true}};
+
+// Geometries with a float_array of positions each, formatted the way exporters write them: several values per line,
+// indented, with the odd run of extra spaces.
+std::string make_document(const std::size_t megabytes) {
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> values{-1000.0f, 1000.0f};
+    std::string document{"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<COLLADA>\n  <library_geometries>\n"};
+    char number[32];
+    for(std::size_t geometry{}; document.size() < megabytes << 20; ++geometry) {
+        const auto id = "mesh" + std::to_string(geometry);
+        document += "    <geometry id=\"" + id + "\"><mesh><source id=\"" + id + "-positions\">\n"
+                "      <float_array id=\"" + id + "-array\" count=\"" + std::to_string(FLOATS_PER_ARRAY) + "\">";
+        for(std::size_t i{}; i < FLOATS_PER_ARRAY; ++i) {
+            document += i % FLOATS_PER_LINE == 0 ? "\n        " : i % 7 == 0 ? "   " : " ";
+            const auto end = std::to_chars(number, number + sizeof(number), values(random)).ptr;
+            document.append(number, end);
+        }
+        document += "\n      </float_array>\n    </source></mesh></geometry>\n";
+    }
+    document += "  </library_geometries>\n</COLLADA>\n";
+    return document;
+}
+
+double megabytes_per_second(const std::size_t bytes, const std::chrono::steady_clock::duration duration) {
+    return static_cast<double>(bytes) / (1 << 20) / std::chrono::duration<double>(duration).count();
+}
+
+std::size_t read_all_texts(const tinyxml2::XMLElement* element, const bool text_spans) {
+    std::size_t size{};
+    for(; element != nullptr; element = element->NextSiblingElement()) {
+        const char* text{};
+        std::size_t length{};
+        if(text_spans) {
+            if(element->GetTextSpan(&text, &length)) {
+                size += length;
+            }
+        } else if(text = element->GetText(); text != nullptr) {
+            size += std::string_view{text}.size();
+        }
+        size += read_all_texts(element->FirstChildElement(), text_spans);
+    }
+    return size;
+}
+
+} // namespace
+
+int main(const int argc, const char* argv[]) {
+    auto megabytes = DEFAULT_DOCUMENT_MEGABYTES;
+    if(argc > 1) {
+        const std::string_view value{argv[1]};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), megabytes);
+        if(error != std::errc{} || end != value.data() + value.size() || megabytes == 0) {
+            std::printf("Usage: parse_float_array_benchmark [megabytes]\n");
+            return 1;
+        }
+    }
+    const auto document_text = make_document(megabytes);
+    std::printf("Document: %zu bytes.\n", document_text.size());
+    for(const auto& mode : MODES) {
+        auto best_parse = std::chrono::steady_clock::duration::max();
+        auto best_read_text = std::chrono::steady_clock::duration::max();
+        std::size_t text_size{};
+        for(std::size_t run{}; run < RUNS_COUNT; ++run) {
+            tinyxml2::XMLDocument document{true, tinyxml2::PRESERVE_WHITESPACE, mode.track_lines};
+            const auto parse_start = std::chrono::steady_clock::now();
+            if(document.Parse(document_text.data(), document_text.size()) != tinyxml2::XML_SUCCESS) {
+                std::printf("Failed to parse the generated document.\n");
+                return 1;
+            }
+            const auto read_text_start = std::chrono::steady_clock::now();
+            text_size = read_all_texts(document.RootElement(), mode.text_spans);
+            const auto read_text_end = std::chrono::steady_clock::now();
+            best_parse = std::min(best_parse, read_text_start - parse_start);
+            best_read_text = std::min(best_read_text, read_text_end - read_text_start);
+        }
+        std::printf("%s: Parse %.1f ms, %.0f MB/s; %s over %zu bytes of text %.1f ms, %.0f MB/s; %.1f ms in all.\n",
+                mode.name, std::chrono::duration<double, std::milli>(best_parse).count(),
+                megabytes_per_second(document_text.size(), best_parse), mode.text_spans ? "GetTextSpan" : "GetText",
+                text_size, std::chrono::duration<double, std::milli>(best_read_text).count(),
+                megabytes_per_second(text_size, best_read_text),
+                std::chrono::duration<double, std::milli>(best_parse + best_read_text).count());
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <batch_io.hxx>
+#include <cache.hxx>
+#include <dae2obm.hxx>
+
+struct BatchJob {
+    std::string input_file_name;
+    std::string output_file_name;
+    std::uintmax_t input_size{};
+    // Another job writes the same output file, so neither is converted.
+    bool duplicate_output{};
+};
+
+// Totals of one or more batch runs. Summaries are written as "key value" lines, so that the summaries of all shards
+// of a batch can be merged into the summary of the whole batch.
+struct BatchSummary {
+    std::size_t shards_count{1};
+    std::size_t files_count{};
+    std::size_t converted_count{};
+    std::size_t failed_count{};
+    std::size_t stolen_count{};
+    std::uintmax_t converted_bytes{};
+    std::size_t cache_hits{};
+    std::size_t cache_misses{};
+    // Wall-clock time; shards run side by side, so merging keeps the longest one.
+    double seconds{};
+    // Error code and input file name of every failed file.
+    std::vector<std::pair<int, std::string>> failures{};
+};
+
+// Mirrors the input's path relative to the source directory into the output directory, with the .obm extension.
+std::string output_file_name_for(const std::filesystem::path& input_path, const std::filesystem::path& source_directory,
+        const std::filesystem::path& output_directory);
+// Lists the files to convert: every .dae, .dae.gz and .zae file under a directory (keeping the relative layout in the
+// output directory), or every non-empty line of a manifest file (keeping the layout relative to the directory all of
+// its entries are in). Jobs writing the same output file, such as a.dae next to a.dae.gz, are marked as duplicates.
+bool collect_batch_jobs(const std::string_view source, const std::string_view output_directory,
+        std::vector<BatchJob>& jobs);
+// Keeps the jobs of shard shard_index of shards_count. Jobs are ordered by decreasing size (then by name) and every one
+// goes to the shard with the fewest bytes so far, so every node computes the same balanced assignment from the same
+// file list, whatever order it was listed in.
+void select_shard(std::vector<BatchJob>& jobs, const std::size_t shard_index, const std::size_t shards_count);
+// Converts the jobs largest first on threads_count workers with one conversion thread each. Every worker owns a
+// queue and steals from the others once it runs dry. A failed file does not stop the others; the result is 0 when all
+// of them converted, or else the error code of the first failed job. The cache is optional, and so is the I/O thread,
+// which then reads the sources ahead and writes the outputs while the workers convert; it is not used with a cache or
+// restat, whose conversions read and write the files themselves.
+int convert_batch(const std::vector<BatchJob>& jobs, const ConversionOptions& options, ConversionCache* cache,
+        BatchIo* io, BatchSummary& summary);
+
+void print_batch_summary(const BatchSummary& summary);
+bool write_batch_summary(const std::string_view file_name, const BatchSummary& summary);
+bool read_batch_summary(const std::string_view file_name, BatchSummary& summary);
+void merge_batch_summaries(const BatchSummary& summary, BatchSummary& merged_summary);
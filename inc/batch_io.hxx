@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// Bytes a read or write request transfers at most, the size of every chunk buffer.
+constexpr std::size_t IO_CHUNK_BYTES = 1024 * 1024;
+// Alignment of the chunk buffers, and of the offsets and lengths of O_DIRECT transfers: a multiple of the logical
+// block size of the usual devices.
+constexpr std::size_t IO_ALIGNMENT = 4096;
+constexpr std::size_t DEFAULT_IO_QUEUE_DEPTH = 32;
+
+enum class IoBackend {
+    // Requests are queued on an io_uring ring, up to the queue depth at once.
+    io_uring,
+    // Requests run one after the other with pread and pwrite, where io_uring is not available.
+    pread,
+};
+
+struct BatchIoOptions {
+    IoBackend backend{IoBackend::io_uring};
+    // Requests in flight at most, each on a chunk buffer of its own.
+    std::size_t queue_depth{DEFAULT_IO_QUEUE_DEPTH};
+    // Registers the chunk buffers with the ring, so that the kernel maps them once rather than for every request.
+    bool registered_buffers{true};
+    // Opens the files with O_DIRECT, bypassing the page cache. Files that refuse it are read and written cached.
+    bool direct{};
+};
+
+struct BatchIoStats {
+    // The backend in use, io_uring falling back to pread where the ring cannot be set up.
+    IoBackend backend{};
+    bool registered_buffers{};
+    std::size_t files_count{};
+    std::size_t direct_files_count{};
+    std::size_t requests_count{};
+    // Requests in flight summed over the submissions, for the average queue depth.
+    std::uintmax_t depth_sum{};
+    std::size_t max_depth{};
+    std::uintmax_t bytes_read{};
+    std::uintmax_t bytes_written{};
+    // Time with files being read or written, which the bandwidth is measured over.
+    double busy_seconds{};
+};
+
+// A file read whole into memory.
+struct IoBuffer {
+    std::unique_ptr<char[]> bytes{};
+    std::size_t size{};
+};
+
+struct BatchIoState;
+
+// Reads and writes whole files for the batch workers on a thread of its own. Files are split into chunk requests, up
+// to queue_depth of which are in flight across all the files, and go through the chunk buffers (copied from and to
+// the buffers of the workers), which keeps the transfers aligned for O_DIRECT. Workers start the reads of their next
+// files ahead and find their bytes in memory, and writes complete while the workers convert the next files.
+struct BatchIo {
+    explicit BatchIo(const BatchIoOptions& options);
+    BatchIo(const BatchIo&) = delete;
+    BatchIo& operator=(const BatchIo&) = delete;
+    // Waits for the pending requests.
+    ~BatchIo();
+
+    // Starts reading the file and returns the ticket that take collects it with.
+    std::size_t read(const std::string_view file_name);
+    // Waits for the read of the ticket, which can be taken once. Returns false when the file could not be read.
+    bool take(const std::size_t ticket, IoBuffer& buffer);
+    // Writes the bytes to the file under a temporary name, renamed once they are all written; existing files that are
+    // not regular, such as devices, are written in place like convert does. done is called on the I/O thread with
+    // whether the file was written, and must not call back into BatchIo.
+    void write(const std::string_view file_name, std::pmr::string&& bytes, std::function<void(bool written)> done);
+    // Waits for every pending request.
+    void drain();
+    BatchIoStats stats() const;
+
+    std::unique_ptr<BatchIoState> state;
+};
+
+void print_batch_io_stats(const BatchIoStats& stats);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Spins this many times, yielding, before a waiting thread starts sleeping.
+constexpr unsigned QUEUE_SPINS_BEFORE_SLEEP = 64;
+constexpr std::chrono::microseconds QUEUE_MAX_SLEEP{1000};
+
+// A lock-free ring of at most capacity items between one producer thread and one consumer thread. push waits while
+// the ring is full, which holds the producer back to the pace of the consumer and caps the items in flight. Waiting
+// threads yield, then sleep for growing times, so that a long wait leaves the core to the other threads.
+template<typename Item>
+struct BoundedQueue {
+    explicit BoundedQueue(const std::size_t capacity)
+            : slots(std::max<std::size_t>(capacity, 1) + 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Moves the item in, once there is room. Returns false, dropping the item, once the queue is cancelled.
+    bool push(Item&& item) {
+        const auto tail = next_push.load(std::memory_order_relaxed);
+        const auto next = (tail + 1) % slots.size();
+        for(unsigned waits{}; next == next_pop.load(std::memory_order_acquire); ++waits) {
+            if(cancelled.load(std::memory_order_acquire)) {
+                return false;
+            }
+            wait(waits);
+        }
+        slots[tail] = std::move(item);
+        next_push.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Moves the oldest item out, once there is one. Returns false once the queue is closed and empty, or cancelled.
+    bool pop(Item& item) {
+        const auto head = next_pop.load(std::memory_order_relaxed);
+        for(unsigned waits{}; head == next_push.load(std::memory_order_acquire); ++waits) {
+            if(cancelled.load(std::memory_order_acquire)) {
+                return false;
+            }
+            // Items pushed before closing are visible once the close is.
+            if(closed.load(std::memory_order_acquire) && head == next_push.load(std::memory_order_acquire)) {
+                return false;
+            }
+            wait(waits);
+        }
+        item = std::move(slots[head]);
+        next_pop.store((head + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+    // Called by the producer after its last push.
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    // Stops both sides, from either of them: pending and later calls return false.
+    void cancel() {
+        cancelled.store(true, std::memory_order_release);
+    }
+
+    static void wait(const unsigned waits) {
+        if(waits < QUEUE_SPINS_BEFORE_SLEEP) {
+            std::this_thread::yield();
+        } else {
+            const auto shift = std::min(waits - QUEUE_SPINS_BEFORE_SLEEP, 10u);
+            std::this_thread::sleep_for(std::min(std::chrono::microseconds{1 << shift}, QUEUE_MAX_SLEEP));
+        }
+    }
+
+    // One slot stays empty, telling a full ring from an empty one.
+    std::vector<Item> slots;
+    // On lines of their own, as each is written by one side and polled by the other.
+    alignas(64) std::atomic<std::size_t> next_push{};
+    alignas(64) std::atomic<std::size_t> next_pop{};
+    std::atomic<bool> closed{};
+    std::atomic<bool> cancelled{};
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <mesh.hxx>
+
+// Axis-aligned box and bounding sphere of positions. The sphere is the smaller of the sphere centered in the box and a
+// Ritter sphere grown over the positions; empty inputs yield zeroed bounds.
+Bounds compute_bounds(const std::vector<Vector3>& positions, const std::size_t threads_count);
+
+void compute_aabb(const Vector3* positions, const std::size_t count, Vector3& aabb_min, Vector3& aabb_max);
+// The same bounds, bit for bit, for positions that are not all in memory: read(first, count, positions) copies count
+// positions from first on into positions, a chunk at a time, and returns false when it cannot, which this returns.
+bool compute_bounds_streamed(const std::size_t count, const std::size_t threads_count,
+        const std::function<bool(std::size_t first, std::size_t count, Vector3* positions)>& read, Bounds& bounds);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mesh.hxx>
+
+constexpr std::size_t BVH_BINS_COUNT = 16;
+constexpr std::uint32_t BVH_MAX_LEAF_TRIANGLES = 4;
+
+// Builds a bounding volume hierarchy over the triangles of the mesh with a binned surface area heuristic. Subtrees
+// near the root are built in parallel, the resulting layout does not depend on the number of threads.
+void build_bvh(Mesh& mesh, const std::size_t threads_count);
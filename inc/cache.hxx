@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <dae2obm.hxx>
+#include <xxh64.hxx>
+
+// Part of every cache key; bump it whenever the converter output changes for the same input and options.
+constexpr std::uint64_t CACHE_FORMAT_VERSION = 2;
+
+// A directory of previous outputs named after the XXH64 of their input, seeded with the hash of the options that
+// change the output. Entries are evicted least recently used first, by the modification time of a stamp file next to
+// every entry, which hits touch: outputs served from the cache are hard links to the entries where possible, sharing
+// their times, so they have to be replaced rather than modified and the entries themselves are never touched.
+struct ConversionCache {
+    std::filesystem::path directory{};
+    // Total size of the entries kept by evict_cache_entries, 0 for no limit.
+    std::uintmax_t max_size{};
+    std::atomic<std::size_t> hits{};
+    std::atomic<std::size_t> misses{};
+    std::atomic<std::size_t> geometry_hits{};
+    std::atomic<std::size_t> geometry_misses{};
+    std::size_t evicted_count{};
+    std::uintmax_t evicted_bytes{};
+};
+
+bool open_conversion_cache(ConversionCache& cache);
+std::uint64_t hash_options(const ConversionOptions& options);
+// Reads the input while hashing it, then serves the output from the cache or converts the input and adds the output
+// to the cache. Inputs with several geometries are converted geometry by geometry on a miss, every geometry whose
+// text references nothing outside of it being cached as a mesh section on its own. Returns what convert would.
+int convert_cached(ConversionCache& cache, tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options);
+// Compressed files are decompressed first: their contents and key are those of their text.
+bool read_and_hash_file(const std::string_view file_name, std::string& contents, Xxh64& hash);
+void evict_cache_entries(ConversionCache& cache);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <batch_io.hxx>
+#include <dae2obm.hxx>
+
+struct ConversionCache;
+
+struct CommandLine {
+    ConversionOptions options{};
+    // Source and destination files, with batch the manifest (or directory) and the output directory, with watch the
+    // watched and the output directories, or when merging summaries the merged summary followed by the summaries to
+    // merge.
+    std::vector<std::string_view> file_names{};
+    bool batch{};
+    bool watch{};
+    std::size_t debounce_milliseconds{50};
+    std::size_t shard_index{};
+    std::size_t shards_count{1};
+    std::string_view summary_file_name{};
+    // Reads and writes the files of the batch on an I/O thread, see BatchIo.
+    bool async_io{};
+    BatchIoOptions io_options{};
+    bool merge_summaries{};
+    std::string_view cache_directory{};
+    std::size_t cache_size_megabytes{};
+    std::string_view depfile_name{};
+    std::string_view serve_socket{};
+    // Socket of the server that converts on behalf of this command line.
+    std::string_view client_socket{};
+    // Asks the server for its latency percentiles instead of converting.
+    bool stats{};
+};
+
+bool parse_arguments(const int argc, const char* argv[], CommandLine& command_line);
+// Whether the source or the destination is STANDARD_STREAM_FILE_NAME.
+bool uses_standard_streams(const CommandLine& command_line);
+// Converts the source of a single conversion command line to its destination, through the cache if any, then writes
+// the depfile if requested. Returns what convert would, or 7 when the depfile cannot be written.
+int convert_command_line(const CommandLine& command_line, tinyxml2::XMLDocument& collada_file, ConversionCache* cache);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <tinyxml2.hxx>
+
+// How a COLLADA source file is stored, told by its first bytes rather than by its name.
+enum class SourceCompression {
+    none,
+    // A gzip stream of the document, such as a .dae.gz file. Concatenated members are read one after the other.
+    gzip,
+    // A .zae zip archive, whose document is the one named by its manifest.xml, or else its first .dae file.
+    zae,
+};
+
+// Returns none for files that cannot be opened, which then fail to load as plain documents.
+SourceCompression detect_compression(const std::string_view file_name);
+// The same, told from the first bytes of a file already read into memory.
+SourceCompression compression_of_bytes(const std::string_view leading_bytes);
+// Whether the file is named like a COLLADA source: .dae, .dae.gz or .zae.
+bool is_collada_file_name(const std::filesystem::path& path);
+// The path without the .gz extension of a compressed document, so that replacing its extension names the output.
+std::filesystem::path without_compression_extension(const std::filesystem::path& path);
+
+// Decompresses a compressed source straight into the parse buffer of the document, while the compressed bytes are
+// read ahead on a thread of their own. Returns what tinyxml2::XMLDocument::LoadFile would: a missing document, a
+// truncated or corrupted stream, or an archive without a document fail to read.
+tinyxml2::XMLError load_compressed_file(tinyxml2::XMLDocument& collada_file, const std::string_view file_name,
+        const SourceCompression compression);
+// Decompresses the whole document of a compressed source into text, for the steps that scan the text itself.
+bool read_compressed_file(const std::string_view file_name, const SourceCompression compression, std::string& text);
+// Decompresses the document of a compressed source block by block into consume, which returns false to stop. For
+// documents that do not fit in memory.
+bool stream_compressed_file(const std::string_view file_name, const SourceCompression compression,
+        const std::function<bool(std::string_view block)>& consume);
@@ -1,55 +1,216 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <tinyxml2.hxx>
 
-constexpr std::uint8_t POSITIONS_PRESENT  = 0b00000001;
-constexpr std::uint8_t TEX_COORDS_PRESENT = 0b00000010;
-constexpr std::uint8_t NORMALS_PRESENT    = 0b00000100;
-constexpr std::uint8_t COLORS_PRESENT     = 0b00001000;
+#include <bounds.hxx>
+#include <bvh.hxx>
+#include <mesh.hxx>
+#include <normals.hxx>
+#include <parallel.hxx>
+#include <tangents.hxx>
+#include <triangulate.hxx>
+#include <weld.hxx>
 
-struct Vector2 {
-    float x;
-    float y;
+// Maximum number of interleaved inputs for which a specialized de-interleaving kernel is generated. Wider layouts are
+// still supported, but fall back to the generic kernel with a runtime stride.
+constexpr std::size_t MAX_SPECIALIZED_STRIDE = 5;
+
+// Slots of the per-attribute arrays used while binding sources; attribute N corresponds to present attribute bit N.
+constexpr std::size_t POSITIONS_ATTRIBUTE  = 0;
+constexpr std::size_t TEX_COORDS_ATTRIBUTE = 1;
+constexpr std::size_t NORMALS_ATTRIBUTE    = 2;
+constexpr std::size_t COLORS_ATTRIBUTE     = 3;
+constexpr std::size_t ATTRIBUTES_COUNT     = 4;
+
+// The file name of the standard input as a source, and of the standard output as a destination.
+constexpr std::string_view STANDARD_STREAM_FILE_NAME = "-";
+
+// Documents are parsed lean, without line tracking, as no message reports lines.
+constexpr bool TRACK_LINES = false;
+// Documents allocate their nodes in blocks of this size, on huge pages where the system has them, as scenes have
+// millions of elements. Each of the four node pools of a document holds at least one block.
+constexpr std::size_t POOL_BLOCK_BYTES = 2 * 1024 * 1024;
+// Meshes waiting between two stages of convert_pipelined at most.
+constexpr std::size_t PIPELINE_QUEUE_CAPACITY = 2;
+// Array text a geometry has on average at least for convert_pipelined to run its stages on threads: smaller meshes
+// take less time to load and post-process than to hand over between threads.
+constexpr std::size_t PIPELINE_MIN_GEOMETRY_BYTES = 256 * 1024;
+// Meshes an OBM file holds at most, as the file header counts them in one byte. Scenes with more geometries fail to
+// convert with error 10 rather than writing a count that wrapped around.
+constexpr std::size_t MAX_MESHES_COUNT = 255;
+
+// Maps every id attribute of the document to its element. Keys point into the document, which has to outlive it.
+using IdIndex = std::unordered_map<std::string_view, const tinyxml2::XMLElement*>;
+
+// A source loaded into a mesh attribute array, at [first_value, first_value + values_count).
+struct SourceBinding {
+    const tinyxml2::XMLElement* source_node{};
+    std::uint32_t first_value{};
+    std::uint32_t values_count{};
 };
 
-struct Vector3 {
-    float x;
-    float y;
-    float z;
+using SourceBindings = std::array<std::vector<SourceBinding>, ATTRIBUTES_COUNT>;
+
+struct ConversionOptions {
+    std::size_t threads_count{default_threads_count()};
+    bool build_bvh{};
+    bool generate_normals{};
+    float crease_angle_degrees{DEFAULT_CREASE_ANGLE_DEGREES};
+    bool generate_tangents{};
+    bool weld{};
+    float weld_epsilon{};
+    // Leave outputs whose bytes did not change untouched.
+    bool restat{};
+    // Stream the errors are reported to, or null to report nothing.
+    std::ostream* messages{&std::cerr};
+    // Runs the parallel steps of the conversion instead of threads started by every step, see ExecutorScope.
+    Executor executor{};
+    // Report how busy every stage of convert_pipelined was to the messages stream.
+    bool report_stages{};
+    // Converts out of core within this many bytes, see convert_out_of_core, rather than parsing the whole document.
+    std::size_t max_memory{};
+    // Directory of the spill files of out-of-core conversions, the temporary directory of the system if empty.
+    std::string spill_directory{};
 };
 
-struct Mesh {
-    std::uint8_t present_attributes{};
-    std::vector<Vector3> positions;
-    std::vector<Vector2> tex_coords;
-    std::vector<Vector3> normals;
-    std::vector<Vector3> colors;
-    std::vector<std::uint32_t> position_indices;
-    std::vector<std::uint32_t> tex_coords_indices;
-    std::vector<std::uint32_t> normal_indices;
-    std::vector<std::uint32_t> color_indices;
+template<typename... Parts>
+void report(const ConversionOptions& options, const Parts&... parts) {
+    if(options.messages != nullptr) {
+        (*options.messages << ... << parts);
+    }
+}
+
+// Splits the parses of the document across the threads of the options for the lifetime of the scope: the children of
+// the libraries are parsed in chunks, in parallel, see tinyxml2::XMLDocument::SetParallelParse.
+struct ParallelParseScope final : tinyxml2::XMLTaskRunner {
+    ParallelParseScope(tinyxml2::XMLDocument& collada_file, const ConversionOptions& options);
+    ParallelParseScope(const ParallelParseScope&) = delete;
+    ParallelParseScope& operator=(const ParallelParseScope&) = delete;
+    ~ParallelParseScope() override;
+
+    int Concurrency() const override;
+    void Run(int count, void (*task)(void* context, int index), void* context) override;
+
+    tinyxml2::XMLDocument& collada_file;
+    const ConversionOptions& options;
 };
 
-int convert(const std::string_view input_file_name, const std::string_view output_file_name);
+// Sets up a document constructed with TRACK_LINES for COLLADA files. Workers keep theirs between files, which reuses
+// the memory of its nodes.
+void configure_document(tinyxml2::XMLDocument& collada_file);
+
+// Converts one file and returns 0 on success or the error code of the failed step. The second overload loads into the
+// caller's document, so that a worker converting many files keeps one document. Either file may be
+// STANDARD_STREAM_FILE_NAME.
+int convert(const std::string_view input_file_name, const std::string_view output_file_name,
+        const ConversionOptions& options = {});
+int convert(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options = {});
+// Converts an already parsed document; the input file name is only used in messages.
+int convert_document(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options);
+// Converts a document held in memory, such as a buffer or a mapped file, to the bytes of an OBM file without touching
+// the file system. The bytes replace the contents of obm_bytes, allocated from its memory resource. Returns what
+// convert would.
+int convert_buffer(const std::string_view collada_text, std::pmr::string& obm_bytes,
+        const ConversionOptions& options = {});
+int convert_buffer(tinyxml2::XMLDocument& collada_file, const std::string_view collada_text,
+        std::pmr::string& obm_bytes, const ConversionOptions& options = {});
+// Converts the geometries of a parsed document in three stages: geometry N + 1 is loaded from the document (its arrays
+// tokenized) while geometry N is post-processed and geometry N - 1 serialized and written. With more than one thread,
+// no executor in the options and geometries of PIPELINE_MIN_GEOMETRY_BYTES on average, every stage runs on a thread of
+// its own and meshes are handed over through BoundedQueues of PIPELINE_QUEUE_CAPACITY, so only a few meshes are held
+// at once; otherwise the stages run one geometry after another, as stages blocking on their queues cannot be tasks of
+// an executor that may run them inline. write is called with the file header, then with every serialized section,
+// and stops the conversion by returning false. Returns what load_document would, 10 for more geometries than
+// MAX_MESHES_COUNT, or 7 when write fails.
+int convert_pipelined(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const ConversionOptions& options, const std::function<bool(std::string_view bytes)>& write);
+// Loads and post-processes the meshes of a parsed document.
+int load_document(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const ConversionOptions& options, std::vector<Mesh>& meshes);
+
+IdIndex build_id_index(const tinyxml2::XMLElement* root_node);
+const tinyxml2::XMLElement* resolve_url(const IdIndex& id_index, const char* url);
+
+int load_meshes(tinyxml2::XMLElement* collada_root_node, const IdIndex& id_index, const ConversionOptions& options,
+        std::vector<Mesh>& meshes);
+int load_mesh(tinyxml2::XMLNode* mesh_node, const std::string_view mesh_id, const IdIndex& id_index,
+        const ConversionOptions& options, Mesh& mesh);
+// Tangents are generated after normals, which meshes without get for them; meshes without texture coordinates get no
+// tangents, which is reported as a warning naming the mesh.
+void post_process_mesh(Mesh& mesh, const std::string_view mesh_id, const ConversionOptions& options);
+bool primitive_type_from_name(const std::string_view name, PrimitiveType& type);
+bool load_primitive(const tinyxml2::XMLElement* primitive_node, const PrimitiveType type, const IdIndex& id_index,
+        const ConversionOptions& options, SourceBindings& bindings, Mesh& mesh, Mesh& primitive);
+std::size_t attribute_from_semantic(const std::string_view semantic, const unsigned set);
+bool bind_source(const tinyxml2::XMLElement* source_node, const std::size_t attribute, const IdIndex& id_index,
+        SourceBindings& bindings, Mesh& mesh, SourceBinding& binding);
+bool check_indices_in_range(const std::vector<std::uint32_t>& indices, const std::size_t values_count);
+void gather_indices(const std::vector<std::uint32_t>& corners, std::vector<std::uint32_t>& indices,
+        const std::size_t threads_count);
+void append_primitive(const Mesh& primitive, Mesh& mesh);
+template<typename Vector>
+bool load_vectors_from_source(const tinyxml2::XMLElement* source_node, const IdIndex& id_index,
+        std::vector<Vector>& vectors);
+// The text of the element as a span of the parsed document, without the entity and line break processing of
+// GetText, which numeric arrays never need. Empty when the element has no text.
+std::string_view element_text(const tinyxml2::XMLElement* element);
+bool load_float_array(const std::string_view text, std::vector<float>& values);
+bool load_uint32_array(const std::string_view text, std::vector<std::uint32_t>& values);
+void deinterleave_indices(const std::vector<std::uint32_t>& values, const std::size_t stride, const std::size_t offset,
+        std::vector<std::uint32_t>& indices);
 
-std::vector<Mesh> load_meshes(tinyxml2::XMLElement* collada_root_node);
-Mesh load_mesh(tinyxml2::XMLNode* mesh_node, const std::string_view mesh_id);
-bool check_present_attributes_and_load_indices(tinyxml2::XMLElement* indices_node, const std::size_t count,
-        uint8_t& attribs, std::vector<std::uint32_t>& position_indices, std::vector<std::uint32_t>& normal_indices,
-        std::vector<std::uint32_t>& tex_coords_indices, std::vector<std::uint32_t>& color_indices);
+// Writers of whole files return false, without writing anything, for more than MAX_MESHES_COUNT meshes.
+// With keep_identical, a file that already holds the same bytes is left untouched, which keeps its modification time
+// for build systems that restat outputs. The standard output is written as a stream, without seeking: every section is
+// written once serialized, the header only needing the count of meshes.
+bool write_meshes(const std::string_view file_name, const std::vector<Mesh>& meshes, const bool keep_identical);
+// Writes the file header followed by mesh sections, as serialized by serialize_mesh. Sections are self-contained, so
+// sections of different conversions can be written together.
+bool write_sections(const std::string_view file_name, const std::vector<std::string>& sections,
+        const bool keep_identical);
+// Reports and returns 10 when a scene has more meshes than an OBM file holds, 0 otherwise.
+int check_meshes_count(const std::size_t meshes_count, const std::string_view input_file_name,
+        const ConversionOptions& options);
+// Whether the file holds exactly the concatenation of the parts.
+bool file_equals(const std::string_view file_name, const std::vector<std::string_view>& parts);
+void serialize_mesh(const Mesh& mesh, std::string& section);
+// Serializes a whole file, the header followed by the mesh sections, into bytes.
+bool serialize_meshes(const std::vector<Mesh>& meshes, std::pmr::string& bytes);
 
-std::vector<Vector2> load_vector_vector2_from_xml_node(const tinyxml2::XMLElement* node);
-std::vector<Vector3> load_vector_vector3_from_xml_node(const tinyxml2::XMLElement* node);
+// Appends the bytes of values whose in-memory layout is their file layout, to a string of any allocator.
+template<typename Bytes, typename Value>
+void append_value(Bytes& bytes, const Value& value) {
+    static_assert(std::is_trivially_copyable_v<Value>);
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
 
-Vector2 load_vector2_from_sstream(std::stringstream& stream);
-Vector3 load_vector3_from_sstream(std::stringstream& stream);
+template<typename Bytes, typename Value>
+void append_values(Bytes& bytes, const std::vector<Value>& values) {
+    static_assert(std::is_trivially_copyable_v<Value>);
+    bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Value));
+}
 
-bool write_meshes(const std::string_view file_name, const std::vector<Mesh>& meshes);
-void write_vector2(std::fstream& file, const Vector2& vec);
-void write_vector3(std::fstream& file, const Vector3& vec);
+// Appends the file header of meshes_count meshes, or nothing and returns false for more than MAX_MESHES_COUNT.
+template<typename Bytes>
+bool append_file_header(Bytes& bytes, const std::size_t meshes_count) {
+    if(meshes_count > MAX_MESHES_COUNT) {
+        return false;
+    }
+    bytes += "OBMF";
+    append_value(bytes, static_cast<std::uint8_t>(meshes_count));
+    return true;
+}
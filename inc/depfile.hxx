@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lists the files a COLLADA document refers to: images (init_from) and other documents (url and source attributes
+// naming a file), resolved against the directory of the document. The text is scanned rather than parsed, so that
+// documents served from the cache do not need parsing.
+std::vector<std::string> find_external_references(const std::string_view text, const std::string_view input_file_name);
+// Writes a Makefile-style depfile making the output depend on the input and on every file it refers to.
+bool write_depfile(const std::string_view depfile_name, const std::string_view output_file_name,
+        const std::string_view input_file_name);
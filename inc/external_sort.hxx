@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <spill_file.hxx>
+
+// Merge passes read every run through a buffer of at least this many bytes, which bounds how many runs a pass merges.
+constexpr std::size_t MERGE_BUFFER_BYTES = 64 * 1024;
+
+// Merges the sorted runs [run_starts[first_run], run_starts[end_run]) of source, in records, into destination.
+template<typename Record, typename Less>
+bool merge_sorted_runs(const SpillFile& source, const std::vector<std::uint64_t>& run_starts,
+        const std::size_t first_run, const std::size_t end_run, SpillFile& destination, const std::size_t memory_bytes,
+        Less less) {
+    const auto runs_count = end_run - first_run;
+    std::vector<SpillReader<Record>> readers{};
+    readers.reserve(runs_count);
+    for(auto run = first_run; run < end_run; ++run) {
+        readers.emplace_back(source, run_starts[run], run_starts[run + 1] - run_starts[run],
+                std::max(memory_bytes / runs_count, sizeof(Record)));
+    }
+    // The smallest record first, ties going to the earlier run.
+    using Head = std::pair<Record, std::size_t>;
+    const auto later = [&](const Head& lhs, const Head& rhs) {
+        return less(rhs.first, lhs.first) || (!less(lhs.first, rhs.first) && rhs.second < lhs.second);
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads{later};
+    for(std::size_t run{}; run < runs_count; ++run) {
+        if(Record record{}; readers[run].read(record)) {
+            heads.emplace(record, run);
+        }
+    }
+    while(!heads.empty()) {
+        auto [record, run] = heads.top();
+        heads.pop();
+        if(!destination.push_back(record)) {
+            return false;
+        }
+        if(readers[run].read(record)) {
+            heads.emplace(record, run);
+        }
+    }
+    return std::none_of(readers.begin(), readers.end(), [](const auto& reader) { return reader.failed; });
+}
+
+// Sorts the records of input into output with less, within about memory_bytes of memory plus two spill buffers:
+// records that fit in memory_bytes are sorted in memory, others as sorted runs of memory_bytes each that are merged,
+// as many at once as their buffers fit in memory_bytes, in as many passes as need be. Ties keep no particular order,
+// so that less should tell every two records apart for a result that does not depend on memory_bytes. Returns false
+// when a spill file fails.
+template<typename Record, typename Less>
+bool external_sort(const SpillFile& input, SpillFile& output, const std::size_t memory_bytes, Less less) {
+    const auto records_count = input.count<Record>();
+    const auto run_size = std::max<std::uint64_t>(memory_bytes / sizeof(Record), 1);
+    output.clear();
+    SpillFile runs{input.directory};
+    std::vector<std::uint64_t> run_starts{0};
+    {
+        std::vector<Record> records(static_cast<std::size_t>(std::min(run_size, records_count)));
+        for(std::uint64_t first{}; first < records_count; first += run_size) {
+            const auto count = static_cast<std::size_t>(std::min(run_size, records_count - first));
+            if(!input.read(first * sizeof(Record), records.data(), count * sizeof(Record))) {
+                return false;
+            }
+            std::sort(records.begin(), records.begin() + static_cast<std::ptrdiff_t>(count), less);
+            // A single run is the output.
+            auto& destination = records_count <= run_size ? output : runs;
+            if(!destination.append(records.data(), count * sizeof(Record))) {
+                return false;
+            }
+            run_starts.push_back(first + count);
+        }
+    }
+    const auto fan_in = std::max<std::size_t>(memory_bytes / MERGE_BUFFER_BYTES, 2);
+    SpillFile merged{input.directory};
+    while(run_starts.size() - 1 > fan_in) {
+        merged.clear();
+        std::vector<std::uint64_t> merged_starts{0};
+        for(std::size_t run{}; run + 1 < run_starts.size(); run += fan_in) {
+            const auto end_run = std::min(run + fan_in, run_starts.size() - 1);
+            if(!merge_sorted_runs<Record>(runs, run_starts, run, end_run, merged, memory_bytes, less)) {
+                return false;
+            }
+            merged_starts.push_back(merged.count<Record>());
+        }
+        std::swap(runs, merged);
+        run_starts = std::move(merged_starts);
+    }
+    if(run_starts.size() > 2) {
+        return merge_sorted_runs<Record>(runs, run_starts, 0, run_starts.size() - 1, output, memory_bytes, less);
+    }
+    return !output.failed;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+constexpr std::uint8_t POSITIONS_PRESENT  = 0b00000001;
+constexpr std::uint8_t TEX_COORDS_PRESENT = 0b00000010;
+constexpr std::uint8_t NORMALS_PRESENT    = 0b00000100;
+constexpr std::uint8_t COLORS_PRESENT     = 0b00001000;
+constexpr std::uint8_t TANGENTS_PRESENT   = 0b00010000;
+
+struct Vector2 {
+    float x;
+    float y;
+};
+
+struct Vector3 {
+    float x;
+    float y;
+    float z;
+};
+
+// Tangent in xyz and bitangent sign in w, the bitangent being w * cross(normal, tangent).
+struct Vector4 {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+struct Bounds {
+    Vector3 aabb_min;
+    Vector3 aabb_max;
+    Vector3 sphere_center;
+    float sphere_radius;
+};
+
+// Interior nodes have a zero count, their left child directly follows them and first is the index of the right child.
+// Leaves reference count triangles starting at first in the triangle indices of the hierarchy.
+struct BvhNode {
+    Vector3 aabb_min;
+    Vector3 aabb_max;
+    std::uint32_t first;
+    std::uint32_t count;
+};
+
+struct Mesh {
+    std::uint8_t present_attributes{};
+    std::vector<Vector3> positions;
+    std::vector<Vector2> tex_coords;
+    std::vector<Vector3> normals;
+    std::vector<Vector3> colors;
+    std::vector<Vector4> tangents;
+    std::vector<std::uint32_t> position_indices;
+    std::vector<std::uint32_t> tex_coords_indices;
+    std::vector<std::uint32_t> normal_indices;
+    std::vector<std::uint32_t> color_indices;
+    std::vector<std::uint32_t> tangent_indices;
+    Bounds bounds{};
+    std::vector<BvhNode> bvh_nodes;
+    std::vector<std::uint32_t> bvh_triangle_indices;
+};
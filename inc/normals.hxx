@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+#include <mesh.hxx>
+
+constexpr float DEFAULT_CREASE_ANGLE_DEGREES = 60.0f;
+
+// Generates vertex normals for a triangulated mesh without normals. Face normals are weighted by triangle area and
+// corner angle; faces meeting at a position at more than the crease angle are not smoothed together. The normals do not
+// depend on threads_count. Sets NORMALS_PRESENT on success.
+bool generate_normals(Mesh& mesh, const float crease_angle_degrees, const std::size_t threads_count);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include <dae2obm.hxx>
+
+// The smallest memory budget of an out-of-core conversion: its input window, spill buffers and positions cache take
+// about half of it.
+constexpr std::size_t MIN_MAX_MEMORY = 16 * 1024 * 1024;
+
+// Converts one file like convert, within options.max_memory bytes of memory however large the document is. The source
+// is scanned through a window mapped over it rather than parsed into a tree, and the arrays of every mesh spill to
+// temporary files of options.spill_directory. Meshes whose post-processing fits in the rest of the budget are then
+// post-processed in memory; larger ones are welded with external sorts and their bounds computed in passes over their
+// positions, and fail with code 9 when they need normals, tangents, a hierarchy or an epsilon weld, which only run in
+// memory. Compressed sources and the standard input are first decompressed or copied to a spill file.
+//
+// Ids are resolved among the sources, vertices and arrays of the mesh that uses them, and <input> elements of a
+// primitive have to come before its first <p>. Returns what convert would, or 9 when the budget cannot be kept.
+int convert_out_of_core(const std::string_view input_file_name, const std::string_view output_file_name,
+        const ConversionOptions& options);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+inline std::size_t default_threads_count() {
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+// Runs task(0) to task(tasks_count - 1), possibly concurrently, and returns once all of them are done. Tasks may call
+// the executor again, so it must not wait on a pool that only the blocked tasks could drain (running nested tasks
+// inline is enough).
+using Executor = std::function<void(const std::size_t tasks_count, const std::function<void(std::size_t)>& task)>;
+
+// The executor parallel_for runs on, per thread. Null starts a thread per range.
+inline const Executor*& current_executor() {
+    thread_local const Executor* executor{};
+    return executor;
+}
+
+// Makes parallel_for run on the executor on this thread, and on the threads of the executor running its tasks, for the
+// lifetime of the scope. An empty executor keeps starting threads.
+struct ExecutorScope {
+    explicit ExecutorScope(const Executor& executor)
+            : previous_executor{current_executor()} {
+        current_executor() = executor ? &executor : nullptr;
+    }
+
+    ExecutorScope(const ExecutorScope&) = delete;
+    ExecutorScope& operator=(const ExecutorScope&) = delete;
+
+    ~ExecutorScope() {
+        current_executor() = previous_executor;
+    }
+
+    const Executor* previous_executor;
+};
+
+// Splits [0, count) into at most threads_count contiguous ranges of at least grain items and calls
+// function(begin, end) for every range, each on its own thread or as a task of the current executor. Without an
+// executor, the calling thread processes the first range.
+template<typename Function>
+void parallel_for(const std::size_t threads_count, const std::size_t count, const std::size_t grain,
+        Function&& function) {
+    const auto ranges_count = std::min(std::max<std::size_t>(threads_count, 1),
+            (count + std::max<std::size_t>(grain, 1) - 1) / std::max<std::size_t>(grain, 1));
+    if(ranges_count <= 1) {
+        if(count != 0) {
+            function(std::size_t{}, count);
+        }
+        return;
+    }
+    const auto range_size = (count + ranges_count - 1) / ranges_count;
+    if(const auto executor = current_executor(); executor != nullptr) {
+        (*executor)(ranges_count, [&function, executor, range_size, count](const std::size_t range) {
+            const ExecutorScope scope{*executor};
+            const auto begin = std::min(range * range_size, count);
+            function(begin, std::min(begin + range_size, count));
+        });
+        return;
+    }
+    std::vector<std::thread> threads{};
+    threads.reserve(ranges_count - 1);
+    for(std::size_t range{1}; range < ranges_count; ++range) {
+        const auto begin = std::min(range * range_size, count);
+        const auto end = std::min(begin + range_size, count);
+        threads.emplace_back([&function, begin, end] { function(begin, end); });
+    }
+    function(std::size_t{}, std::min(range_size, count));
+    for(auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Writes the exclusive prefix sum of values into sums (which gets values.size() + 1 elements, the last one being the
+// total) using a two-pass blocked scan.
+template<typename Value, typename Sum>
+void parallel_exclusive_scan(const std::size_t threads_count, const std::vector<Value>& values, std::vector<Sum>& sums,
+        const std::size_t grain = 1 << 16) {
+    sums.resize(values.size() + 1);
+    const auto blocks_count = std::max<std::size_t>(std::min(threads_count, values.size() / grain), 1);
+    const auto block_size = (values.size() + blocks_count - 1) / blocks_count;
+    std::vector<Sum> block_sums(blocks_count + 1);
+    parallel_for(blocks_count, blocks_count, 1, [&](const std::size_t first_block, const std::size_t last_block) {
+        for(auto block = first_block; block < last_block; ++block) {
+            Sum sum{};
+            const auto end = std::min((block + 1) * block_size, values.size());
+            for(auto i = block * block_size; i < end; ++i) {
+                sum += static_cast<Sum>(values[i]);
+            }
+            block_sums[block + 1] = sum;
+        }
+    });
+    for(std::size_t block{}; block < blocks_count; ++block) {
+        block_sums[block + 1] += block_sums[block];
+    }
+    parallel_for(blocks_count, blocks_count, 1, [&](const std::size_t first_block, const std::size_t last_block) {
+        for(auto block = first_block; block < last_block; ++block) {
+            auto sum = block_sums[block];
+            const auto end = std::min((block + 1) * block_size, values.size());
+            for(auto i = block * block_size; i < end; ++i) {
+                sums[i] = sum;
+                sum += static_cast<Sum>(values[i]);
+            }
+        }
+    });
+    sums.back() = block_sums.back();
+}
+
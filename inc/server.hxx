@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cache.hxx>
+#include <dae2obm.hxx>
+
+// Listens on a Unix domain socket, which only the user of the server may connect to, and serves the requests of
+// dae2obm --client on workers_count workers, which keep their document and thread between requests; the parallel steps
+// of every request run on a thread pool of the server. A worker serves one connection at a time, so workers_count
+// connections are served concurrently. A request is the client's command line, every argument followed by a null
+// character and the request by an empty argument. Conversion requests are answered with "<exit code> <milliseconds>\n",
+// and "--stats" with the percentiles of the latencies of the last requests. Runs until interrupted; returns 1 when the
+// socket cannot be listened on. The cache is optional and used for every request.
+int serve(const std::string_view socket_path, const std::size_t workers_count, ConversionCache* cache);
+// Sends one request to the server and reads its reply line, without the new line. Returns false when no server
+// listens on the socket or the connection is lost.
+bool send_request(const std::string_view socket_path, const std::vector<std::string>& arguments, std::string& reply);
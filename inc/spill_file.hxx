@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Bytes a spill file buffers before writing them to its file, and a spill reader reads at once.
+constexpr std::size_t SPILL_BUFFER_BYTES = 128 * 1024;
+
+// An array of bytes that stays in a buffer while it is small, and otherwise goes to a temporary file of the directory,
+// removed as soon as it is created so that nothing outlives the process. Bytes are appended through the buffer and
+// can be read back at any time, from the file and from the buffer.
+struct SpillFile {
+    explicit SpillFile(std::string directory);
+    SpillFile(SpillFile&& other) noexcept;
+    SpillFile& operator=(SpillFile&& other) noexcept;
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+    ~SpillFile();
+
+    bool append(const void* bytes, const std::size_t size);
+    template<typename Value>
+    bool push_back(const Value& value) {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        return append(&value, sizeof(value));
+    }
+    bool read(const std::uint64_t offset, void* bytes, const std::size_t size) const;
+    // Writes the buffer to the file, creating it if need be, so that the descriptor holds every byte.
+    bool flush();
+    // Empties the file, which keeps its buffer and descriptor for the next bytes.
+    void clear();
+
+    std::uint64_t size() const {
+        return file_size + buffered_size;
+    }
+
+    template<typename Value>
+    std::uint64_t count() const {
+        return size() / sizeof(Value);
+    }
+
+    std::string directory{};
+    std::vector<char> buffer{};
+    std::size_t buffered_size{};
+    std::uint64_t file_size{};
+    int descriptor{-1};
+    // Set by the first write that fails, after which the contents are incomplete.
+    bool failed{};
+};
+
+// Reads values_count values of a spill file one after the other from first_value on, through a buffer of its own.
+template<typename Value>
+struct SpillReader {
+    static_assert(std::is_trivially_copyable_v<Value>);
+
+    SpillReader(const SpillFile& file, const std::uint64_t first_value, const std::uint64_t values_count,
+            const std::size_t buffer_bytes = SPILL_BUFFER_BYTES)
+            : file{file}, next_value{first_value}, end_value{first_value + values_count},
+              buffer(std::max<std::size_t>(buffer_bytes / sizeof(Value), 1)) {}
+
+    explicit SpillReader(const SpillFile& file)
+            : SpillReader{file, 0, file.count<Value>()} {}
+
+    // Returns false once every value was read, or when the file cannot be read, which also sets failed.
+    bool read(Value& value) {
+        if(buffer_position == buffered_count && !fill()) {
+            return false;
+        }
+        value = buffer[buffer_position++];
+        return true;
+    }
+
+    bool fill() {
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), end_value - next_value));
+        if(count == 0) {
+            return false;
+        }
+        if(!file.read(next_value * sizeof(Value), buffer.data(), count * sizeof(Value))) {
+            failed = true;
+            return false;
+        }
+        next_value += count;
+        buffer_position = 0;
+        buffered_count = count;
+        return true;
+    }
+
+    const SpillFile& file;
+    std::uint64_t next_value{};
+    std::uint64_t end_value{};
+    std::vector<Value> buffer{};
+    std::size_t buffer_position{};
+    std::size_t buffered_count{};
+    bool failed{};
+};
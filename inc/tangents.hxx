@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+#include <mesh.hxx>
+
+// Generates per-corner tangent frames for a triangulated mesh with texture coordinates and normals, following the
+// rules of the MikkTSpace reference implementation with its default angular threshold: corners are vertices by value,
+// and the corners of a vertex whose triangles are connected around it and have the same mapping orientation share the
+// average of their face tangents, projected onto the normal and weighted by the corner angles. Triangles with a
+// degenerate mapping take the orientation of their neighbours, and degenerate triangles the frame of another corner of
+// their vertex. Sets TANGENTS_PRESENT on success.
+bool generate_tangents(Mesh& mesh, const std::size_t threads_count);
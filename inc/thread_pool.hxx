@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <parallel.hxx>
+
+// Threads started once that run the tasks of every run call, for callers that convert many times and should not start
+// threads for every parallel step, see Executor. A calling thread takes tasks of its own call as well, so that calls
+// from tasks, and calls while every thread is busy, never wait on tasks nobody runs.
+struct ThreadPool {
+    explicit ThreadPool(const std::size_t threads_count) {
+        threads.reserve(threads_count);
+        for(std::size_t thread{}; thread < threads_count; ++thread) {
+            threads.emplace_back([this] { run_tasks(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            const std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        ready.notify_all();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void run(const std::size_t tasks_count, const std::function<void(std::size_t)>& task) {
+        if(tasks_count == 0) {
+            return;
+        }
+        Batch batch{&task, tasks_count};
+        std::unique_lock lock{mutex};
+        batches.push_back(&batch);
+        ready.notify_all();
+        while(batch.next_task < batch.tasks_count) {
+            run_task(batch, lock);
+        }
+        batch.finished.wait(lock, [&] { return batch.done_count == batch.tasks_count; });
+    }
+
+    // An executor running on the pool, which has to outlive it.
+    Executor executor() {
+        return [this](const std::size_t tasks_count, const std::function<void(std::size_t)>& task) {
+            run(tasks_count, task);
+        };
+    }
+
+    struct Batch {
+        const std::function<void(std::size_t)>* task{};
+        std::size_t tasks_count{};
+        std::size_t next_task{};
+        std::size_t done_count{};
+        std::condition_variable finished{};
+    };
+
+    // Takes the next task of the batch and runs it unlocked. The last task taken removes the batch from the queue.
+    void run_task(Batch& batch, std::unique_lock<std::mutex>& lock) {
+        const auto index = batch.next_task++;
+        if(batch.next_task == batch.tasks_count) {
+            batches.erase(std::find(batches.begin(), batches.end(), &batch));
+        }
+        lock.unlock();
+        (*batch.task)(index);
+        lock.lock();
+        if(++batch.done_count == batch.tasks_count) {
+            batch.finished.notify_all();
+        }
+    }
+
+    void run_tasks() {
+        std::unique_lock lock{mutex};
+        while(true) {
+            ready.wait(lock, [&] { return stopping || !batches.empty(); });
+            if(batches.empty()) {
+                return;
+            }
+            run_task(*batches.front(), lock);
+        }
+    }
+
+    std::mutex mutex{};
+    std::condition_variable ready{};
+    // Batches with tasks nobody took yet, oldest first.
+    std::deque<Batch*> batches{};
+    bool stopping{};
+    std::vector<std::thread> threads{};
+};
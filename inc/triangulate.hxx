@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mesh.hxx>
+
+enum class PrimitiveType {
+    POLYGONS,   // <polylist> and <polygons>: every primitive is a single, possibly concave, polygon.
+    TRIANGLES,  // <triangles>: every primitive is already a triangle.
+    TRISTRIPS,  // <tristrips>: every primitive is a strip of triangles.
+    TRIFANS     // <trifans>: every primitive is a fan of triangles.
+};
+
+// Converts primitives made of vertex_counts[i] consecutive corners into a triangle list and returns, for every corner
+// of the resulting triangles, the index of the source corner it was taken from. Convex polygons are split into fans,
+// concave ones are ear clipped in the plane of the polygon.
+std::vector<std::uint32_t> triangulate(const PrimitiveType type, const std::vector<std::uint32_t>& vertex_counts,
+        const std::vector<std::uint32_t>& position_indices, const std::vector<Vector3>& positions,
+        const std::size_t threads_count);
+// The same for a single primitive, for callers that stream primitives rather than hold them all. Only POLYGONS of more
+// than 3 corners read corner_positions, the positions of their corners in order. Replaces triangles with the source
+// corners of the triangles, numbered from 0.
+void triangulate_primitive(const PrimitiveType type, const std::uint32_t vertex_count,
+        const std::vector<Vector3>& corner_positions, std::vector<std::uint32_t>& triangles);
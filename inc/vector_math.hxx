@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include <algorithm>
+
+#include <mesh.hxx>
+
+inline float component(const Vector3& vec, const std::size_t axis) {
+    return axis == 0 ? vec.x : axis == 1 ? vec.y : vec.z;
+}
+
+inline Vector3 operator+(const Vector3& lhs, const Vector3& rhs) {
+    return {lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z};
+}
+
+inline Vector3 operator-(const Vector3& lhs, const Vector3& rhs) {
+    return {lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z};
+}
+
+inline Vector3 operator*(const Vector3& vec, const float scalar) {
+    return {vec.x * scalar, vec.y * scalar, vec.z * scalar};
+}
+
+inline Vector3& operator+=(Vector3& lhs, const Vector3& rhs) {
+    lhs.x += rhs.x;
+    lhs.y += rhs.y;
+    lhs.z += rhs.z;
+    return lhs;
+}
+
+inline float dot(const Vector3& lhs, const Vector3& rhs) {
+    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+}
+
+inline Vector3 cross(const Vector3& lhs, const Vector3& rhs) {
+    return {lhs.y * rhs.z - lhs.z * rhs.y, lhs.z * rhs.x - lhs.x * rhs.z, lhs.x * rhs.y - lhs.y * rhs.x};
+}
+
+inline float length(const Vector3& vec) {
+    return std::sqrt(dot(vec, vec));
+}
+
+// Returns the zero vector for vectors too short to have a meaningful direction.
+inline Vector3 normalize(const Vector3& vec) {
+    const auto vec_length = length(vec);
+    return vec_length > 0.0f ? vec * (1.0f / vec_length) : Vector3{};
+}
+
+inline Vector3 component_min(const Vector3& lhs, const Vector3& rhs) {
+    return {std::min(lhs.x, rhs.x), std::min(lhs.y, rhs.y), std::min(lhs.z, rhs.z)};
+}
+
+inline Vector3 component_max(const Vector3& lhs, const Vector3& rhs) {
+    return {std::max(lhs.x, rhs.x), std::max(lhs.y, rhs.y), std::max(lhs.z, rhs.z)};
+}
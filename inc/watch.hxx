@@ -0,0 +1,16 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+#include <cache.hxx>
+#include <dae2obm.hxx>
+
+// Watches the source directory tree with inotify and reconverts every .dae, .dae.gz and .zae file that stops changing
+// for the debounce time into the output directory (mirroring the batch layout), on threads_count workers that keep
+// their document and thread between conversions. Changes arriving while a file converts queue one more conversion of
+// it. When the kernel drops events, the tree is rescanned and every file whose output is out of date is reconverted.
+// Prints the latency from the first change of every save to its updated output, and runs until interrupted;
+// returns 1 when the directory cannot be watched. The cache is optional.
+int watch_directory(const std::string_view source_directory, const std::string_view output_directory,
+        const ConversionOptions& options, const std::chrono::milliseconds debounce_time, ConversionCache* cache);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+#include <mesh.hxx>
+
+// Merges duplicate attribute values and remaps the index streams accordingly. Positions closer than epsilon are
+// merged through a spatial hash grid (transitively, every cluster keeping its first position), epsilon 0 merging only
+// bitwise identical positions; all other attributes merge bitwise identical values. The scratch memory is a few
+// 32-bit words per value, without any per-value allocation.
+void weld_mesh(Mesh& mesh, const float epsilon, const std::size_t threads_count);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Streaming XXH64: feeding the data in any number of update calls gives the same digest as hashing it at once.
+struct Xxh64 {
+    explicit Xxh64(const std::uint64_t seed = 0);
+
+    void update(const void* data, const std::size_t size);
+    std::uint64_t digest() const;
+
+    std::uint64_t seed;
+    std::array<std::uint64_t, 4> lanes;
+    std::uint64_t total_size{};
+    std::array<unsigned char, 32> pending{};
+    std::size_t pending_size{};
+};
+
+std::uint64_t xxh64(const void* data, const std::size_t size, const std::uint64_t seed = 0);
@@ -95,6 +95,15 @@ distribution.
 #endif
 
 
+/*
+	Deepest nesting of elements a document accepts by default, see
+	XMLDocument::SetMaxElementDepth(). Parsing doesn't recurse, but deleting,
+	copying and printing a document do.
+*/
+#ifndef TINYXML2_MAX_ELEMENT_DEPTH
+#   define TINYXML2_MAX_ELEMENT_DEPTH 500
+#endif
+
 /* Versioning, past 1.0.14:
 	http://semver.org/
 */
@@ -148,6 +157,9 @@ public:
     }
 
     const char* GetStr();
+    // The string without rewriting it: the raw text until GetStr() is called, the
+    // processed one after. Not null terminated.
+    void GetSpan( const char** start, size_t* length ) const;
 
     bool Empty() const {
         return _start == _end;
@@ -309,6 +321,21 @@ private:
 };
 
 
+/**
+	Allocation statistics of memory pools, see XMLDocument::PoolStats().
+*/
+struct XMLPoolStats
+{
+    XMLPoolStats() : currentAllocs( 0 ), peakAllocs( 0 ), nAllocs( 0 ), blocks( 0 ), blockBytes( 0 ) {}
+
+    int currentAllocs;	// objects in use
+    int peakAllocs;		// most objects in use at once since the pool was last emptied
+    int nAllocs;		// objects allocated since the pool was last emptied
+    int blocks;			// blocks held, including the ones kept for reuse
+    size_t blockBytes;	// memory held by the blocks
+};
+
+
 /*
 	Parent virtual class of a pool for fast allocation
 	and deallocation of objects.
@@ -324,34 +351,64 @@ public:
     virtual void Free( void* ) = 0;
     virtual void SetTracked() = 0;
     virtual void Clear() = 0;
+    virtual void Reset() = 0;
+    virtual void SetBlockSize( size_t bytes, bool hugePages ) = 0;
+    virtual void AddStats( XMLPoolStats* stats ) const = 0;
+
+protected:
+    // Raw memory of the blocks. With hugePages the block is mapped, on huge
+    // pages where the system has them, and 'bytes' may be rounded up.
+    static void* AllocBlock( size_t* bytes, bool hugePages, bool* mapped );
+    static void FreeBlock( void* mem, size_t bytes, bool mapped );
 };
 
 
 /*
 	Template child class to create pools of the correct type.
+
+	Objects are carved out of blocks in order, and freed objects are
+	reused first. Reset() keeps the blocks for the next document: a
+	document reused for many files allocates no memory once its pools
+	have grown to the largest of them.
 */
 template< int ITEM_SIZE >
 class MemPoolT : public MemPool
 {
 public:
-    MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
+    MemPoolT() : _blocks(), _root(0), _currentBlock(-1), _fresh(0), _freshEnd(0),
+        _blockBytes( ITEMS_PER_BLOCK * sizeof( Item ) ), _hugePages( false ),
+        _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
     ~MemPoolT() {
         Clear();
     }
-    
+
+    // Releases the blocks.
     void Clear() {
-        // Delete the blocks.
-        while( !_blockPtrs.Empty()) {
-            Block* lastBlock = _blockPtrs.Pop();
-            delete lastBlock;
+        Reset();
+        while( !_blocks.Empty()) {
+            Block block = _blocks.Pop();
+            FreeBlock( block.items, block.bytes, block.mapped );
         }
+    }
+
+    // Empties the pool, keeping its blocks.
+    void Reset() {
         _root = 0;
+        _currentBlock = -1;
+        _fresh = 0;
+        _freshEnd = 0;
         _currentAllocs = 0;
         _nAllocs = 0;
         _maxAllocs = 0;
         _nUntracked = 0;
     }
 
+    // Sets the size of the blocks allocated from now on.
+    void SetBlockSize( size_t bytes, bool hugePages ) {
+        _blockBytes = bytes < sizeof( Item ) ? sizeof( Item ) : bytes;
+        _hugePages = hugePages;
+    }
+
     virtual int ItemSize() const	{
         return ITEM_SIZE;
     }
@@ -360,21 +417,17 @@ public:
     }
 
     virtual void* Alloc() {
-        if ( !_root ) {
-            // Need a new block.
-            Block* block = new Block();
-            _blockPtrs.Push( block );
-
-            Item* blockItems = block->items;
-            for( int i = 0; i < ITEMS_PER_BLOCK - 1; ++i ) {
-                blockItems[i].next = &(blockItems[i + 1]);
+        Item* result = _root;
+        if ( result ) {
+            _root = _root->next;
+        }
+        else {
+            if ( _fresh == _freshEnd ) {
+                NextBlock();
             }
-            blockItems[ITEMS_PER_BLOCK - 1].next = 0;
-            _root = blockItems;
+            result = _fresh++;
         }
-        Item* const result = _root;
         TIXMLASSERT( result != 0 );
-        _root = _root->next;
 
         ++_currentAllocs;
         if ( _currentAllocs > _maxAllocs ) {
@@ -398,9 +451,21 @@ public:
         _root = item;
     }
     void Trace( const char* name ) {
-        printf( "Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d blocks=%d\n",
+        XMLPoolStats stats;
+        AddStats( &stats );
+        printf( "Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d blocks=%d [%dk]\n",
                 name, _maxAllocs, _maxAllocs * ITEM_SIZE / 1024, _currentAllocs,
-                ITEM_SIZE, _nAllocs, _blockPtrs.Size() );
+                ITEM_SIZE, _nAllocs, stats.blocks, (int)( stats.blockBytes / 1024 ) );
+    }
+
+    void AddStats( XMLPoolStats* stats ) const {
+        stats->currentAllocs += _currentAllocs;
+        stats->peakAllocs += _maxAllocs;
+        stats->nAllocs += _nAllocs;
+        stats->blocks += _blocks.Size();
+        for( int i = 0; i < _blocks.Size(); ++i ) {
+            stats->blockBytes += _blocks[i].bytes;
+        }
     }
 
     void SetTracked() {
@@ -420,6 +485,7 @@ public:
 	//		16k:	5200
 	//		32k:	4300
 	//		64k:	4000	21000
+	// It is the default, see SetBlockSize() for documents of millions of nodes.
     // Declared public because some compilers do not accept to use ITEMS_PER_BLOCK
     // in private part if ITEMS_PER_BLOCK is private
     enum { ITEMS_PER_BLOCK = (4 * 1024) / ITEM_SIZE };
@@ -433,10 +499,32 @@ private:
         char    itemData[ITEM_SIZE];
     };
     struct Block {
-        Item items[ITEMS_PER_BLOCK];
+        Item*	items;
+        size_t	bytes;
+        bool	mapped;
     };
-    DynArray< Block*, 10 > _blockPtrs;
-    Item* _root;
+
+    // Moves on to the next kept block, or a new one.
+    void NextBlock() {
+        ++_currentBlock;
+        if ( _currentBlock == _blocks.Size() ) {
+            Block block;
+            block.bytes = _blockBytes;
+            block.items = static_cast<Item*>( AllocBlock( &block.bytes, _hugePages, &block.mapped ) );
+            _blocks.Push( block );
+        }
+        const Block& block = _blocks[_currentBlock];
+        _fresh = block.items;
+        _freshEnd = block.items + block.bytes / sizeof( Item );
+    }
+
+    DynArray< Block, 10 > _blocks;
+    Item* _root;		// freed items
+    int _currentBlock;
+    Item* _fresh;		// items of the current block never allocated
+    Item* _freshEnd;
+    size_t _blockBytes;
+    bool _hugePages;
 
     int _currentAllocs;
     int _nAllocs;
@@ -528,6 +616,7 @@ enum XMLError {
     XML_ERROR_PARSING,
     XML_CAN_NOT_CONVERT_TEXT,
     XML_NO_TEXT_NODE,
+    XML_ELEMENT_DEPTH_EXCEEDED,
 
 	XML_ERROR_COUNT
 };
@@ -542,15 +631,14 @@ public:
     static const char* SkipWhiteSpace( const char* p, int* curLineNumPtr )	{
         TIXMLASSERT( p );
 
-        while( IsWhiteSpace(*p) ) {
-            if (curLineNumPtr && *p == '\n') {
-                ++(*curLineNumPtr);
-            }
-            ++p;
+        if ( IsWhiteSpace(*p) ) {
+            p = SkipWhiteSpaceRun( p, curLineNumPtr );
         }
         TIXMLASSERT( p );
         return p;
     }
+    // Skips whitespace a block at a time; SkipWhiteSpace only calls it when there is some to skip.
+    static const char* SkipWhiteSpaceRun( const char* p, int* curLineNumPtr );
     static char* SkipWhiteSpace( char* p, int* curLineNumPtr )				{
         return const_cast<char*>( SkipWhiteSpace( const_cast<const char*>(p), curLineNumPtr ) );
     }
@@ -628,6 +716,40 @@ private:
 };
 
 
+/**
+	Produces the text of a document for XMLDocument::LoadFile( XMLReader* ),
+	such as a decompressor. Implemented by the application.
+*/
+class TINYXML2_LIB XMLReader
+{
+public:
+    virtual ~XMLReader() {}
+
+    /// Starts over from the first byte of the text. Returns false on failure.
+    virtual bool Rewind() = 0;
+    /// The expected length of the text, which sizes the buffer up front, or 0 when unknown.
+    virtual size_t SizeHint() const = 0;
+    /// Writes up to size next bytes into buffer and returns their count, 0 at the end of the text or (size_t)-1 on error.
+    virtual size_t Read( char* buffer, size_t size ) = 0;
+};
+
+
+/**
+	Runs the tasks of a parallel parse, see XMLDocument::SetParallelParse().
+	Implemented by the application on the threads it has.
+*/
+class TINYXML2_LIB XMLTaskRunner
+{
+public:
+    virtual ~XMLTaskRunner() {}
+
+    /// The number of tasks Run() runs at once at most. A parse isn't split for 1.
+    virtual int Concurrency() const = 0;
+    /// Calls task( context, i ) for every i in [0, count), possibly concurrently, and returns once all are done.
+    virtual void Run( int count, void (*task)( void* context, int index ), void* context ) = 0;
+};
+
+
 /** XMLNode is a base class for every object that is in the
 	XML Document Object Model (DOM), except XMLAttributes.
 	Nodes have siblings, a parent, and children which can
@@ -1483,6 +1605,15 @@ public:
     */
     const char* GetText() const;
 
+    /** Like GetText(), but returns the text as a span of the parsed buffer which is neither
+    	null terminated nor rewritten in place: entities, line breaks and whitespace are
+    	left as they are in the document, unless GetText() was called first. This skips the
+    	normalization pass over text that can't need it, such as long numeric payloads.
+
+    	Returns false, and leaves the span untouched, if the first child isn't a text node.
+    */
+    bool GetTextSpan( const char** text, size_t* length ) const;
+
     /** Convenience function for easy access to the text inside an element. Although easy
     	and concise, SetText() is limited compared to creating an XMLText child
     	and mutating it directly.
@@ -1634,10 +1765,15 @@ enum Whitespace {
 */
 class TINYXML2_LIB XMLDocument : public XMLNode
 {
+    friend class XMLNode;
     friend class XMLElement;
 public:
-    /// constructor
-    XMLDocument( bool processEntities = true, Whitespace whitespaceMode = PRESERVE_WHITESPACE );
+    /** constructor
+
+    	A lean document, without line tracking, doesn't count lines while parsing:
+    	GetLineNum() and the error line number are then 0.
+    */
+    XMLDocument( bool processEntities = true, Whitespace whitespaceMode = PRESERVE_WHITESPACE, bool trackLines = true );
     ~XMLDocument();
 
     virtual XMLDocument* ToDocument()				{
@@ -1681,6 +1817,18 @@ public:
     */
     XMLError LoadFile( FILE* );
 
+    /**
+    	Load an XML document from a reader, which writes the
+    	text straight into the buffer of the document: text
+    	produced in memory isn't copied again as with Parse().
+    	The reader is rewound before reading, and once more if
+    	a parallel parse has to start over.
+
+    	Returns XML_SUCCESS (0) on success, or
+    	an errorID.
+    */
+    XMLError LoadFile( XMLReader* reader );
+
     /**
     	Save the XML file to disk.
     	Returns XML_SUCCESS (0) on success, or
@@ -1703,6 +1851,56 @@ public:
     Whitespace WhitespaceMode() const	{
         return _whitespaceMode;
     }
+    bool TrackLines() const				{
+        return _trackLines;
+    }
+
+    /**
+    	Sets the deepest nesting of elements parsing accepts, TINYXML2_MAX_ELEMENT_DEPTH
+    	unless set. Deeper documents fail with XML_ELEMENT_DEPTH_EXCEEDED.
+    */
+    void SetMaxElementDepth( int depth )	{
+        _maxElementDepth = depth;
+    }
+    int MaxElementDepth() const			{
+        return _maxElementDepth;
+    }
+
+    /**
+    	Sets the size of the blocks the document allocates its nodes and
+    	attributes in, for the blocks allocated from now on; the default
+    	is 4k per pool. Documents of millions of elements parse faster in
+    	blocks of a megabyte or two, mapped on huge pages with hugePages
+    	where the system has them.
+
+    	Clear() and parsing keep the blocks of the previous document for
+    	the next one. They are released when the document is destroyed.
+    */
+    void SetPoolBlockSize( size_t bytes, bool hugePages = false );
+
+    /**
+    	Allocation statistics of the current document, summed over the
+    	pools of its elements, attributes, text and other nodes.
+    */
+    XMLPoolStats PoolStats() const;
+
+    /**
+    	Splits the parsing of big documents across the tasks of a runner:
+    	the children of the elements under the root element whose name
+    	starts with splitPrefix (such as the libraries of a COLLADA file)
+    	are parsed in chunks of siblings, each chunk by a task into pools
+    	of its own, and attached to the tree when parsing reaches them.
+    	Everything else is parsed as usual.
+
+    	The split is speculative. When a chunk isn't what parsing finds at
+    	its place, or the document has an error, the document is parsed
+    	again without splitting: the result, errors included, is always
+    	the one of a plain parse.
+
+    	Only lean documents (without line tracking) are split. The prefix
+    	and the runner aren't copied; null disables splitting.
+    */
+    void SetParallelParse( const char* splitPrefix, XMLTaskRunner* runner );
 
     /**
     	Returns true if this document has a leading Byte Order Mark of UTF8.
@@ -1854,7 +2052,11 @@ private:
     mutable StrPair	_errorStr2;
     int             _errorLineNum;
     char*			_charBuffer;
+    bool			_trackLines;
+    int				_maxElementDepth;
     int				_parseCurLineNum;
+    size_t			_poolBlockBytes;
+    bool			_poolHugePages;
 	// Memory tracking does add some overhead.
 	// However, the code assumes that you don't
 	// have a bunch of unlinked nodes around.
@@ -1868,9 +2070,28 @@ private:
     MemPoolT< sizeof(XMLText) >		 _textPool;
     MemPoolT< sizeof(XMLComment) >	 _commentPool;
 
+    // A run of sibling elements parsed by a task, see SetParallelParse().
+    struct ParseChunk {
+        char*	start;		// the '<' of its first element
+        char*	end;		// past the '>' of its last element, on white space
+        char	endChar;	// replaced by a null character while tasks parse
+        bool	parsed;		// its nodes are the children of its document
+    };
+    const char*		_splitPrefix;
+    XMLTaskRunner*	_parseRunner;
+    DynArray<ParseChunk, 16> _parseChunks;
+    int				_nextParseChunk;
+    // The document of every chunk, which owns the memory of its nodes,
+    // kept for the next parse.
+    DynArray<XMLDocument*, 16> _chunkDocuments;
+
 	static const char* _errorNames[XML_ERROR_COUNT];
 
     void Parse();
+    bool ParseSplit( size_t length );
+    void FindParseChunks( size_t length );
+    void ClearParseChunks();
+    static void ParseChunkTask( void* context, int index );
 
     template<class NodeType, int PoolElementSize>
     NodeType* CreateUnlinkedNode( MemPoolT<PoolElementSize>& pool );
@@ -32,6 +32,19 @@ distribution.
 #   include <cstdarg>
 #endif
 
+// Text scanning uses SSE2, and AVX2 when the CPU has it, where GCC-compatible compilers target x86.
+#if ( defined(__GNUC__) || defined(__clang__) ) && ( defined(__x86_64__) || defined(__i386__) ) && defined(__SSE2__)
+#   define TIXML_BLOCK_SCAN
+#   include <immintrin.h>
+#   include <stdint.h>
+#endif
+
+// Pool blocks can be mapped on huge pages.
+#ifdef __linux__
+#   define TIXML_HUGE_PAGES
+#   include <sys/mman.h>
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 ) && (!defined WINCE)
 	// Microsoft Visual Studio, version 2005 and higher. Not WinCE.
 	/*int _snprintf_s(
@@ -101,6 +114,16 @@ distribution.
 #endif
 
 
+// Split parsing, see XMLDocument::SetParallelParse(): chunks are runs of elements under the
+// children of the root element, of at least MIN_PARSE_CHUNK_SIZE bytes, about
+// PARSE_CHUNKS_PER_TASK per task the runner runs at once.
+static const int PARSE_CHUNK_DEPTH				= 2;
+static const size_t MIN_PARSE_CHUNK_SIZE		= 64 * 1024;
+static const int PARSE_CHUNKS_PER_TASK			= 4;
+
+// Initial buffer of XMLDocument::LoadFile( XMLReader* ) for text of unknown length.
+static const size_t READER_BUFFER_SIZE			= 1024 * 1024;
+
 static const char LINE_FEED				= (char)0x0a;			// all line endings are normalized to LF
 static const char LF = LINE_FEED;
 static const char CARRIAGE_RETURN		= (char)0x0d;			// CR gets filtered out
@@ -135,6 +158,172 @@ static const Entity entities[NUM_ENTITIES] = {
 };
 
 
+// --------- Block scanning ----------- //
+
+// The scans below find the first byte of a class in null terminated text. The vector versions test a 16 or
+// 32 byte block at a time; their loads are aligned to the block size so that they never cross a page, the
+// bytes of the first block before the text are masked out, and the bytes after the null are read but ignored.
+// Whitespace is the C locale isspace() set.
+enum ScanClass {
+    SCAN_STOP_BYTES,	// null or one of the three stop bytes
+    SCAN_SPACE,			// null or whitespace
+    SCAN_NON_SPACE		// anything but whitespace, null included
+};
+
+// Returns the first byte of the class from p on, and adds the line feeds before it to newlines when not null.
+typedef const char* (*ScanFunction)( const char* p, const char* stops, int* newlines );
+
+template<int CLASS>
+static const char* ScanBytewise( const char* p, const char* stops, int* newlines )
+{
+    for( ;; ++p ) {
+        const char c = *p;
+        const bool space = c == ' ' || static_cast<unsigned char>( c - '\t' ) <= 4;
+        bool found = false;
+        if ( CLASS == SCAN_STOP_BYTES ) {
+            found = c == 0 || c == stops[0] || c == stops[1] || c == stops[2];
+        }
+        else if ( CLASS == SCAN_SPACE ) {
+            found = c == 0 || space;
+        }
+        else {
+            found = !space;
+        }
+        if ( found ) {
+            return p;
+        }
+        if ( newlines && c == LF ) {
+            ++(*newlines);
+        }
+    }
+}
+
+#ifdef TIXML_BLOCK_SCAN
+
+template<int CLASS>
+static const char* ScanSse2( const char* p, const char* stops, int* newlines )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i stop0 = _mm_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[0] : 0 );
+    const __m128i stop1 = _mm_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[1] : 0 );
+    const __m128i stop2 = _mm_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[2] : 0 );
+    const __m128i space = _mm_set1_epi8( ' ' );
+    const __m128i tab = _mm_set1_epi8( '\t' );
+    const __m128i four = _mm_set1_epi8( 4 );
+    const __m128i lineFeed = _mm_set1_epi8( LF );
+
+    const size_t offset = reinterpret_cast<uintptr_t>( p ) & 15;
+    const char* block = p - offset;
+    unsigned int live = 0xffffu << offset;
+    for( ;; ) {
+        const __m128i bytes = _mm_load_si128( reinterpret_cast<const __m128i*>( block ) );
+        unsigned int found = 0;
+        if ( CLASS == SCAN_STOP_BYTES ) {
+            const __m128i stop = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( bytes, zero ), _mm_cmpeq_epi8( bytes, stop0 ) ),
+                                               _mm_or_si128( _mm_cmpeq_epi8( bytes, stop1 ), _mm_cmpeq_epi8( bytes, stop2 ) ) );
+            found = static_cast<unsigned int>( _mm_movemask_epi8( stop ) );
+        }
+        else {
+            // \t to \r are the bytes that are at most 4 once \t is subtracted.
+            const __m128i controls = _mm_subs_epu8( _mm_sub_epi8( bytes, tab ), four );
+            const __m128i isSpace = _mm_or_si128( _mm_cmpeq_epi8( bytes, space ), _mm_cmpeq_epi8( controls, zero ) );
+            const unsigned int spaces = static_cast<unsigned int>( _mm_movemask_epi8( isSpace ) );
+            found = CLASS == SCAN_SPACE ? spaces | static_cast<unsigned int>( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, zero ) ) )
+                                        : ~spaces & 0xffffu;
+        }
+        found &= live;
+        if ( newlines ) {
+            unsigned int lineFeeds = static_cast<unsigned int>( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, lineFeed ) ) ) & live;
+            if ( found ) {
+                lineFeeds &= ( found & ( 0u - found ) ) - 1;
+            }
+            *newlines += __builtin_popcount( lineFeeds );
+        }
+        if ( found ) {
+            return block + __builtin_ctz( found );
+        }
+        block += 16;
+        live = 0xffffu;
+    }
+}
+
+template<int CLASS>
+__attribute__(( target( "avx2,popcnt" ) ))
+static const char* ScanAvx2( const char* p, const char* stops, int* newlines )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i stop0 = _mm256_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[0] : 0 );
+    const __m256i stop1 = _mm256_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[1] : 0 );
+    const __m256i stop2 = _mm256_set1_epi8( CLASS == SCAN_STOP_BYTES ? stops[2] : 0 );
+    const __m256i space = _mm256_set1_epi8( ' ' );
+    const __m256i tab = _mm256_set1_epi8( '\t' );
+    const __m256i four = _mm256_set1_epi8( 4 );
+    const __m256i lineFeed = _mm256_set1_epi8( LF );
+
+    const size_t offset = reinterpret_cast<uintptr_t>( p ) & 31;
+    const char* block = p - offset;
+    unsigned int live = 0xffffffffu << offset;
+    for( ;; ) {
+        const __m256i bytes = _mm256_load_si256( reinterpret_cast<const __m256i*>( block ) );
+        unsigned int found = 0;
+        if ( CLASS == SCAN_STOP_BYTES ) {
+            const __m256i stop = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( bytes, zero ), _mm256_cmpeq_epi8( bytes, stop0 ) ),
+                                                  _mm256_or_si256( _mm256_cmpeq_epi8( bytes, stop1 ), _mm256_cmpeq_epi8( bytes, stop2 ) ) );
+            found = static_cast<unsigned int>( _mm256_movemask_epi8( stop ) );
+        }
+        else {
+            const __m256i controls = _mm256_subs_epu8( _mm256_sub_epi8( bytes, tab ), four );
+            const __m256i isSpace = _mm256_or_si256( _mm256_cmpeq_epi8( bytes, space ), _mm256_cmpeq_epi8( controls, zero ) );
+            const unsigned int spaces = static_cast<unsigned int>( _mm256_movemask_epi8( isSpace ) );
+            found = CLASS == SCAN_SPACE ? spaces | static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( bytes, zero ) ) )
+                                        : ~spaces;
+        }
+        found &= live;
+        if ( newlines ) {
+            unsigned int lineFeeds = static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( bytes, lineFeed ) ) ) & live;
+            if ( found ) {
+                lineFeeds &= ( found & ( 0u - found ) ) - 1;
+            }
+            *newlines += __builtin_popcount( lineFeeds );
+        }
+        if ( found ) {
+            return block + __builtin_ctz( found );
+        }
+        block += 32;
+        live = 0xffffffffu;
+    }
+}
+
+#endif
+
+struct Scanners {
+    ScanFunction findStopBytes;
+    ScanFunction findSpace;
+    ScanFunction skipSpace;
+};
+
+static Scanners SelectScanners()
+{
+#ifdef TIXML_BLOCK_SCAN
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        const Scanners scanners = { ScanAvx2<SCAN_STOP_BYTES>, ScanAvx2<SCAN_SPACE>, ScanAvx2<SCAN_NON_SPACE> };
+        return scanners;
+    }
+    const Scanners scanners = { ScanSse2<SCAN_STOP_BYTES>, ScanSse2<SCAN_SPACE>, ScanSse2<SCAN_NON_SPACE> };
+#else
+    const Scanners scanners = { ScanBytewise<SCAN_STOP_BYTES>, ScanBytewise<SCAN_SPACE>, ScanBytewise<SCAN_NON_SPACE> };
+#endif
+    return scanners;
+}
+
+static const Scanners& GetScanners()
+{
+    static const Scanners scanners = SelectScanners();
+    return scanners;
+}
+
+
 StrPair::~StrPair()
 {
     Reset();
@@ -193,24 +382,28 @@ char* StrPair::ParseText( char* p, const char* endTag, int strFlags, int* curLin
 {
     TIXMLASSERT( p );
     TIXMLASSERT( endTag && *endTag );
-	TIXMLASSERT(curLineNumPtr);
 
     char* start = p;
     char  endChar = *endTag;
     size_t length = strlen( endTag );
+    const char stops[3] = { endChar, endChar, endChar };
+    const ScanFunction findStopBytes = GetScanners().findStopBytes;
 
-    // Inner loop of text parsing.
-    while ( *p ) {
-        if ( *p == endChar && strncmp( p, endTag, length ) == 0 ) {
+    // Inner loop of text parsing: jumps from one candidate end tag to the next.
+    for( ;; ) {
+        p = const_cast<char*>( findStopBytes( p, stops, curLineNumPtr ) );
+        if ( !*p ) {
+            return 0;
+        }
+        if ( strncmp( p, endTag, length ) == 0 ) {
             Set( start, p, strFlags );
             return p + length;
-        } else if (*p == '\n') {
+        } else if ( *p == '\n' && curLineNumPtr ) {
             ++(*curLineNumPtr);
         }
         ++p;
         TIXMLASSERT( p );
     }
-    return 0;
 }
 
 
@@ -245,6 +438,7 @@ void StrPair::CollapseWhitespace()
         const char* p = _start;	// the read pointer
         char* q = _start;	// the write pointer
 
+        const ScanFunction findSpace = GetScanners().findSpace;
         while( *p ) {
             if ( XMLUtil::IsWhiteSpace( *p )) {
                 p = XMLUtil::SkipWhiteSpace( p, 0 );
@@ -254,9 +448,11 @@ void StrPair::CollapseWhitespace()
                 *q = ' ';
                 ++q;
             }
-            *q = *p;
-            ++q;
-            ++p;
+            // Move the whole word.
+            const char* wordEnd = findSpace( p, 0, 0 );
+            memmove( q, p, wordEnd - p );
+            q += wordEnd - p;
+            p = wordEnd;
         }
         *q = 0;
     }
@@ -275,7 +471,28 @@ const char* StrPair::GetStr()
             const char* p = _start;	// the read pointer
             char* q = _start;	// the write pointer
 
+            // Only line breaks and entities are rewritten: the runs between them are found with a block
+            // scan, and moved at once (or left in place until the first rewrite).
+            char stops[3] = { 0, 0, 0 };
+            if ( _flags & NEEDS_NEWLINE_NORMALIZATION ) {
+                stops[0] = CR;
+                stops[1] = LF;
+            }
+            if ( _flags & NEEDS_ENTITY_PROCESSING ) {
+                stops[2] = '&';
+            }
+            const ScanFunction findStopBytes = GetScanners().findStopBytes;
+
             while( p < _end ) {
+                const char* runEnd = findStopBytes( p, stops, 0 );
+                if ( q != p ) {
+                    memmove( q, p, runEnd - p );
+                }
+                q += runEnd - p;
+                p = runEnd;
+                if ( p == _end ) {
+                    break;
+                }
                 if ( (_flags & NEEDS_NEWLINE_NORMALIZATION) && *p == CR ) {
                     // CR-LF pair becomes LF
                     // CR alone becomes LF
@@ -364,10 +581,91 @@ const char* StrPair::GetStr()
 }
 
 
+void StrPair::GetSpan( const char** start, size_t* length ) const
+{
+    TIXMLASSERT( start );
+    TIXMLASSERT( length );
+    *start = _start;
+    if ( _flags & NEEDS_FLUSH ) {
+        *length = _end - _start;
+    }
+    else {
+        *length = _start ? strlen( _start ) : 0;
+    }
+}
+
+
+// --------- MemPool ----------- //
+
+void* MemPool::AllocBlock( size_t* bytes, bool hugePages, bool* mapped )
+{
+    TIXMLASSERT( bytes );
+    TIXMLASSERT( mapped );
+    *mapped = false;
+#ifdef TIXML_HUGE_PAGES
+    if ( hugePages ) {
+        static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+        const size_t size = ( *bytes + HUGE_PAGE_SIZE - 1 ) & ~( HUGE_PAGE_SIZE - 1 );
+        void* mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        mem = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+#endif
+        if ( mem == MAP_FAILED ) {
+            // No huge pages reserved: transparent ones need the mapping aligned on them.
+            char* area = static_cast<char*>( mmap( 0, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) );
+            if ( area != MAP_FAILED ) {
+                char* aligned = reinterpret_cast<char*>(
+                    ( reinterpret_cast<uintptr_t>( area ) + HUGE_PAGE_SIZE - 1 ) & ~( HUGE_PAGE_SIZE - 1 ) );
+                if ( aligned != area ) {
+                    munmap( area, aligned - area );
+                }
+                if ( aligned != area + HUGE_PAGE_SIZE ) {
+                    munmap( aligned + size, area + HUGE_PAGE_SIZE - aligned );
+                }
+#ifdef MADV_HUGEPAGE
+                madvise( aligned, size, MADV_HUGEPAGE );
+#endif
+                mem = aligned;
+            }
+        }
+        if ( mem != MAP_FAILED ) {
+            *bytes = size;
+            *mapped = true;
+            return mem;
+        }
+    }
+#else
+    (void)hugePages;
+#endif
+    return new char[*bytes];
+}
+
+
+void MemPool::FreeBlock( void* mem, size_t bytes, bool mapped )
+{
+#ifdef TIXML_HUGE_PAGES
+    if ( mapped ) {
+        munmap( mem, bytes );
+        return;
+    }
+#else
+    (void)mapped;
+#endif
+    (void)bytes;
+    delete [] static_cast<char*>( mem );
+}
+
+
 
 
 // --------- XMLUtil ----------- //
 
+const char* XMLUtil::SkipWhiteSpaceRun( const char* p, int* curLineNumPtr )
+{
+    return GetScanners().skipSpace( p, 0, curLineNumPtr );
+}
+
 const char* XMLUtil::writeBoolTrue  = "true";
 const char* XMLUtil::writeBoolFalse = "false";
 
@@ -658,7 +956,7 @@ char* XMLDocument::Identify( char* p, XMLNode** node )
     TIXMLASSERT( p );
     char* const start = p;
     int const startLine = _parseCurLineNum;
-    p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+    p = XMLUtil::SkipWhiteSpace( p, _trackLines ? &_parseCurLineNum : 0 );
     if( !*p ) {
         *node = 0;
         TIXMLASSERT( p );
@@ -986,8 +1284,10 @@ const XMLElement* XMLNode::PreviousSiblingElement( const char* name ) const
 
 char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
 {
-    // This is a recursive method, but thinking about it "at the current level"
-    // it is a pretty simple flat list:
+    // This parses the whole subtree of this node without recursing: the open
+    // elements whose content is being read are kept on an explicit stack, and
+    // 'parent' is the innermost of them (or this node). Thinking about it "at
+    // the current level", it is a pretty simple flat list:
     //		<foo/>
     //		<!-- comment -->
     //
@@ -996,12 +1296,11 @@ char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
     //		</foo>
     //		<!-- comment -->
     //
-    // Where the closing element (/foo) *must* be the next thing after the opening
-    // element, and the names must match. BUT the tricky bit is that the closing
-    // element will be read by the child.
-    //
-    // 'endTag' is the end tag for this node, it is returned by a call to a child.
-    // 'parentEnd' is the end tag for the parent, which is filled in and returned.
+    // Where the closing element (/foo) *must* be the next thing after the content
+    // of the opening element, and the names must match. A closing element at the
+    // level of this node ends the parse, its name returned in 'parentEndTag'.
+    DynArray<XMLNode*, 32> ancestors;	// of 'parent', from this node down
+    XMLNode* parent = this;
 
     while( p && *p ) {
         XMLNode* node = 0;
@@ -1012,10 +1311,41 @@ char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
             break;
         }
 
+        XMLDocument* const doc = _document;
+        if ( doc->_nextParseChunk < doc->_parseChunks.Size() && p > doc->_parseChunks[doc->_nextParseChunk].start ) {
+            // A chunk parsed by a task of a split parse: take its nodes in place of
+            // parsing it. Parsing elsewhere than its start means the split was wrong.
+            const XMLDocument::ParseChunk& chunk = doc->_parseChunks[doc->_nextParseChunk];
+            const bool matched = chunk.parsed && p - 1 == chunk.start && node->ToElement()
+                                 && ancestors.Size() == PARSE_CHUNK_DEPTH;
+            node->_memPool->SetTracked();   // created and then immediately deleted.
+            DeleteNode( node );
+            if ( !matched ) {
+                break;
+            }
+            XMLDocument* chunkDocument = doc->_chunkDocuments[doc->_nextParseChunk];
+            for ( XMLNode* child = chunkDocument->_firstChild; child; child = child->_next ) {
+                child->_parent = parent;
+            }
+            if ( chunkDocument->_firstChild ) {
+                if ( parent->_lastChild ) {
+                    parent->_lastChild->_next = chunkDocument->_firstChild;
+                    chunkDocument->_firstChild->_prev = parent->_lastChild;
+                }
+                else {
+                    parent->_firstChild = chunkDocument->_firstChild;
+                }
+                parent->_lastChild = chunkDocument->_lastChild;
+                chunkDocument->_firstChild = chunkDocument->_lastChild = 0;
+            }
+            ++doc->_nextParseChunk;
+            p = chunk.end;
+            continue;
+        }
+
         int initialLineNum = node->_parseLineNum;
 
-        StrPair endTag;
-        p = node->ParseDeep( p, &endTag, curLineNumPtr );
+        p = node->ParseDeep( p, 0, curLineNumPtr );
         if ( !p ) {
             DeleteNode( node );
             if ( !_document->Error() ) {
@@ -1027,7 +1357,7 @@ char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
         XMLDeclaration* decl = node->ToDeclaration();
         if ( decl ) {
             // Declarations are only allowed at document level
-            bool wellLocated = ( ToDocument() != 0 );
+            bool wellLocated = ( parent->ToDocument() != 0 );
             if ( wellLocated ) {
                 // Multiple declarations are allowed but all declarations
                 // must occur before anything else
@@ -1047,39 +1377,54 @@ char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
 
         XMLElement* ele = node->ToElement();
         if ( ele ) {
-            // We read the end tag. Return it to the parent.
             if ( ele->ClosingType() == XMLElement::CLOSING ) {
-                if ( parentEndTag ) {
-                    ele->_value.TransferTo( parentEndTag );
+                if ( parent == this ) {
+                    // We read the end tag of this node. Return it to the caller.
+                    if ( parentEndTag ) {
+                        ele->_value.TransferTo( parentEndTag );
+                    }
+                    node->_memPool->SetTracked();   // created and then immediately deleted.
+                    DeleteNode( node );
+                    return p;
                 }
-                node->_memPool->SetTracked();   // created and then immediately deleted.
+                // The end tag of the innermost open element.
+                XMLElement* open = parent->ToElement();
+                TIXMLASSERT( open );
+                const bool mismatch = !XMLUtil::StringEqual( ele->Name(), open->Name() );
+                node->_memPool->SetTracked();
                 DeleteNode( node );
-                return p;
-            }
-
-            // Handle an end tag returned to this level.
-            // And handle a bunch of annoying errors.
-            bool mismatch = false;
-            if ( endTag.Empty() ) {
-                if ( ele->ClosingType() == XMLElement::OPEN ) {
-                    mismatch = true;
+                if ( mismatch ) {
+                    _document->SetError( XML_ERROR_MISMATCHED_ELEMENT, open->Name(), 0, open->_parseLineNum);
+                    break;
                 }
+                parent = ancestors.Pop();
+                continue;
             }
-            else {
-                if ( ele->ClosingType() != XMLElement::OPEN ) {
-                    mismatch = true;
+            if ( ele->ClosingType() == XMLElement::OPEN ) {
+                // The content of the element is read next, at a new level. An
+                // open element at the very end of the document has no end tag.
+                if ( !*p ) {
+                    _document->SetError( XML_ERROR_MISMATCHED_ELEMENT, ele->Name(), 0, initialLineNum);
+                    DeleteNode( node );
+                    break;
                 }
-                else if ( !XMLUtil::StringEqual( endTag.GetStr(), ele->Name() ) ) {
-                    mismatch = true;
+                if ( ancestors.Size() >= _document->MaxElementDepth() ) {
+                    _document->SetError( XML_ELEMENT_DEPTH_EXCEEDED, ele->Name(), 0, initialLineNum);
+                    DeleteNode( node );
+                    break;
                 }
-            }
-            if ( mismatch ) {
-                _document->SetError( XML_ERROR_MISMATCHED_ELEMENT, ele->Name(), 0, initialLineNum);
-                DeleteNode( node );
-                break;
+                parent->InsertEndChild( node );
+                ancestors.Push( parent );
+                parent = node;
+                continue;
             }
         }
-        InsertEndChild( node );
+        parent->InsertEndChild( node );
+    }
+    // The document ended inside an element. Elements left open stay in the
+    // tree, which the document clears on error.
+    if ( parent != this && !_document->Error() ) {
+        _document->SetError( XML_ERROR_PARSING, 0, 0, parent->_parseLineNum);
     }
     return 0;
 }
@@ -1576,6 +1921,17 @@ const char* XMLElement::GetText() const
 }
 
 
+bool XMLElement::GetTextSpan( const char** text, size_t* length ) const
+{
+    const XMLNode* child = FirstChild();
+    if ( child && child->ToText() ) {
+        child->_value.GetSpan( text, length );
+        return true;
+    }
+    return false;
+}
+
+
 void	XMLElement::SetText( const char* inText )
 {
 	if ( FirstChild() && FirstChild()->ToText() )
@@ -1886,8 +2242,11 @@ XMLAttribute* XMLElement::CreateAttribute()
 //	<ele></ele>
 //	<ele>foo<b>bar</b></ele>
 //
-char* XMLElement::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
+char* XMLElement::ParseDeep( char* p, StrPair*, int* curLineNumPtr )
 {
+    // Reads the start (or end) tag only: the content is read by the
+    // XMLNode::ParseDeep of the document, which doesn't recurse.
+
     // Read the element name.
     p = XMLUtil::SkipWhiteSpace( p, curLineNumPtr );
 
@@ -1905,11 +2264,6 @@ char* XMLElement::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr
     }
 
     p = ParseAttributes( p, curLineNumPtr );
-    if ( !p || !*p || _closingType != OPEN ) {
-        return p;
-    }
-
-    p = XMLNode::ParseDeep( p, parentEndTag, curLineNumPtr );
     return p;
 }
 
@@ -1991,11 +2345,12 @@ const char* XMLDocument::_errorNames[XML_ERROR_COUNT] = {
     "XML_ERROR_MISMATCHED_ELEMENT",
     "XML_ERROR_PARSING",
     "XML_CAN_NOT_CONVERT_TEXT",
-    "XML_NO_TEXT_NODE"
+    "XML_NO_TEXT_NODE",
+    "XML_ELEMENT_DEPTH_EXCEEDED"
 };
 
 
-XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
+XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode, bool trackLines ) :
     XMLNode( 0 ),
     _writeBOM( false ),
     _processEntities( processEntities ),
@@ -2005,12 +2360,21 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
     _errorStr2(),
     _errorLineNum( 0 ),
     _charBuffer( 0 ),
+    _trackLines( trackLines ),
+    _maxElementDepth( TINYXML2_MAX_ELEMENT_DEPTH ),
     _parseCurLineNum( 0 ),
+    _poolBlockBytes( 4 * 1024 ),
+    _poolHugePages( false ),
     _unlinked(),
     _elementPool(),
     _attributePool(),
     _textPool(),
-    _commentPool()
+    _commentPool(),
+    _splitPrefix( 0 ),
+    _parseRunner( 0 ),
+    _parseChunks(),
+    _nextParseChunk( 0 ),
+    _chunkDocuments()
 {
     // avoid VC++ C4355 warning about 'this' in initializer list (C4355 is off by default in VS2012+)
     _document = this;
@@ -2020,6 +2384,9 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
 XMLDocument::~XMLDocument()
 {
     Clear();
+    while( !_chunkDocuments.Empty() ) {
+        delete _chunkDocuments.Pop();
+    }
 }
 
 
@@ -2042,6 +2409,10 @@ void XMLDocument::Clear()
 	while( _unlinked.Size()) {
 		DeleteNode(_unlinked[0]);	// Will remove from _unlinked as part of delete.
 	}
+    // Their nodes were the children of this document.
+    for ( int i = 0; i < _chunkDocuments.Size(); ++i ) {
+        _chunkDocuments[i]->Clear();
+    }
 
 #ifdef DEBUG
     const bool hadError = Error();
@@ -2066,6 +2437,52 @@ void XMLDocument::Clear()
         TIXMLASSERT( _commentPool.CurrentAllocs()   == _commentPool.Untracked() );
     }
 #endif
+
+    // Every object is freed: the blocks are kept for the next document.
+    _elementPool.Reset();
+    _attributePool.Reset();
+    _textPool.Reset();
+    _commentPool.Reset();
+}
+
+
+void XMLDocument::SetPoolBlockSize( size_t bytes, bool hugePages )
+{
+    _poolBlockBytes = bytes;
+    _poolHugePages = hugePages;
+    for ( int i = 0; i < _chunkDocuments.Size(); ++i ) {
+        _chunkDocuments[i]->SetPoolBlockSize( bytes, hugePages );
+    }
+    _elementPool.SetBlockSize( bytes, hugePages );
+    _attributePool.SetBlockSize( bytes, hugePages );
+    _textPool.SetBlockSize( bytes, hugePages );
+    _commentPool.SetBlockSize( bytes, hugePages );
+}
+
+
+XMLPoolStats XMLDocument::PoolStats() const
+{
+    XMLPoolStats stats;
+    _elementPool.AddStats( &stats );
+    _attributePool.AddStats( &stats );
+    _textPool.AddStats( &stats );
+    _commentPool.AddStats( &stats );
+    for ( int i = 0; i < _chunkDocuments.Size(); ++i ) {
+        const XMLPoolStats chunkStats = _chunkDocuments[i]->PoolStats();
+        stats.currentAllocs += chunkStats.currentAllocs;
+        stats.peakAllocs += chunkStats.peakAllocs;
+        stats.nAllocs += chunkStats.nAllocs;
+        stats.blocks += chunkStats.blocks;
+        stats.blockBytes += chunkStats.blockBytes;
+    }
+    return stats;
+}
+
+
+void XMLDocument::SetParallelParse( const char* splitPrefix, XMLTaskRunner* runner )
+{
+    _splitPrefix = splitPrefix;
+    _parseRunner = runner;
 }
 
 
@@ -2232,7 +2649,88 @@ XMLError XMLDocument::LoadFile( FILE* fp )
 
     _charBuffer[size] = 0;
 
-    Parse();
+    if ( !ParseSplit( size ) ) {
+        // The buffer was written in by the split parse: read it again.
+        fseek( fp, 0, SEEK_SET );
+        if ( fread( _charBuffer, 1, size, fp ) != size ) {
+            SetError( XML_ERROR_FILE_READ_ERROR, 0, 0, 0 );
+            return _errorID;
+        }
+        Parse();
+    }
+    return _errorID;
+}
+
+
+XMLError XMLDocument::LoadFile( XMLReader* reader )
+{
+    Clear();
+
+    if ( !reader->Rewind() ) {
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0, 0 );
+        return _errorID;
+    }
+    size_t capacity = reader->SizeHint();
+    if ( capacity == 0 || capacity == (size_t)-1 ) {
+        capacity = READER_BUFFER_SIZE;
+    }
+    TIXMLASSERT( _charBuffer == 0 );
+    _charBuffer = new char[capacity+1];
+    size_t size = 0;
+    while ( true ) {
+        size_t read = 0;
+        if ( size < capacity ) {
+            read = reader->Read( _charBuffer + size, capacity - size );
+        }
+        else {
+            // A full buffer is often the whole text: check for more before growing it.
+            char next[64];
+            read = reader->Read( next, sizeof( next ) );
+            if ( read != 0 && read != (size_t)-1 ) {
+                if ( capacity > ( (size_t)-1 - 1 ) / 2 - read ) {
+                    SetError( XML_ERROR_FILE_READ_ERROR, 0, 0, 0 );
+                    return _errorID;
+                }
+                capacity = capacity * 2 + read;
+                char* buffer = new char[capacity+1];
+                memcpy( buffer, _charBuffer, size );
+                memcpy( buffer + size, next, read );
+                delete [] _charBuffer;
+                _charBuffer = buffer;
+            }
+        }
+        if ( read == (size_t)-1 ) {
+            SetError( XML_ERROR_FILE_READ_ERROR, 0, 0, 0 );
+            return _errorID;
+        }
+        if ( read == 0 ) {
+            break;
+        }
+        size += read;
+    }
+
+    if ( size == 0 ) {
+        SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0, 0 );
+        return _errorID;
+    }
+    _charBuffer[size] = 0;
+
+    if ( !ParseSplit( size ) ) {
+        // The buffer was written in by the split parse: read it again.
+        size_t reread = 0;
+        if ( reader->Rewind() ) {
+            size_t read = 0;
+            while ( reread < size && ( read = reader->Read( _charBuffer + reread, size - reread ) ) != 0
+                    && read != (size_t)-1 ) {
+                reread += read;
+            }
+        }
+        if ( reread != size ) {
+            SetError( XML_ERROR_FILE_READ_ERROR, 0, 0, 0 );
+            return _errorID;
+        }
+        Parse();
+    }
     return _errorID;
 }
 
@@ -2277,16 +2775,19 @@ XMLError XMLDocument::Parse( const char* p, size_t len )
     memcpy( _charBuffer, p, len );
     _charBuffer[len] = 0;
 
-    Parse();
+    if ( !ParseSplit( len ) ) {
+        memcpy( _charBuffer, p, len );
+        Parse();
+    }
     if ( Error() ) {
         // clean up now essentially dangling memory.
         // and the parse fail can put objects in the
         // pools that are dead and inaccessible.
         DeleteChildren();
-        _elementPool.Clear();
-        _attributePool.Clear();
-        _textPool.Clear();
-        _commentPool.Clear();
+        _elementPool.Reset();
+        _attributePool.Reset();
+        _textPool.Reset();
+        _commentPool.Reset();
     }
     return _errorID;
 }
@@ -2368,16 +2869,212 @@ void XMLDocument::Parse()
 {
     TIXMLASSERT( NoChildren() ); // Clear() must have been called previously
     TIXMLASSERT( _charBuffer );
-    _parseCurLineNum = 1;
-    _parseLineNum = 1;
+    _parseCurLineNum = _trackLines ? 1 : 0;
+    _parseLineNum = _parseCurLineNum;
+    int* const curLineNumPtr = _trackLines ? &_parseCurLineNum : 0;
     char* p = _charBuffer;
-    p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+    p = XMLUtil::SkipWhiteSpace( p, curLineNumPtr );
     p = const_cast<char*>( XMLUtil::ReadBOM( p, &_writeBOM ) );
     if ( !*p ) {
         SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0, 0 );
         return;
     }
-    ParseDeep(p, 0, &_parseCurLineNum );
+    ParseDeep(p, 0, curLineNumPtr );
+}
+
+
+bool XMLDocument::ParseSplit( size_t length )
+{
+    TIXMLASSERT( _parseChunks.Empty() );
+    if ( _splitPrefix && _parseRunner && !_trackLines && _maxElementDepth > PARSE_CHUNK_DEPTH
+            && _parseRunner->Concurrency() > 1 ) {
+        FindParseChunks( length );
+    }
+    if ( _parseChunks.Empty() ) {
+        Parse();
+        return true;
+    }
+
+    while ( _chunkDocuments.Size() < _parseChunks.Size() ) {
+        XMLDocument* chunkDocument = new XMLDocument( _processEntities, _whitespaceMode, false );
+        chunkDocument->SetPoolBlockSize( _poolBlockBytes, _poolHugePages );
+        _chunkDocuments.Push( chunkDocument );
+    }
+    // A task can't parse past the end of its chunk.
+    for ( int i = 0; i < _parseChunks.Size(); ++i ) {
+        _parseChunks[i].endChar = *_parseChunks[i].end;
+        *_parseChunks[i].end = 0;
+    }
+    _parseRunner->Run( _parseChunks.Size(), ParseChunkTask, this );
+    for ( int i = 0; i < _parseChunks.Size(); ++i ) {
+        *_parseChunks[i].end = _parseChunks[i].endChar;
+    }
+
+    Parse();
+    const bool parsed = !Error() && _nextParseChunk == _parseChunks.Size();
+    if ( !parsed ) {
+        // Errors are reported by the plain parse, which is always right.
+        DeleteChildren();
+        ClearError();
+    }
+    ClearParseChunks();
+    return parsed;
+}
+
+
+void XMLDocument::FindParseChunks( size_t length )
+{
+    size_t chunkSize = length / ( (size_t)_parseRunner->Concurrency() * PARSE_CHUNKS_PER_TASK );
+    if ( chunkSize < MIN_PARSE_CHUNK_SIZE ) {
+        chunkSize = MIN_PARSE_CHUNK_SIZE;
+    }
+    const size_t prefixLength = strlen( _splitPrefix );
+
+    // Follows the markup the way parsing reads it, only tracking the depth of
+    // elements. Chunks end after an element followed by white space, where a
+    // null character stops the task. When the document isn't what this sees,
+    // the chunks are missed by the parse, which then starts over.
+    ParseChunk chunk = { 0, 0, 0, false };
+    bool splitParent = false;	// the open element at PARSE_CHUNK_DEPTH - 1 is split
+    int depth = 0;
+    char* p = _charBuffer;
+    while ( ( p = strchr( p, '<' ) ) != 0 ) {
+        char* next = 0;
+        char* elementEnd = 0;	// of an element at PARSE_CHUNK_DEPTH in a split parent
+        if ( p[1] == '?' ) {
+            next = strstr( p + 2, "?>" );
+            next = next ? next + 2 : 0;
+        }
+        else if ( strncmp( p, "<!--", 4 ) == 0 ) {
+            next = strstr( p + 4, "-->" );
+            next = next ? next + 3 : 0;
+        }
+        else if ( strncmp( p, "<![CDATA[", 9 ) == 0 ) {
+            next = strstr( p + 9, "]]>" );
+            next = next ? next + 3 : 0;
+        }
+        else if ( p[1] == '!' ) {
+            next = strchr( p + 2, '>' );
+            next = next ? next + 1 : 0;
+        }
+        else if ( p[1] == '/' ) {
+            next = strchr( p + 2, '>' );
+            if ( !next || --depth < 0 ) {
+                break;
+            }
+            ++next;
+            if ( depth == PARSE_CHUNK_DEPTH && splitParent ) {
+                elementEnd = next;
+            }
+            else if ( depth == PARSE_CHUNK_DEPTH - 1 && splitParent ) {
+                // The rest of the children go with the last chunk, or are parsed in place.
+                if ( chunk.end && chunk.end - chunk.start >= (ptrdiff_t)MIN_PARSE_CHUNK_SIZE ) {
+                    _parseChunks.Push( chunk );
+                }
+                chunk.start = chunk.end = 0;
+                splitParent = false;
+            }
+        }
+        else {
+            // A start tag, whose quoted attribute values may hold '>'.
+            char* q = p + 1;
+            while ( q && *q && *q != '>' ) {
+                if ( *q == DOUBLE_QUOTE || *q == SINGLE_QUOTE ) {
+                    q = strchr( q + 1, *q );
+                    if ( !q ) {
+                        break;
+                    }
+                }
+                ++q;
+            }
+            if ( !q || !*q ) {
+                break;
+            }
+            next = q + 1;
+            const bool closed = q[-1] == '/';
+            if ( depth == PARSE_CHUNK_DEPTH - 1 ) {
+                splitParent = !closed && strncmp( p + 1, _splitPrefix, prefixLength ) == 0;
+            }
+            else if ( depth == PARSE_CHUNK_DEPTH && splitParent ) {
+                if ( !chunk.start ) {
+                    chunk.start = p;
+                }
+                if ( closed ) {
+                    elementEnd = next;
+                }
+            }
+            if ( !closed ) {
+                ++depth;
+            }
+        }
+        if ( !next ) {
+            break;
+        }
+        if ( elementEnd && XMLUtil::IsWhiteSpace( *elementEnd ) ) {
+            chunk.end = elementEnd;
+            if ( chunk.end - chunk.start >= (ptrdiff_t)chunkSize ) {
+                _parseChunks.Push( chunk );
+                chunk.start = chunk.end = 0;
+            }
+        }
+        p = next;
+    }
+}
+
+
+void XMLDocument::ClearParseChunks()
+{
+    for ( int i = 0; i < _parseChunks.Size(); ++i ) {
+        XMLDocument* chunkDocument = _chunkDocuments[i];
+        if ( _parseChunks[i].parsed ) {
+            // Nodes the parse didn't take, which already belong to this document.
+            XMLNode* node = chunkDocument->_firstChild;
+            chunkDocument->_firstChild = chunkDocument->_lastChild = 0;
+            while ( node ) {
+                XMLNode* next = node->_next;
+                node->_parent = 0;
+                node->_prev = node->_next = 0;
+                XMLNode::DeleteNode( node );
+                node = next;
+            }
+        }
+        else {
+            chunkDocument->Clear();
+        }
+    }
+    _parseChunks.Clear();
+    _nextParseChunk = 0;
+}
+
+
+void XMLDocument::ParseChunkTask( void* context, int index )
+{
+    XMLDocument* const document = static_cast<XMLDocument*>( context );
+    ParseChunk& chunk = document->_parseChunks[index];
+    XMLDocument* const chunkDocument = document->_chunkDocuments[index];
+    chunk.parsed = false;
+    // A null character in the chunk would end the document there.
+    if ( strlen( chunk.start ) != (size_t)( chunk.end - chunk.start ) ) {
+        return;
+    }
+    // The chunk is parsed as the top level of its document, where it has
+    // PARSE_CHUNK_DEPTH ancestors less.
+    chunkDocument->_maxElementDepth = document->_maxElementDepth - PARSE_CHUNK_DEPTH;
+    if ( chunkDocument->XMLNode::ParseDeep( chunk.start, 0, 0 ) || chunkDocument->Error() ) {
+        return;
+    }
+    for ( XMLNode* node = chunkDocument->_firstChild; node; ) {
+        node->_document = document;
+        if ( node->_firstChild ) {
+            node = node->_firstChild;
+            continue;
+        }
+        while ( !node->_next && node->_parent != chunkDocument ) {
+            node = node->_parent;
+        }
+        node = node->_next;
+    }
+    chunk.parsed = true;
 }
 
 XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
@@ -0,0 +1,383 @@
+#include <batch.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#include <batch_io.hxx>
+#include <compression.hxx>
+
+namespace {
+
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+};
+
+// Takes the largest job of the worker's own queue, or else the smallest job of the first other queue that has any.
+// Jobs are never added once the workers run, so all queues being empty means the batch is done.
+bool take_job(std::vector<WorkerQueue>& queues, const std::size_t worker, std::size_t& job, bool& stolen) {
+    {
+        const std::lock_guard lock{queues[worker].mutex};
+        if(!queues[worker].jobs.empty()) {
+            job = queues[worker].jobs.front();
+            queues[worker].jobs.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+    for(std::size_t offset{1}; offset < queues.size(); ++offset) {
+        auto& victim = queues[(worker + offset) % queues.size()];
+        const std::lock_guard lock{victim.mutex};
+        if(!victim.jobs.empty()) {
+            job = victim.jobs.back();
+            victim.jobs.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The job take_job would give the worker next, if its own queue has any.
+bool peek_job(std::vector<WorkerQueue>& queues, const std::size_t worker, std::size_t& job) {
+    const std::lock_guard lock{queues[worker].mutex};
+    if(queues[worker].jobs.empty()) {
+        return false;
+    }
+    job = queues[worker].jobs.front();
+    return true;
+}
+
+// Converts a source read into memory to the bytes of its output, freeing the text once parsed. Returns what convert
+// would.
+int convert_text(tinyxml2::XMLDocument& collada_file, IoBuffer&& text, const std::string_view input_file_name,
+        const ConversionOptions& options, std::pmr::string& obm_bytes) {
+    const ParallelParseScope parallel_parse_scope{collada_file, options};
+    const auto parse_error = collada_file.Parse(text.bytes.get(), text.size);
+    text = {};
+    if(parse_error != tinyxml2::XMLError::XML_SUCCESS) {
+        report(options, "Failed to open collada source file \"", input_file_name, "\".\n");
+        return 1;
+    }
+    return convert_pipelined(collada_file, input_file_name, options, [&](const std::string_view bytes) {
+        obm_bytes.append(bytes.data(), bytes.size());
+        return true;
+    });
+}
+
+// The deepest directory both absolute paths are in.
+std::filesystem::path common_directory(const std::filesystem::path& lhs, const std::filesystem::path& rhs) {
+    std::filesystem::path directory{};
+    for(auto lhs_part = lhs.begin(), rhs_part = rhs.begin(); lhs_part != lhs.end() && rhs_part != rhs.end()
+            && *lhs_part == *rhs_part; ++lhs_part, ++rhs_part) {
+        directory /= *lhs_part;
+    }
+    return directory;
+}
+
+void mark_duplicate_outputs(std::vector<BatchJob>& jobs) {
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), std::size_t{});
+    std::sort(order.begin(), order.end(), [&](const std::size_t lhs, const std::size_t rhs) {
+        return jobs[lhs].output_file_name < jobs[rhs].output_file_name;
+    });
+    for(std::size_t i{1}; i < order.size(); ++i) {
+        if(jobs[order[i]].output_file_name == jobs[order[i - 1]].output_file_name) {
+            jobs[order[i]].duplicate_output = true;
+            jobs[order[i - 1]].duplicate_output = true;
+        }
+    }
+}
+
+} // namespace
+
+std::string output_file_name_for(const std::filesystem::path& input_path, const std::filesystem::path& source_directory,
+        const std::filesystem::path& output_directory) {
+    auto output_path = output_directory
+            / without_compression_extension(input_path.lexically_relative(source_directory));
+    output_path.replace_extension(".obm");
+    return output_path.string();
+}
+
+bool collect_batch_jobs(const std::string_view source, const std::string_view output_directory,
+        std::vector<BatchJob>& jobs) {
+    namespace fs = std::filesystem;
+    std::error_code error{};
+    const fs::path source_path{source};
+    const fs::path output_path{output_directory};
+    if(fs::is_directory(source_path, error)) {
+        for(fs::recursive_directory_iterator entry{source_path, error}, end{}; !error && entry != end;
+                entry.increment(error)) {
+            if(entry->is_regular_file(error) && is_collada_file_name(entry->path())) {
+                jobs.push_back({entry->path().string(), output_file_name_for(entry->path(), source_path, output_path),
+                        entry->file_size(error)});
+            }
+        }
+    } else {
+        std::ifstream manifest{source_path};
+        if(!manifest.is_open()) {
+            return false;
+        }
+        std::vector<std::pair<std::string, fs::path>> entries{};
+        fs::path base_directory{};
+        std::string line{};
+        while(std::getline(manifest, line)) {
+            if(!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if(line.empty()) {
+                continue;
+            }
+            auto input_path = fs::absolute(line, error).lexically_normal();
+            const auto directory = input_path.parent_path();
+            base_directory = entries.empty() ? directory : common_directory(base_directory, directory);
+            entries.emplace_back(std::move(line), std::move(input_path));
+        }
+        for(auto& [input_file_name, input_path] : entries) {
+            const auto input_size = fs::file_size(input_path, error);
+            jobs.push_back({std::move(input_file_name), output_file_name_for(input_path, base_directory, output_path),
+                    error ? 0 : input_size});
+        }
+        error.clear();
+    }
+    mark_duplicate_outputs(jobs);
+    return !error;
+}
+
+void select_shard(std::vector<BatchJob>& jobs, const std::size_t shard_index, const std::size_t shards_count) {
+    std::sort(jobs.begin(), jobs.end(), [](const BatchJob& lhs, const BatchJob& rhs) {
+        return lhs.input_size != rhs.input_size ? lhs.input_size > rhs.input_size
+                : lhs.input_file_name < rhs.input_file_name;
+    });
+    std::vector<std::uintmax_t> shard_sizes(shards_count);
+    std::vector<BatchJob> shard_jobs{};
+    for(auto& job : jobs) {
+        const auto shard = static_cast<std::size_t>(std::min_element(shard_sizes.begin(), shard_sizes.end())
+                - shard_sizes.begin());
+        shard_sizes[shard] += job.input_size;
+        if(shard == shard_index) {
+            shard_jobs.emplace_back(std::move(job));
+        }
+    }
+    jobs = std::move(shard_jobs);
+}
+
+int convert_batch(const std::vector<BatchJob>& jobs, const ConversionOptions& options, ConversionCache* cache,
+        BatchIo* io, BatchSummary& summary) {
+    if(cache != nullptr || options.restat) {
+        io = nullptr;
+    }
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), std::size_t{});
+    std::stable_sort(order.begin(), order.end(), [&](const std::size_t lhs, const std::size_t rhs) {
+        return jobs[lhs].input_size > jobs[rhs].input_size;
+    });
+    const auto workers_count = std::max<std::size_t>(std::min(options.threads_count, jobs.size()), 1);
+    // Dealing the sorted jobs round robin leaves every queue sorted largest first.
+    std::vector<WorkerQueue> queues(workers_count);
+    for(std::size_t i{}; i < order.size(); ++i) {
+        queues[i % workers_count].jobs.push_back(order[i]);
+    }
+    std::vector<int> results(jobs.size());
+    std::vector<std::size_t> stolen_counts(workers_count);
+    auto job_options = options;
+    job_options.threads_count = 1;
+    const auto report_failure = [&](const std::size_t job) {
+        std::cerr << "Failed to convert \"" + jobs[job].input_file_name + "\" (error " + std::to_string(results[job])
+                + ").\n";
+    };
+    // Reads started ahead by the worker owning the job, which another worker may end up stealing.
+    constexpr auto NOT_READ = static_cast<std::size_t>(-1);
+    std::mutex read_tickets_mutex{};
+    std::vector<std::size_t> read_tickets(io != nullptr ? jobs.size() : 0, NOT_READ);
+    const auto start_read = [&](const std::size_t job) {
+        const std::lock_guard lock{read_tickets_mutex};
+        if(read_tickets[job] == NOT_READ) {
+            read_tickets[job] = io->read(jobs[job].input_file_name);
+        }
+        return read_tickets[job];
+    };
+
+    const auto run_worker = [&](const std::size_t worker) {
+        tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+        configure_document(collada_file);
+        std::size_t job{};
+        bool stolen{};
+        while(take_job(queues, worker, job, stolen)) {
+            std::error_code error{};
+            const auto& [input_file_name, output_file_name, input_size, duplicate_output] = jobs[job];
+            std::filesystem::create_directories(std::filesystem::path{output_file_name}.parent_path(), error);
+            int result{};
+            if(duplicate_output) {
+                report(job_options, "Output file \"", output_file_name, "\" is also the output of another source.\n");
+                result = 8;
+            } else if(io != nullptr) {
+                const auto ticket = start_read(job);
+                std::size_t next_job{};
+                if(peek_job(queues, worker, next_job)) {
+                    start_read(next_job);
+                }
+                IoBuffer text{};
+                std::pmr::string obm_bytes{};
+                if(!io->take(ticket, text)) {
+                    report(job_options, "Failed to open collada source file \"", input_file_name, "\".\n");
+                    result = 1;
+                } else if(compression_of_bytes({text.bytes.get(), text.size}) != SourceCompression::none) {
+                    // Compressed sources are decompressed from their file, which reads ahead by itself.
+                    text = {};
+                    result = convert(collada_file, input_file_name, output_file_name, job_options);
+                } else {
+                    result = convert_text(collada_file, std::move(text), input_file_name, job_options, obm_bytes);
+                }
+                // The job only converted once its output is written, which the I/O thread tells on completion.
+                if(result == 0 && !obm_bytes.empty()) {
+                    io->write(output_file_name, std::move(obm_bytes), [&, job](const bool written) {
+                        if(!written) {
+                            report(job_options, "Failed to write to file \"", jobs[job].output_file_name, "\".\n");
+                            results[job] = 7;
+                            report_failure(job);
+                        }
+                    });
+                }
+            } else {
+                result = cache != nullptr
+                        ? convert_cached(*cache, collada_file, input_file_name, output_file_name, job_options)
+                        : convert(collada_file, input_file_name, output_file_name, job_options);
+            }
+            collada_file.Clear();
+            // Results start at 0, which only a failed write changes afterwards.
+            if(result != 0) {
+                results[job] = result;
+                report_failure(job);
+            }
+            stolen_counts[worker] += stolen;
+        }
+    };
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers{};
+    for(std::size_t worker{1}; worker < workers_count; ++worker) {
+        workers.emplace_back(run_worker, worker);
+    }
+    run_worker(0);
+    for(auto& worker : workers) {
+        worker.join();
+    }
+    if(io != nullptr) {
+        io->drain();
+    }
+    const std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+    summary = {};
+    summary.files_count = jobs.size();
+    summary.seconds = elapsed_time.count();
+    for(const auto stolen_count : stolen_counts) {
+        summary.stolen_count += stolen_count;
+    }
+    if(cache != nullptr) {
+        summary.cache_hits = cache->hits;
+        summary.cache_misses = cache->misses;
+    }
+    for(std::size_t job{}; job < jobs.size(); ++job) {
+        if(results[job] == 0) {
+            ++summary.converted_count;
+            summary.converted_bytes += jobs[job].input_size;
+        } else {
+            ++summary.failed_count;
+            summary.failures.emplace_back(results[job], jobs[job].input_file_name);
+        }
+    }
+    return summary.failures.empty() ? 0 : summary.failures.front().first;
+}
+
+void print_batch_summary(const BatchSummary& summary) {
+    const auto seconds = std::max(summary.seconds, 1e-9);
+    std::cout << "Converted " << summary.converted_count << " of " << summary.files_count << " files ("
+            << static_cast<double>(summary.converted_bytes) / 1e6 << " MB) in " << summary.seconds << "s";
+    if(summary.shards_count > 1) {
+        std::cout << " on " << summary.shards_count << " shards";
+    }
+    std::cout << ": " << static_cast<double>(summary.converted_count) / seconds << " files/s, "
+            << static_cast<double>(summary.converted_bytes) / 1e6 / seconds << " MB/s, " << summary.failed_count
+            << " failed, " << summary.stolen_count << " stolen";
+    if(summary.cache_hits + summary.cache_misses != 0) {
+        std::cout << ", " << summary.cache_hits << " cache hits, " << summary.cache_misses << " cache misses";
+    }
+    std::cout << ".\n";
+}
+
+bool write_batch_summary(const std::string_view file_name, const BatchSummary& summary) {
+    std::ofstream file{std::string{file_name}};
+    file << "shards " << summary.shards_count << "\nfiles " << summary.files_count << "\nconverted "
+            << summary.converted_count << "\nfailed " << summary.failed_count << "\nstolen " << summary.stolen_count
+            << "\nbytes " << summary.converted_bytes << "\ncache_hits " << summary.cache_hits << "\ncache_misses "
+            << summary.cache_misses << "\nseconds " << summary.seconds << '\n';
+    for(const auto& [error, input_file_name] : summary.failures) {
+        file << "failure " << error << ' ' << input_file_name << '\n';
+    }
+    return file.good();
+}
+
+bool read_batch_summary(const std::string_view file_name, BatchSummary& summary) {
+    std::ifstream file{std::string{file_name}};
+    if(!file.is_open()) {
+        return false;
+    }
+    summary = {};
+    std::string line{};
+    while(std::getline(file, line)) {
+        std::istringstream fields{line};
+        std::string key{};
+        fields >> key;
+        if(key == "shards") {
+            fields >> summary.shards_count;
+        } else if(key == "files") {
+            fields >> summary.files_count;
+        } else if(key == "converted") {
+            fields >> summary.converted_count;
+        } else if(key == "failed") {
+            fields >> summary.failed_count;
+        } else if(key == "stolen") {
+            fields >> summary.stolen_count;
+        } else if(key == "bytes") {
+            fields >> summary.converted_bytes;
+        } else if(key == "cache_hits") {
+            fields >> summary.cache_hits;
+        } else if(key == "cache_misses") {
+            fields >> summary.cache_misses;
+        } else if(key == "seconds") {
+            fields >> summary.seconds;
+        } else if(key == "failure") {
+            auto& [error, input_file_name] = summary.failures.emplace_back();
+            fields >> error;
+            fields.get();
+            std::getline(fields, input_file_name);
+        } else if(!key.empty()) {
+            return false;
+        }
+        if(fields.fail()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void merge_batch_summaries(const BatchSummary& summary, BatchSummary& merged_summary) {
+    merged_summary.shards_count += summary.shards_count;
+    merged_summary.files_count += summary.files_count;
+    merged_summary.converted_count += summary.converted_count;
+    merged_summary.failed_count += summary.failed_count;
+    merged_summary.stolen_count += summary.stolen_count;
+    merged_summary.converted_bytes += summary.converted_bytes;
+    merged_summary.cache_hits += summary.cache_hits;
+    merged_summary.cache_misses += summary.cache_misses;
+    merged_summary.seconds = std::max(merged_summary.seconds, summary.seconds);
+    merged_summary.failures.insert(merged_summary.failures.end(), summary.failures.begin(), summary.failures.end());
+}
@@ -0,0 +1,581 @@
+#include <batch_io.hxx>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A whole file to read or write, split into chunk requests by the I/O thread.
+struct FileRequest {
+    std::string file_name{};
+    bool write{};
+    // Written under a temporary name then renamed, unless the file exists and is not regular.
+    bool in_place{};
+    bool opened{};
+    bool direct{};
+    bool failed{};
+    // Set once the I/O thread is done with the file, under the mutex of the state.
+    bool complete{};
+    int descriptor{-1};
+    std::uint64_t size{};
+    // Offset of the next chunk to request.
+    std::uint64_t next_offset{};
+    std::size_t chunks_in_flight{};
+    // The bytes read, or the bytes to write.
+    IoBuffer buffer{};
+    std::pmr::string bytes{};
+    std::function<void(bool)> done{};
+};
+
+// A transfer between one chunk buffer and a file, or what is left of it after a short transfer.
+struct ChunkRequest {
+    FileRequest* file{};
+    std::uint64_t offset{};
+    // Bytes of the file to transfer, and the length requested, which O_DIRECT rounds up to IO_ALIGNMENT.
+    std::size_t size{};
+    std::size_t length{};
+    std::size_t buffer_offset{};
+};
+
+std::size_t round_up_to_alignment(const std::size_t size) {
+    return (size + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+}
+
+std::string temporary_file_name(const FileRequest& file) {
+    return file.file_name + ".part";
+}
+
+#ifdef __linux__
+
+// An io_uring instance set up with the raw system calls, with its submission and completion rings mapped.
+struct Ring {
+    Ring() = default;
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    ~Ring();
+
+    bool set_up(const unsigned entries_count);
+    bool register_buffers(const std::vector<iovec>& buffers);
+    // Adds the entry to the submission ring, for the kernel to take on the next enter.
+    void queue(const io_uring_sqe& entry);
+    // Submits the queued entries and waits for a completion. Returns 0, or the error of the system call, the entries
+    // the kernel did not take being backed out of the submission ring and their user data added to failed_entries.
+    int submit_and_wait(std::vector<std::uint64_t>& failed_entries);
+    // Calls handle with the user data and result of every completion, then releases them to the kernel.
+    template<typename Handle>
+    void reap(Handle&& handle);
+
+    int descriptor{-1};
+    io_uring_params params{};
+    void* submission_ring{MAP_FAILED};
+    std::size_t submission_ring_size{};
+    void* completion_ring{MAP_FAILED};
+    std::size_t completion_ring_size{};
+    void* entries_map{MAP_FAILED};
+    std::size_t entries_map_size{};
+    io_uring_sqe* entries{};
+    unsigned* submission_tail{};
+    unsigned* submission_mask{};
+    unsigned* submission_array{};
+    unsigned* completion_head{};
+    unsigned* completion_tail{};
+    unsigned* completion_mask{};
+    io_uring_cqe* completions{};
+    // Entries queued since the last enter.
+    unsigned queued_count{};
+};
+
+Ring::~Ring() {
+    if(entries_map != MAP_FAILED) {
+        munmap(entries_map, entries_map_size);
+    }
+    if(completion_ring != MAP_FAILED && completion_ring != submission_ring) {
+        munmap(completion_ring, completion_ring_size);
+    }
+    if(submission_ring != MAP_FAILED) {
+        munmap(submission_ring, submission_ring_size);
+    }
+    if(descriptor >= 0) {
+        close(descriptor);
+    }
+}
+
+bool Ring::set_up(const unsigned entries_count) {
+    descriptor = static_cast<int>(syscall(__NR_io_uring_setup, entries_count, &params));
+    if(descriptor < 0) {
+        return false;
+    }
+    submission_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completion_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // Kernels with a single mapping for both rings map it at the submission ring offset.
+    const auto single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single_map) {
+        submission_ring_size = completion_ring_size = std::max(submission_ring_size, completion_ring_size);
+    }
+    submission_ring = mmap(nullptr, submission_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            descriptor, IORING_OFF_SQ_RING);
+    if(submission_ring == MAP_FAILED) {
+        return false;
+    }
+    completion_ring = single_map ? submission_ring : mmap(nullptr, completion_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+    if(completion_ring == MAP_FAILED) {
+        return false;
+    }
+    entries_map_size = params.sq_entries * sizeof(io_uring_sqe);
+    entries_map = mmap(nullptr, entries_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor,
+            IORING_OFF_SQES);
+    if(entries_map == MAP_FAILED) {
+        return false;
+    }
+    const auto submission_bytes = static_cast<char*>(submission_ring);
+    const auto completion_bytes = static_cast<char*>(completion_ring);
+    entries = static_cast<io_uring_sqe*>(entries_map);
+    submission_tail = reinterpret_cast<unsigned*>(submission_bytes + params.sq_off.tail);
+    submission_mask = reinterpret_cast<unsigned*>(submission_bytes + params.sq_off.ring_mask);
+    submission_array = reinterpret_cast<unsigned*>(submission_bytes + params.sq_off.array);
+    completion_head = reinterpret_cast<unsigned*>(completion_bytes + params.cq_off.head);
+    completion_tail = reinterpret_cast<unsigned*>(completion_bytes + params.cq_off.tail);
+    completion_mask = reinterpret_cast<unsigned*>(completion_bytes + params.cq_off.ring_mask);
+    completions = reinterpret_cast<io_uring_cqe*>(completion_bytes + params.cq_off.cqes);
+    return true;
+}
+
+bool Ring::register_buffers(const std::vector<iovec>& buffers) {
+    return syscall(__NR_io_uring_register, descriptor, IORING_REGISTER_BUFFERS, buffers.data(),
+            static_cast<unsigned>(buffers.size())) == 0;
+}
+
+void Ring::queue(const io_uring_sqe& entry) {
+    // Only this thread moves the tail, which the kernel reads once the entry is written.
+    const auto tail = *submission_tail;
+    const auto index = tail & *submission_mask;
+    entries[index] = entry;
+    submission_array[index] = index;
+    __atomic_store_n(submission_tail, tail + 1, __ATOMIC_RELEASE);
+    ++queued_count;
+}
+
+int Ring::submit_and_wait(std::vector<std::uint64_t>& failed_entries) {
+    while(true) {
+        const auto submitted = syscall(__NR_io_uring_enter, descriptor, queued_count, 1u, IORING_ENTER_GETEVENTS,
+                nullptr, 0);
+        if(submitted >= 0) {
+            queued_count -= static_cast<unsigned>(submitted);
+            if(queued_count == 0) {
+                return 0;
+            }
+            continue;
+        }
+        const auto error = errno;
+        if(error == EINTR || error == EAGAIN || error == EBUSY) {
+            continue;
+        }
+        const auto tail = *submission_tail;
+        for(auto entry = tail - queued_count; entry != tail; ++entry) {
+            failed_entries.push_back(entries[submission_array[entry & *submission_mask]].user_data);
+        }
+        __atomic_store_n(submission_tail, tail - queued_count, __ATOMIC_RELEASE);
+        queued_count = 0;
+        return error;
+    }
+}
+
+template<typename Handle>
+void Ring::reap(Handle&& handle) {
+    auto head = *completion_head;
+    const auto tail = __atomic_load_n(completion_tail, __ATOMIC_ACQUIRE);
+    for(; head != tail; ++head) {
+        const auto& completion = completions[head & *completion_mask];
+        handle(completion.user_data, completion.res);
+    }
+    __atomic_store_n(completion_head, head, __ATOMIC_RELEASE);
+}
+
+#endif
+
+} // namespace
+
+struct BatchIoState {
+    BatchIoOptions options{};
+    std::mutex mutex{};
+    // Wakes the I/O thread when files are queued or the state is destroyed.
+    std::condition_variable queued{};
+    // Wakes take and drain when the I/O thread is done with a file.
+    std::condition_variable completed{};
+    std::deque<std::shared_ptr<FileRequest>> pending{};
+    std::unordered_map<std::size_t, std::shared_ptr<FileRequest>> reads{};
+    std::size_t next_ticket{};
+    // Files queued and not complete yet.
+    std::size_t files_pending{};
+    bool stopping{};
+    // Copied from counters under the mutex whenever a file completes.
+    BatchIoStats published_stats{};
+
+    // Owned by the I/O thread.
+    std::vector<std::shared_ptr<FileRequest>> active{};
+    std::unique_ptr<char, decltype(&std::free)> buffers{nullptr, &std::free};
+    std::vector<ChunkRequest> chunks{};
+    std::vector<std::size_t> free_chunks{};
+    std::size_t chunks_in_flight{};
+    BatchIoStats counters{};
+#ifdef __linux__
+    Ring ring{};
+    std::vector<std::uint64_t> failed_entries{};
+#endif
+    std::thread thread{};
+};
+
+namespace {
+
+char* chunk_buffer(BatchIoState& state, const std::size_t chunk) {
+    return state.buffers.get() + chunk * IO_CHUNK_BYTES;
+}
+
+bool open_file(BatchIoState& state, FileRequest& file) {
+    auto flags = O_CLOEXEC | (file.write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY);
+    struct stat status{};
+    file.in_place = file.write && stat(file.file_name.c_str(), &status) == 0 && !S_ISREG(status.st_mode);
+    const auto opened_file_name = file.write && !file.in_place ? temporary_file_name(file) : file.file_name;
+#ifdef O_DIRECT
+    // Devices written in place keep their own rules: only files are opened direct, and padded then truncated.
+    if(state.options.direct && !file.in_place) {
+        file.descriptor = open(opened_file_name.c_str(), flags | O_DIRECT, 0666);
+        file.direct = file.descriptor >= 0;
+    }
+#endif
+    if(file.descriptor < 0) {
+        file.descriptor = open(opened_file_name.c_str(), flags, 0666);
+    }
+    if(file.descriptor < 0) {
+        return false;
+    }
+    if(file.write) {
+        file.size = file.bytes.size();
+        return true;
+    }
+    if(fstat(file.descriptor, &status) != 0) {
+        return false;
+    }
+    file.size = static_cast<std::uint64_t>(status.st_size);
+    file.buffer.bytes.reset(new char[file.size]);
+    file.buffer.size = file.size;
+    return true;
+}
+
+void complete_chunk(BatchIoState& state, const std::size_t chunk, const long long result);
+
+void start_chunk(BatchIoState& state, const std::size_t chunk) {
+    auto& request = state.chunks[chunk];
+    auto& file = *request.file;
+    const auto buffer = chunk_buffer(state, chunk) + request.buffer_offset;
+    ++state.chunks_in_flight;
+    ++state.counters.requests_count;
+    state.counters.depth_sum += state.chunks_in_flight;
+    state.counters.max_depth = std::max(state.counters.max_depth, state.chunks_in_flight);
+#ifdef __linux__
+    if(state.counters.backend == IoBackend::io_uring) {
+        io_uring_sqe entry{};
+        const auto fixed = state.counters.registered_buffers;
+        entry.opcode = file.write ? (fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE)
+                : (fixed ? IORING_OP_READ_FIXED : IORING_OP_READ);
+        entry.fd = file.descriptor;
+        entry.off = request.offset;
+        entry.addr = reinterpret_cast<std::uintptr_t>(buffer);
+        entry.len = static_cast<std::uint32_t>(request.length);
+        entry.buf_index = static_cast<std::uint16_t>(fixed ? chunk : 0);
+        entry.user_data = chunk;
+        state.ring.queue(entry);
+        return;
+    }
+#endif
+    const auto offset = static_cast<off_t>(request.offset);
+    const auto result = file.write ? pwrite(file.descriptor, buffer, request.length, offset)
+            : pread(file.descriptor, buffer, request.length, offset);
+    complete_chunk(state, chunk, result < 0 ? -errno : result);
+}
+
+void complete_chunk(BatchIoState& state, const std::size_t chunk, const long long result) {
+    auto& request = state.chunks[chunk];
+    auto& file = *request.file;
+    --state.chunks_in_flight;
+    // Nothing transferred is a failure too: the file ends before the size it had when opened.
+    if(result <= 0) {
+        file.failed = true;
+    } else {
+        const auto transferred = std::min(static_cast<std::size_t>(result), request.size);
+        if(file.write) {
+            state.counters.bytes_written += transferred;
+        } else {
+            std::memcpy(file.buffer.bytes.get() + request.offset, chunk_buffer(state, chunk) + request.buffer_offset,
+                    transferred);
+            state.counters.bytes_read += transferred;
+        }
+        if(transferred < request.size) {
+            // The rest of a short transfer is requested again from where it stopped, which O_DIRECT refuses unless
+            // it stopped on a block.
+            request.offset += transferred;
+            request.buffer_offset += transferred;
+            request.size -= transferred;
+            request.length = file.direct ? round_up_to_alignment(request.size) : request.size;
+            start_chunk(state, chunk);
+            return;
+        }
+    }
+    --file.chunks_in_flight;
+    state.free_chunks.push_back(chunk);
+}
+
+void submit_chunks(BatchIoState& state) {
+    for(const auto& file : state.active) {
+        if(state.free_chunks.empty()) {
+            break;
+        }
+        if(!file->opened) {
+            file->opened = true;
+            file->failed = !open_file(state, *file);
+            ++state.counters.files_count;
+            state.counters.direct_files_count += file->direct;
+        }
+        while(!file->failed && file->next_offset < file->size && !state.free_chunks.empty()) {
+            const auto chunk = state.free_chunks.back();
+            state.free_chunks.pop_back();
+            auto& request = state.chunks[chunk];
+            request.file = file.get();
+            request.offset = file->next_offset;
+            request.size = static_cast<std::size_t>(std::min<std::uint64_t>(IO_CHUNK_BYTES, file->size
+                    - file->next_offset));
+            request.length = file->direct ? round_up_to_alignment(request.size) : request.size;
+            request.buffer_offset = 0;
+            if(file->write) {
+                const auto buffer = chunk_buffer(state, chunk);
+                std::memcpy(buffer, file->bytes.data() + request.offset, request.size);
+                std::memset(buffer + request.size, 0, request.length - request.size);
+            }
+            file->next_offset += request.size;
+            ++file->chunks_in_flight;
+            start_chunk(state, chunk);
+        }
+    }
+}
+
+void wait_for_chunks(BatchIoState& state) {
+#ifdef __linux__
+    if(state.counters.backend != IoBackend::io_uring || state.chunks_in_flight == 0) {
+        return;
+    }
+    const auto error = state.ring.submit_and_wait(state.failed_entries);
+    if(error != 0) {
+        for(const auto chunk : state.failed_entries) {
+            complete_chunk(state, static_cast<std::size_t>(chunk), -error);
+        }
+        state.failed_entries.clear();
+    }
+    state.ring.reap([&](const std::uint64_t chunk, const int result) {
+        complete_chunk(state, static_cast<std::size_t>(chunk), result);
+    });
+#else
+    static_cast<void>(state);
+#endif
+}
+
+void finish_file(BatchIoState& state, FileRequest& file) {
+    if(file.descriptor >= 0) {
+        // The padding of the last direct write is cut off.
+        if(file.write && !file.failed && file.direct && file.size % IO_ALIGNMENT != 0
+                && ftruncate(file.descriptor, static_cast<off_t>(file.size)) != 0) {
+            file.failed = true;
+        }
+        if(close(file.descriptor) != 0 && file.write) {
+            file.failed = true;
+        }
+        file.descriptor = -1;
+    }
+    if(file.write) {
+        if(!file.in_place) {
+            const auto temporary_name = temporary_file_name(file);
+            if(!file.failed && std::rename(temporary_name.c_str(), file.file_name.c_str()) != 0) {
+                file.failed = true;
+            }
+            if(file.failed) {
+                std::remove(temporary_name.c_str());
+            }
+        }
+        file.bytes = {};
+        file.done(!file.failed);
+    }
+    const std::lock_guard lock{state.mutex};
+    file.complete = true;
+    --state.files_pending;
+    state.published_stats = state.counters;
+    state.completed.notify_all();
+}
+
+void finish_files(BatchIoState& state) {
+    auto kept = state.active.begin();
+    for(auto& file : state.active) {
+        if(file->opened && file->chunks_in_flight == 0 && (file->failed || file->next_offset >= file->size)) {
+            finish_file(state, *file);
+        } else {
+            *kept++ = std::move(file);
+        }
+    }
+    state.active.erase(kept, state.active.end());
+}
+
+void run_io_thread(BatchIoState& state) {
+    std::unique_lock lock{state.mutex};
+    while(true) {
+        for(; !state.pending.empty(); state.pending.pop_front()) {
+            state.active.emplace_back(std::move(state.pending.front()));
+        }
+        if(state.active.empty()) {
+            if(state.stopping) {
+                return;
+            }
+            state.queued.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        const auto start_time = Clock::now();
+        submit_chunks(state);
+        wait_for_chunks(state);
+        const std::chrono::duration<double> busy_time = Clock::now() - start_time;
+        state.counters.busy_seconds += busy_time.count();
+        finish_files(state);
+        lock.lock();
+    }
+}
+
+} // namespace
+
+BatchIo::BatchIo(const BatchIoOptions& options)
+        : state{std::make_unique<BatchIoState>()} {
+    state->options = options;
+    const auto depth = std::max<std::size_t>(options.queue_depth, 1);
+    state->buffers.reset(static_cast<char*>(std::aligned_alloc(IO_ALIGNMENT, depth * IO_CHUNK_BYTES)));
+    state->chunks.resize(depth);
+    for(auto chunk = depth; chunk-- > 0;) {
+        state->free_chunks.push_back(chunk);
+    }
+    state->counters.backend = IoBackend::pread;
+#ifdef __linux__
+    if(options.backend == IoBackend::io_uring && state->ring.set_up(static_cast<unsigned>(depth))) {
+        state->counters.backend = IoBackend::io_uring;
+        if(options.registered_buffers) {
+            std::vector<iovec> buffers(depth);
+            for(std::size_t chunk{}; chunk < depth; ++chunk) {
+                buffers[chunk] = {chunk_buffer(*state, chunk), IO_CHUNK_BYTES};
+            }
+            // Registering fails over the locked memory limit, the buffers then being mapped for every request.
+            state->counters.registered_buffers = state->ring.register_buffers(buffers);
+        }
+    }
+#endif
+    state->published_stats = state->counters;
+    state->thread = std::thread{run_io_thread, std::ref(*state)};
+}
+
+BatchIo::~BatchIo() {
+    {
+        const std::lock_guard lock{state->mutex};
+        state->stopping = true;
+    }
+    state->queued.notify_one();
+    state->thread.join();
+}
+
+std::size_t BatchIo::read(const std::string_view file_name) {
+    auto file = std::make_shared<FileRequest>();
+    file->file_name = file_name;
+    std::size_t ticket{};
+    {
+        const std::lock_guard lock{state->mutex};
+        ticket = state->next_ticket++;
+        state->reads.emplace(ticket, file);
+        state->pending.emplace_back(std::move(file));
+        ++state->files_pending;
+    }
+    state->queued.notify_one();
+    return ticket;
+}
+
+bool BatchIo::take(const std::size_t ticket, IoBuffer& buffer) {
+    std::unique_lock lock{state->mutex};
+    const auto found = state->reads.find(ticket);
+    if(found == state->reads.end()) {
+        return false;
+    }
+    const auto file = found->second;
+    state->reads.erase(found);
+    state->completed.wait(lock, [&] { return file->complete; });
+    if(file->failed) {
+        return false;
+    }
+    buffer = std::move(file->buffer);
+    return true;
+}
+
+void BatchIo::write(const std::string_view file_name, std::pmr::string&& bytes,
+        std::function<void(bool written)> done) {
+    auto file = std::make_shared<FileRequest>();
+    file->file_name = file_name;
+    file->write = true;
+    file->bytes = std::move(bytes);
+    file->done = std::move(done);
+    {
+        const std::lock_guard lock{state->mutex};
+        state->pending.emplace_back(std::move(file));
+        ++state->files_pending;
+    }
+    state->queued.notify_one();
+}
+
+void BatchIo::drain() {
+    std::unique_lock lock{state->mutex};
+    state->completed.wait(lock, [&] { return state->files_pending == 0; });
+}
+
+BatchIoStats BatchIo::stats() const {
+    const std::lock_guard lock{state->mutex};
+    return state->published_stats;
+}
+
+void print_batch_io_stats(const BatchIoStats& stats) {
+    const auto busy_seconds = std::max(stats.busy_seconds, 1e-9);
+    const auto requests_count = std::max<std::size_t>(stats.requests_count, 1);
+    std::cout << "I/O through " << (stats.backend == IoBackend::io_uring ? "io_uring" : "pread and pwrite");
+    if(stats.registered_buffers) {
+        std::cout << " with registered buffers";
+    }
+    std::cout << ": " << stats.files_count << " files (" << stats.direct_files_count << " direct), "
+            << stats.requests_count << " requests, queue depth " << static_cast<double>(stats.depth_sum)
+                    / static_cast<double>(requests_count) << " on average and " << stats.max_depth << " at most, "
+            << static_cast<double>(stats.bytes_read) / 1e6 << " MB read and "
+            << static_cast<double>(stats.bytes_written) / 1e6 << " MB written in " << stats.busy_seconds << "s: "
+            << static_cast<double>(stats.bytes_read + stats.bytes_written) / 1e6 / busy_seconds << " MB/s.\n";
+}
@@ -0,0 +1,322 @@
+#include <bounds.hxx>
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Positions are reduced as a flat array of floats");
+
+namespace {
+
+constexpr std::size_t POSITIONS_PER_TASK = 1 << 16;
+
+struct Sphere {
+    Vector3 center;
+    float radius;
+};
+
+// Smallest sphere enclosing both spheres.
+Sphere merge_spheres(const Sphere& lhs, const Sphere& rhs) {
+    const auto offset = rhs.center - lhs.center;
+    const auto distance = length(offset);
+    if(distance + rhs.radius <= lhs.radius) {
+        return lhs;
+    }
+    if(distance + lhs.radius <= rhs.radius) {
+        return rhs;
+    }
+    const auto radius = (distance + lhs.radius + rhs.radius) * 0.5f;
+    return {lhs.center + offset * ((radius - lhs.radius) / distance), radius};
+}
+
+// Grows the sphere just enough to include every position, as in Ritter's algorithm.
+Sphere grow_sphere(Sphere sphere, const Vector3* positions, const std::size_t count) {
+    auto radius_squared = sphere.radius * sphere.radius;
+    for(std::size_t i{}; i < count; ++i) {
+        const auto offset = positions[i] - sphere.center;
+        const auto distance_squared = dot(offset, offset);
+        if(distance_squared > radius_squared) {
+            const auto distance = std::sqrt(distance_squared);
+            const auto radius = (sphere.radius + distance) * 0.5f;
+            sphere.center += offset * ((radius - sphere.radius) / distance);
+            sphere.radius = radius;
+            radius_squared = radius * radius;
+        }
+    }
+    return sphere;
+}
+
+float max_distance_squared(const Vector3& center, const Vector3* positions, const std::size_t count) {
+    float result{};
+    for(std::size_t i{}; i < count; ++i) {
+        const auto offset = positions[i] - center;
+        result = std::max(result, dot(offset, offset));
+    }
+    return result;
+}
+
+// Indices of the positions with the lowest and highest coordinate on every axis.
+std::array<std::size_t, 6> find_extreme_points(const Vector3* positions, const std::size_t first,
+        const std::size_t count) {
+    std::array<std::size_t, 6> extremes{};
+    extremes.fill(first);
+    for(auto i = first; i < first + count; ++i) {
+        for(std::size_t axis{}; axis < 3; ++axis) {
+            const auto value = component(positions[i], axis);
+            if(value < component(positions[extremes[axis * 2]], axis)) {
+                extremes[axis * 2] = i;
+            }
+            if(value > component(positions[extremes[axis * 2 + 1]], axis)) {
+                extremes[axis * 2 + 1] = i;
+            }
+        }
+    }
+    return extremes;
+}
+
+} // namespace
+
+void compute_aabb(const Vector3* positions, const std::size_t count, Vector3& aabb_min, Vector3& aabb_max) {
+    constexpr auto infinity = std::numeric_limits<float>::infinity();
+    aabb_min = {infinity, infinity, infinity};
+    aabb_max = {-infinity, -infinity, -infinity};
+    std::size_t i{};
+#if defined(__SSE2__)
+    if(count >= 4) {
+        // Four positions are twelve floats, i.e. three registers whose lanes always hold the same components:
+        // (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3), so the reduction needs no shuffles until the very end.
+        const auto floats = reinterpret_cast<const float*>(positions);
+        auto min0 = _mm_loadu_ps(floats);
+        auto min1 = _mm_loadu_ps(floats + 4);
+        auto min2 = _mm_loadu_ps(floats + 8);
+        auto max0 = min0;
+        auto max1 = min1;
+        auto max2 = min2;
+        for(i = 4; i + 4 <= count; i += 4) {
+            const auto values0 = _mm_loadu_ps(floats + i * 3);
+            const auto values1 = _mm_loadu_ps(floats + i * 3 + 4);
+            const auto values2 = _mm_loadu_ps(floats + i * 3 + 8);
+            min0 = _mm_min_ps(min0, values0);
+            min1 = _mm_min_ps(min1, values1);
+            min2 = _mm_min_ps(min2, values2);
+            max0 = _mm_max_ps(max0, values0);
+            max1 = _mm_max_ps(max1, values1);
+            max2 = _mm_max_ps(max2, values2);
+        }
+        std::array<float, 12> lanes_min{};
+        std::array<float, 12> lanes_max{};
+        _mm_storeu_ps(lanes_min.data(), min0);
+        _mm_storeu_ps(lanes_min.data() + 4, min1);
+        _mm_storeu_ps(lanes_min.data() + 8, min2);
+        _mm_storeu_ps(lanes_max.data(), max0);
+        _mm_storeu_ps(lanes_max.data() + 4, max1);
+        _mm_storeu_ps(lanes_max.data() + 8, max2);
+        for(std::size_t lane{}; lane < 12; lane += 3) {
+            aabb_min = component_min(aabb_min, {lanes_min[lane], lanes_min[lane + 1], lanes_min[lane + 2]});
+            aabb_max = component_max(aabb_max, {lanes_max[lane], lanes_max[lane + 1], lanes_max[lane + 2]});
+        }
+    }
+#endif
+    for(; i < count; ++i) {
+        aabb_min = component_min(aabb_min, positions[i]);
+        aabb_max = component_max(aabb_max, positions[i]);
+    }
+}
+
+Bounds compute_bounds(const std::vector<Vector3>& positions, const std::size_t threads_count) {
+    Bounds bounds{};
+    if(positions.empty()) {
+        return bounds;
+    }
+    // Partial results are kept per range and combined in range order, so the result does not depend on scheduling.
+    const auto ranges_count = std::max<std::size_t>(
+            std::min(threads_count, positions.size() / POSITIONS_PER_TASK), 1);
+    const auto range_size = (positions.size() + ranges_count - 1) / ranges_count;
+    const auto range_first = [&](const std::size_t range) { return std::min(range * range_size, positions.size()); };
+    const auto range_count = [&](const std::size_t range) { return range_first(range + 1) - range_first(range); };
+    const auto for_each_range = [&](auto&& function) {
+        parallel_for(threads_count, ranges_count, 1, [&](const std::size_t begin, const std::size_t end) {
+            for(auto range = begin; range < end; ++range) {
+                function(range);
+            }
+        });
+    };
+
+    std::vector<Vector3> ranges_min(ranges_count);
+    std::vector<Vector3> ranges_max(ranges_count);
+    std::vector<std::array<std::size_t, 6>> ranges_extremes(ranges_count);
+    for_each_range([&](const std::size_t range) {
+        compute_aabb(positions.data() + range_first(range), range_count(range), ranges_min[range], ranges_max[range]);
+        ranges_extremes[range] = find_extreme_points(positions.data(), range_first(range), range_count(range));
+    });
+    bounds.aabb_min = ranges_min[0];
+    bounds.aabb_max = ranges_max[0];
+    auto extremes = ranges_extremes[0];
+    for(std::size_t range{1}; range < ranges_count; ++range) {
+        bounds.aabb_min = component_min(bounds.aabb_min, ranges_min[range]);
+        bounds.aabb_max = component_max(bounds.aabb_max, ranges_max[range]);
+        for(std::size_t axis{}; axis < 3; ++axis) {
+            const auto& low = positions[ranges_extremes[range][axis * 2]];
+            const auto& high = positions[ranges_extremes[range][axis * 2 + 1]];
+            if(component(low, axis) < component(positions[extremes[axis * 2]], axis)) {
+                extremes[axis * 2] = ranges_extremes[range][axis * 2];
+            }
+            if(component(high, axis) > component(positions[extremes[axis * 2 + 1]], axis)) {
+                extremes[axis * 2 + 1] = ranges_extremes[range][axis * 2 + 1];
+            }
+        }
+    }
+
+    // Ritter's initial sphere spans the most distant pair of extreme points, every range then grows its own copy and
+    // the copies are merged.
+    std::size_t widest_axis{};
+    float widest_distance{-1.0f};
+    for(std::size_t axis{}; axis < 3; ++axis) {
+        const auto offset = positions[extremes[axis * 2 + 1]] - positions[extremes[axis * 2]];
+        if(dot(offset, offset) > widest_distance) {
+            widest_distance = dot(offset, offset);
+            widest_axis = axis;
+        }
+    }
+    const auto& low = positions[extremes[widest_axis * 2]];
+    const auto& high = positions[extremes[widest_axis * 2 + 1]];
+    const Sphere initial_sphere{(low + high) * 0.5f, std::sqrt(widest_distance) * 0.5f};
+    std::vector<Sphere> ranges_spheres(ranges_count);
+    const auto box_center = (bounds.aabb_min + bounds.aabb_max) * 0.5f;
+    std::vector<float> ranges_box_distances(ranges_count);
+    for_each_range([&](const std::size_t range) {
+        const auto first = positions.data() + range_first(range);
+        ranges_spheres[range] = grow_sphere(initial_sphere, first, range_count(range));
+        ranges_box_distances[range] = max_distance_squared(box_center, first, range_count(range));
+    });
+    auto ritter_sphere = ranges_spheres[0];
+    for(std::size_t range{1}; range < ranges_count; ++range) {
+        ritter_sphere = merge_spheres(ritter_sphere, ranges_spheres[range]);
+    }
+    // The radius is measured again around the final center, which also absorbs the rounding of the incremental
+    // center updates.
+    std::vector<float> ranges_ritter_distances(ranges_count);
+    for_each_range([&](const std::size_t range) {
+        ranges_ritter_distances[range] = max_distance_squared(ritter_sphere.center,
+                positions.data() + range_first(range), range_count(range));
+    });
+    const auto box_radius = std::sqrt(*std::max_element(ranges_box_distances.begin(), ranges_box_distances.end()));
+    const auto ritter_radius = std::sqrt(
+            *std::max_element(ranges_ritter_distances.begin(), ranges_ritter_distances.end()));
+    bounds.sphere_center = box_radius <= ritter_radius ? box_center : ritter_sphere.center;
+    bounds.sphere_radius = std::min(box_radius, ritter_radius);
+    return bounds;
+}
+
+bool compute_bounds_streamed(const std::size_t count, const std::size_t threads_count,
+        const std::function<bool(std::size_t first, std::size_t count, Vector3* positions)>& read, Bounds& bounds) {
+    bounds = {};
+    if(count == 0) {
+        return true;
+    }
+    // The ranges of compute_bounds, scanned one chunk at a time, one range after the other.
+    const auto ranges_count = std::max<std::size_t>(std::min(threads_count, count / POSITIONS_PER_TASK), 1);
+    const auto range_size = (count + ranges_count - 1) / ranges_count;
+    const auto range_first = [&](const std::size_t range) { return std::min(range * range_size, count); };
+    std::vector<Vector3> chunk(std::min(count, POSITIONS_PER_TASK));
+    const auto for_each_chunk = [&](const std::size_t range, auto&& function) {
+        for(auto first = range_first(range); first < range_first(range + 1); first += chunk.size()) {
+            const auto chunk_count = std::min(chunk.size(), range_first(range + 1) - first);
+            if(!read(first, chunk_count, chunk.data())) {
+                return false;
+            }
+            function(first, chunk_count);
+        }
+        return true;
+    };
+
+    // Extreme points are kept with their positions, which are no longer at hand once their chunk is gone.
+    std::array<Vector3, 6> extreme_positions{};
+    for(std::size_t range{}; range < ranges_count; ++range) {
+        Vector3 range_min{};
+        Vector3 range_max{};
+        auto range_extreme_positions = extreme_positions;
+        const auto scanned = for_each_chunk(range, [&](const std::size_t first, const std::size_t chunk_count) {
+            Vector3 chunk_min{};
+            Vector3 chunk_max{};
+            compute_aabb(chunk.data(), chunk_count, chunk_min, chunk_max);
+            const auto chunk_extremes = find_extreme_points(chunk.data(), 0, chunk_count);
+            const auto first_chunk = first == range_first(range);
+            range_min = first_chunk ? chunk_min : component_min(range_min, chunk_min);
+            range_max = first_chunk ? chunk_max : component_max(range_max, chunk_max);
+            for(std::size_t extreme{}; extreme < 6; ++extreme) {
+                const auto axis = extreme / 2;
+                const auto& position = chunk[chunk_extremes[extreme]];
+                const auto current = component(range_extreme_positions[extreme], axis);
+                if(first_chunk || (extreme % 2 == 0 ? component(position, axis) < current
+                        : component(position, axis) > current)) {
+                    range_extreme_positions[extreme] = position;
+                }
+            }
+        });
+        if(!scanned) {
+            return false;
+        }
+        bounds.aabb_min = range == 0 ? range_min : component_min(bounds.aabb_min, range_min);
+        bounds.aabb_max = range == 0 ? range_max : component_max(bounds.aabb_max, range_max);
+        for(std::size_t extreme{}; extreme < 6; ++extreme) {
+            const auto axis = extreme / 2;
+            const auto value = component(range_extreme_positions[extreme], axis);
+            const auto current = component(extreme_positions[extreme], axis);
+            if(range == 0 || (extreme % 2 == 0 ? value < current : value > current)) {
+                extreme_positions[extreme] = range_extreme_positions[extreme];
+            }
+        }
+    }
+
+    std::size_t widest_axis{};
+    float widest_distance{-1.0f};
+    for(std::size_t axis{}; axis < 3; ++axis) {
+        const auto offset = extreme_positions[axis * 2 + 1] - extreme_positions[axis * 2];
+        if(dot(offset, offset) > widest_distance) {
+            widest_distance = dot(offset, offset);
+            widest_axis = axis;
+        }
+    }
+    const auto& low = extreme_positions[widest_axis * 2];
+    const auto& high = extreme_positions[widest_axis * 2 + 1];
+    const Sphere initial_sphere{(low + high) * 0.5f, std::sqrt(widest_distance) * 0.5f};
+    const auto box_center = (bounds.aabb_min + bounds.aabb_max) * 0.5f;
+    Sphere ritter_sphere{};
+    float box_distance{};
+    for(std::size_t range{}; range < ranges_count; ++range) {
+        auto range_sphere = initial_sphere;
+        const auto scanned = for_each_chunk(range, [&](const std::size_t, const std::size_t chunk_count) {
+            range_sphere = grow_sphere(range_sphere, chunk.data(), chunk_count);
+            box_distance = std::max(box_distance, max_distance_squared(box_center, chunk.data(), chunk_count));
+        });
+        if(!scanned) {
+            return false;
+        }
+        ritter_sphere = range == 0 ? range_sphere : merge_spheres(ritter_sphere, range_sphere);
+    }
+    float ritter_distance{};
+    for(std::size_t range{}; range < ranges_count; ++range) {
+        const auto scanned = for_each_chunk(range, [&](const std::size_t, const std::size_t chunk_count) {
+            ritter_distance = std::max(ritter_distance,
+                    max_distance_squared(ritter_sphere.center, chunk.data(), chunk_count));
+        });
+        if(!scanned) {
+            return false;
+        }
+    }
+    const auto box_radius = std::sqrt(box_distance);
+    const auto ritter_radius = std::sqrt(ritter_distance);
+    bounds.sphere_center = box_radius <= ritter_radius ? box_center : ritter_sphere.center;
+    bounds.sphere_radius = std::min(box_radius, ritter_radius);
+    return true;
+}
@@ -0,0 +1,203 @@
+#include <bvh.hxx>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+namespace {
+
+constexpr std::uint32_t PARALLEL_SUBTREE_MIN_TRIANGLES = 1 << 14;
+// Beyond this depth splits fall back to object medians, which bounds the recursion on pathological inputs.
+constexpr std::size_t MAX_SAH_DEPTH = 64;
+constexpr float TRAVERSAL_COST = 1.0f;
+
+struct Aabb {
+    Vector3 min{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::infinity()};
+    Vector3 max{-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity()};
+
+    void extend(const Vector3& point) {
+        min = component_min(min, point);
+        max = component_max(max, point);
+    }
+
+    void extend(const Aabb& box) {
+        min = component_min(min, box.min);
+        max = component_max(max, box.max);
+    }
+
+    float surface_area() const {
+        if(min.x > max.x) {
+            return 0.0f;
+        }
+        const auto extent = max - min;
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+};
+
+struct BuildInput {
+    const std::vector<Aabb>& triangle_boxes;
+    const std::vector<Vector3>& centroids;
+    std::vector<std::uint32_t>& triangle_indices;
+};
+
+struct Split {
+    std::size_t axis;
+    std::size_t bin;
+    float cost;
+};
+
+std::size_t bin_of(const float centroid, const float min, const float scale) {
+    return std::min(static_cast<std::size_t>(std::max((centroid - min) * scale, 0.0f)), BVH_BINS_COUNT - 1);
+}
+
+Split find_sah_split(const BuildInput& input, const std::uint32_t first, const std::uint32_t count,
+        const Aabb& centroid_box) {
+    Split best{0, BVH_BINS_COUNT, std::numeric_limits<float>::infinity()};
+    for(std::size_t axis{}; axis < 3; ++axis) {
+        const auto min = component(centroid_box.min, axis);
+        const auto extent = component(centroid_box.max, axis) - min;
+        if(!(extent > 0.0f)) {
+            continue;
+        }
+        const auto scale = static_cast<float>(BVH_BINS_COUNT) / extent;
+        std::array<Aabb, BVH_BINS_COUNT> boxes{};
+        std::array<std::uint32_t, BVH_BINS_COUNT> counts{};
+        for(auto i = first; i < first + count; ++i) {
+            const auto triangle = input.triangle_indices[i];
+            const auto bin = bin_of(component(input.centroids[triangle], axis), min, scale);
+            boxes[bin].extend(input.triangle_boxes[triangle]);
+            ++counts[bin];
+        }
+        // Sweeping from the right first gives the cost of every split "bins [0, bin] | bins (bin, BINS)" in one pass.
+        std::array<float, BVH_BINS_COUNT> right_costs{};
+        Aabb right_box{};
+        std::uint32_t right_count{};
+        for(auto bin = BVH_BINS_COUNT - 1; bin > 0; --bin) {
+            right_box.extend(boxes[bin]);
+            right_count += counts[bin];
+            right_costs[bin - 1] = right_box.surface_area() * static_cast<float>(right_count);
+        }
+        Aabb left_box{};
+        std::uint32_t left_count{};
+        for(std::size_t bin{}; bin + 1 < BVH_BINS_COUNT; ++bin) {
+            left_box.extend(boxes[bin]);
+            left_count += counts[bin];
+            const auto cost = left_box.surface_area() * static_cast<float>(left_count) + right_costs[bin];
+            if(left_count != 0 && left_count != count && cost < best.cost) {
+                best = {axis, bin, cost};
+            }
+        }
+    }
+    return best;
+}
+
+void build_node(const BuildInput& input, const std::uint32_t first, const std::uint32_t count,
+        const std::size_t depth, const std::size_t parallel_depth, std::vector<BvhNode>& nodes) {
+    Aabb box{};
+    Aabb centroid_box{};
+    for(auto i = first; i < first + count; ++i) {
+        box.extend(input.triangle_boxes[input.triangle_indices[i]]);
+        centroid_box.extend(input.centroids[input.triangle_indices[i]]);
+    }
+    const auto node_index = nodes.size();
+    nodes.push_back({box.min, box.max, first, count});
+    if(count <= 1) {
+        return;
+    }
+
+    auto middle = first;
+    const auto split = depth < MAX_SAH_DEPTH ? find_sah_split(input, first, count, centroid_box)
+            : Split{0, BVH_BINS_COUNT, std::numeric_limits<float>::infinity()};
+    if(split.bin < BVH_BINS_COUNT) {
+        const auto leaf_cost = static_cast<float>(count);
+        const auto split_cost = TRAVERSAL_COST + split.cost / box.surface_area();
+        if(count <= BVH_MAX_LEAF_TRIANGLES && !(split_cost < leaf_cost)) {
+            return;
+        }
+        const auto min = component(centroid_box.min, split.axis);
+        const auto scale = static_cast<float>(BVH_BINS_COUNT)
+                / (component(centroid_box.max, split.axis) - min);
+        const auto begin = input.triangle_indices.begin();
+        middle = static_cast<std::uint32_t>(std::partition(begin + first, begin + first + count,
+                [&](const std::uint32_t triangle) {
+            return bin_of(component(input.centroids[triangle], split.axis), min, scale) <= split.bin;
+        }) - begin);
+    } else if(count <= BVH_MAX_LEAF_TRIANGLES) {
+        return;
+    }
+    if(middle == first || middle == first + count) {
+        // Coincident centroids or too deep: split at the object median of the widest centroid axis.
+        const auto extent = centroid_box.max - centroid_box.min;
+        const std::size_t axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+        middle = first + count / 2;
+        const auto begin = input.triangle_indices.begin();
+        std::nth_element(begin + first, begin + middle, begin + first + count,
+                [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+            return component(input.centroids[lhs], axis) < component(input.centroids[rhs], axis);
+        });
+    }
+
+    nodes[node_index].count = 0;
+    const auto left_count = middle - first;
+    const auto right_count = count - left_count;
+    if(depth < parallel_depth && count >= PARALLEL_SUBTREE_MIN_TRIANGLES) {
+        // The right subtree is built into its own array in parallel and appended afterwards, which keeps the
+        // depth-first layout identical to the sequential build.
+        std::vector<BvhNode> right_nodes{};
+        parallel_for(2, 2, 1, [&](const std::size_t subtree, const std::size_t) {
+            if(subtree == 0) {
+                build_node(input, first, left_count, depth + 1, parallel_depth, nodes);
+            } else {
+                build_node(input, middle, right_count, depth + 1, parallel_depth, right_nodes);
+            }
+        });
+        const auto right_index = static_cast<std::uint32_t>(nodes.size());
+        nodes[node_index].first = right_index;
+        for(auto node : right_nodes) {
+            if(node.count == 0) {
+                node.first += right_index;
+            }
+            nodes.push_back(node);
+        }
+    } else {
+        build_node(input, first, left_count, depth + 1, parallel_depth, nodes);
+        nodes[node_index].first = static_cast<std::uint32_t>(nodes.size());
+        build_node(input, middle, right_count, depth + 1, parallel_depth, nodes);
+    }
+}
+
+} // namespace
+
+void build_bvh(Mesh& mesh, const std::size_t threads_count) {
+    mesh.bvh_nodes.clear();
+    mesh.bvh_triangle_indices.clear();
+    const auto triangles_count = mesh.position_indices.size() / 3;
+    if(triangles_count == 0) {
+        return;
+    }
+    std::vector<Aabb> triangle_boxes(triangles_count);
+    std::vector<Vector3> centroids(triangles_count);
+    parallel_for(threads_count, triangles_count, 1 << 14, [&](const std::size_t begin, const std::size_t end) {
+        for(auto triangle = begin; triangle < end; ++triangle) {
+            for(std::size_t corner{}; corner < 3; ++corner) {
+                triangle_boxes[triangle].extend(mesh.positions[mesh.position_indices[triangle * 3 + corner]]);
+            }
+            centroids[triangle] = (triangle_boxes[triangle].min + triangle_boxes[triangle].max) * 0.5f;
+        }
+    });
+    mesh.bvh_triangle_indices.resize(triangles_count);
+    std::iota(mesh.bvh_triangle_indices.begin(), mesh.bvh_triangle_indices.end(), std::uint32_t{});
+    std::size_t parallel_depth{};
+    while((std::size_t{1} << parallel_depth) < threads_count) {
+        ++parallel_depth;
+    }
+    mesh.bvh_nodes.reserve(2 * triangles_count / BVH_MAX_LEAF_TRIANGLES + 1);
+    const BuildInput input{triangle_boxes, centroids, mesh.bvh_triangle_indices};
+    build_node(input, 0, static_cast<std::uint32_t>(triangles_count), 0, parallel_depth, mesh.bvh_nodes);
+}
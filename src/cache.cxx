@@ -0,0 +1,480 @@
+#include <cache.hxx>
+
+#include <unistd.h>
+
+#include <cctype>
+#include <climits>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <compression.hxx>
+
+namespace {
+
+constexpr std::size_t READ_CHUNK_SIZE = 1 << 20;
+constexpr std::string_view GEOMETRY_TAG = "<geometry";
+// Added to every geometry element before parsing, holding the index of its text span.
+constexpr const char* SPAN_ATTRIBUTE = "dae2obm-span";
+// Seeds geometry keys differently from file keys, although both live in the same directory.
+constexpr std::uint64_t GEOMETRY_SEED = 0x67656f6d65747279ULL;
+// Suffix of the stamp file next to an entry, whose modification time is the last use of the entry.
+constexpr std::string_view STAMP_SUFFIX = ".used";
+
+struct GeometrySpan {
+    std::size_t begin{};
+    std::size_t end{};
+    bool cacheable{};
+    std::filesystem::path entry{};
+    bool cached{};
+    std::string section{};
+};
+
+std::string to_hex(const std::uint64_t value) {
+    constexpr char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for(std::size_t i{}; i < hex.size(); ++i) {
+        hex[hex.size() - 1 - i] = digits[(value >> (4 * i)) & 0xf];
+    }
+    return hex;
+}
+
+template<typename Value>
+void append_bytes(std::string& bytes, const Value& value) {
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool starts_with(const std::string_view text, const std::size_t position, const std::string_view prefix) {
+    return text.compare(position, prefix.size(), prefix) == 0;
+}
+
+// Finds the text of every geometry element, skipping comments and CDATA sections. Self-closing geometries are listed
+// too, so that span indices follow document order, but are never cached.
+std::vector<GeometrySpan> find_geometry_spans(const std::string_view text) {
+    std::vector<GeometrySpan> spans{};
+    auto position = text.find('<');
+    while(position != std::string_view::npos) {
+        if(starts_with(text, position, "<!--")) {
+            position = text.find("-->", position);
+        } else if(starts_with(text, position, "<![CDATA[")) {
+            position = text.find("]]>", position);
+        } else if(starts_with(text, position, GEOMETRY_TAG) && position + GEOMETRY_TAG.size() < text.size()
+                && (std::isspace(static_cast<unsigned char>(text[position + GEOMETRY_TAG.size()]))
+                        || text[position + GEOMETRY_TAG.size()] == '>'
+                        || text[position + GEOMETRY_TAG.size()] == '/')) {
+            const auto tag_end = text.find('>', position);
+            if(tag_end != std::string_view::npos && text[tag_end - 1] == '/') {
+                spans.push_back({position, tag_end + 1});
+                position = tag_end;
+            } else {
+                const auto closing_tag = text.find("</geometry", position);
+                const auto end = text.find('>', closing_tag);
+                if(tag_end == std::string_view::npos || end == std::string_view::npos) {
+                    break;
+                }
+                spans.push_back({position, end + 1, true});
+                position = end;
+            }
+        }
+        if(position == std::string_view::npos) {
+            break;
+        }
+        position = text.find('<', position + 1);
+    }
+    return spans;
+}
+
+// The values of the attributes of the text that start with prefix, up to their closing quote, with their positions.
+// With attribute_name, only attributes whose name starts the prefix count, as "id=\"" would also match "sid=\"".
+std::vector<std::pair<std::string_view, std::size_t>> collect_attribute_values(const std::string_view text,
+        const std::string_view prefix, const bool attribute_name) {
+    std::vector<std::pair<std::string_view, std::size_t>> values{};
+    for(auto position = text.find(prefix); position != std::string_view::npos;
+            position = text.find(prefix, position + 1)) {
+        const auto begin = position + prefix.size();
+        const auto end = text.find('"', begin);
+        if(end == std::string_view::npos) {
+            break;
+        }
+        if(!attribute_name || (position != 0 && std::isspace(static_cast<unsigned char>(text[position - 1])))) {
+            values.emplace_back(text.substr(begin, end - begin), position);
+        }
+    }
+    return values;
+}
+
+// Whether every "#id" reference of the geometry text points into the same text, which makes the converted geometry
+// depend on that text alone.
+bool is_self_contained(const std::string_view text) {
+    std::vector<std::string_view> defined_ids{};
+    for(const auto& [id, position] : collect_attribute_values(text, "id=\"", true)) {
+        defined_ids.push_back(id);
+    }
+    const auto references = collect_attribute_values(text, "=\"#", false);
+    std::sort(defined_ids.begin(), defined_ids.end());
+    return std::all_of(references.begin(), references.end(), [&](const auto& reference) {
+        return std::binary_search(defined_ids.begin(), defined_ids.end(), reference.first);
+    });
+}
+
+// Makes the geometries whose ids are referenced from outside of their text uncacheable: cutting them out of the
+// document would leave those references dangling.
+void mark_referenced_spans(const std::string_view text, std::vector<GeometrySpan>& spans) {
+    // The span of every id defined in a geometry, spans being in document order.
+    std::vector<std::pair<std::string_view, std::size_t>> span_ids{};
+    for(const auto& [id, position] : collect_attribute_values(text, "id=\"", true)) {
+        const auto span = std::upper_bound(spans.begin(), spans.end(), position,
+                [](const std::size_t value, const GeometrySpan& candidate) { return value < candidate.begin; });
+        if(span != spans.begin() && position < std::prev(span)->end) {
+            span_ids.emplace_back(id, static_cast<std::size_t>(std::prev(span) - spans.begin()));
+        }
+    }
+    std::sort(span_ids.begin(), span_ids.end());
+    for(const auto& [reference, position] : collect_attribute_values(text, "=\"#", false)) {
+        auto span_id = std::lower_bound(span_ids.begin(), span_ids.end(), reference,
+                [](const auto& defined, const std::string_view id) { return defined.first < id; });
+        for(; span_id != span_ids.end() && span_id->first == reference; ++span_id) {
+            auto& span = spans[span_id->second];
+            if(position < span.begin || position >= span.end) {
+                span.cacheable = false;
+            }
+        }
+    }
+}
+
+// A name for the bytes of the entry while they are written, unique among the threads of every process sharing the
+// cache directory.
+std::filesystem::path temporary_entry_name(const std::filesystem::path& entry) {
+    auto temporary_entry = entry;
+    temporary_entry += "." + std::to_string(getpid()) + "."
+            + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    return temporary_entry;
+}
+
+std::filesystem::path stamp_name(const std::filesystem::path& entry) {
+    auto stamp = entry;
+    stamp += STAMP_SUFFIX;
+    return stamp;
+}
+
+// Records a use of the entry for evict_cache_entries. The entry's own times cannot record it, as they are those of
+// every output linked to it.
+void touch_entry(const std::filesystem::path& entry) {
+    const auto stamp = stamp_name(entry);
+    std::error_code error{};
+    std::filesystem::last_write_time(stamp, std::filesystem::file_time_type::clock::now(), error);
+    if(error) {
+        std::ofstream{stamp, std::ios::binary | std::ios::trunc};
+    }
+}
+
+// Writes the bytes under a temporary name and renames them into place, so that concurrent conversions never see
+// partial entries.
+void store_entry(const std::filesystem::path& entry, const std::string& bytes) {
+    const auto temporary_entry = temporary_entry_name(entry);
+    std::error_code error{};
+    {
+        std::ofstream file{temporary_entry, std::ios::binary | std::ios::trunc};
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if(!file.good()) {
+            error = std::make_error_code(std::errc::io_error);
+        }
+    }
+    if(!error) {
+        std::filesystem::rename(temporary_entry, entry, error);
+    }
+    if(error) {
+        std::filesystem::remove(temporary_entry, error);
+    }
+}
+
+bool load_entry(const std::filesystem::path& entry, std::string& bytes) {
+    std::ifstream file{entry, std::ios::binary | std::ios::ate};
+    if(!file.is_open()) {
+        return false;
+    }
+    bytes.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if(!file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+        return false;
+    }
+    touch_entry(entry);
+    return true;
+}
+
+// Converts a file geometry by geometry: unchanged geometries are cut out of the text before parsing and their
+// sections are taken from the cache, so that only the changed geometries are parsed and converted.
+int convert_by_geometry(ConversionCache& cache, tinyxml2::XMLDocument& collada_file, std::string& contents,
+        std::vector<GeometrySpan>& spans, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options, const std::uint64_t seed) {
+    const ExecutorScope executor_scope{options.executor};
+    mark_referenced_spans(contents, spans);
+    std::string text{};
+    std::size_t copied{};
+    for(std::size_t i{}; i < spans.size(); ++i) {
+        auto& span = spans[i];
+        const std::string_view span_text{contents.data() + span.begin, span.end - span.begin};
+        span.cacheable = span.cacheable && is_self_contained(span_text);
+        if(span.cacheable) {
+            span.entry = cache.directory / (to_hex(xxh64(span_text.data(), span_text.size(), seed ^ GEOMETRY_SEED))
+                    + ".obms");
+            span.cached = load_entry(span.entry, span.section);
+        }
+        const auto name_end = span.begin + GEOMETRY_TAG.size();
+        text.append(contents, copied, name_end - copied);
+        text += " " + std::string{SPAN_ATTRIBUTE} + "=\"" + std::to_string(i) + "\"";
+        if(span.cached) {
+            text += "/>";
+            copied = span.end;
+        } else {
+            copied = name_end;
+        }
+    }
+    text.append(contents, copied, std::string::npos);
+    std::string{}.swap(contents);
+
+    const ParallelParseScope parallel_parse_scope{collada_file, options};
+    const auto parse_error = collada_file.Parse(text.data(), text.size());
+    std::string{}.swap(text);
+    if(parse_error != tinyxml2::XMLError::XML_SUCCESS) {
+        report(options, "Failed to parse collada source file \"", input_file_name, "\".\n");
+        return 1;
+    }
+    auto collada_root_node = collada_file.FirstChildElement("COLLADA");
+    if(collada_root_node == nullptr) {
+        report(options, "Collada root node was not found in \"", input_file_name, "\".\n");
+        return 2;
+    }
+    const auto id_index = build_id_index(collada_root_node);
+    const auto geometries_library = collada_root_node->FirstChildElement("library_geometries");
+    auto geometry = geometries_library != nullptr ? geometries_library->FirstChildElement("geometry") : nullptr;
+    if(geometry == nullptr) {
+        report(options, "Error: No geometries found in geometries library.\n");
+        return 3;
+    }
+    std::size_t meshes_count{};
+    for(auto next = geometry; next != nullptr; next = next->NextSiblingElement()) {
+        ++meshes_count;
+    }
+    if(const auto count_error = check_meshes_count(meshes_count, input_file_name, options); count_error != 0) {
+        return count_error;
+    }
+    std::vector<std::string> sections{};
+    while(geometry != nullptr) {
+        const auto span_index = geometry->UnsignedAttribute(SPAN_ATTRIBUTE, UINT_MAX);
+        const auto span = span_index < spans.size() ? &spans[span_index] : nullptr;
+        if(span != nullptr && span->cached) {
+            sections.emplace_back(std::move(span->section));
+            ++cache.geometry_hits;
+        } else {
+            const auto mesh_id = geometry->Attribute("id");
+            const auto mesh_node = geometry->FirstChildElement("mesh");
+            if(mesh_node == nullptr) {
+                report(options, "Error: Geometry doesn't contain \"mesh\" node.\n");
+                return 4;
+            }
+            Mesh mesh{};
+            const auto load_error = load_mesh(mesh_node, mesh_id != nullptr ? mesh_id : "", id_index, options, mesh);
+            if(load_error != 0) {
+                return load_error;
+            }
+            post_process_mesh(mesh, mesh_id != nullptr ? mesh_id : "", options);
+            serialize_mesh(mesh, sections.emplace_back());
+            if(span != nullptr && span->cacheable) {
+                store_entry(span->entry, sections.back());
+            }
+            ++cache.geometry_misses;
+        }
+        geometry = geometry->NextSiblingElement();
+    }
+    if(!write_sections(output_file_name, sections, options.restat)) {
+        report(options, "Failed to write to file \"", output_file_name, "\".\n");
+        return 7;
+    }
+    return 0;
+}
+
+} // namespace
+
+bool open_conversion_cache(ConversionCache& cache) {
+    std::error_code error{};
+    std::filesystem::create_directories(cache.directory, error);
+    return std::filesystem::is_directory(cache.directory, error);
+}
+
+std::uint64_t hash_options(const ConversionOptions& options) {
+    std::string bytes{};
+    append_bytes(bytes, CACHE_FORMAT_VERSION);
+    append_bytes(bytes, options.build_bvh);
+    append_bytes(bytes, options.generate_normals);
+    append_bytes(bytes, options.generate_normals || options.generate_tangents ? options.crease_angle_degrees : 0.0f);
+    append_bytes(bytes, options.generate_tangents);
+    append_bytes(bytes, options.weld);
+    append_bytes(bytes, options.weld ? options.weld_epsilon : 0.0f);
+    return xxh64(bytes.data(), bytes.size());
+}
+
+bool read_and_hash_file(const std::string_view file_name, std::string& contents, Xxh64& hash) {
+    if(const auto compression = detect_compression(file_name); compression != SourceCompression::none) {
+        if(!read_compressed_file(file_name, compression, contents)) {
+            return false;
+        }
+        hash.update(contents.data(), contents.size());
+        return true;
+    }
+    std::ifstream file{std::string{file_name}, std::ios::binary | std::ios::ate};
+    if(!file.is_open()) {
+        return false;
+    }
+    contents.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    // Every chunk is hashed right after it is read, while it is still in cache.
+    for(std::size_t offset{}; offset < contents.size(); offset += READ_CHUNK_SIZE) {
+        const auto size = std::min(READ_CHUNK_SIZE, contents.size() - offset);
+        if(!file.read(contents.data() + offset, static_cast<std::streamsize>(size))) {
+            return false;
+        }
+        hash.update(contents.data() + offset, size);
+    }
+    return true;
+}
+
+int convert_cached(ConversionCache& cache, tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options) {
+    namespace fs = std::filesystem;
+    std::string contents{};
+    Xxh64 hash{hash_options(options)};
+    if(!read_and_hash_file(input_file_name, contents, hash)) {
+        report(options, "Failed to open collada source file \"", input_file_name, "\".\n");
+        return 1;
+    }
+    const auto entry = cache.directory / (to_hex(hash.digest()) + ".obm");
+    const fs::path output_path{output_file_name};
+    std::error_code error{};
+    if(fs::exists(entry, error)) {
+        if(options.restat && !fs::equivalent(entry, output_path, error)) {
+            std::string entry_bytes{};
+            if(load_entry(entry, entry_bytes) && file_equals(output_file_name, {entry_bytes})) {
+                ++cache.hits;
+                return 0;
+            }
+        } else if(options.restat && !error) {
+            // The output is the entry itself, whose time must not change.
+            touch_entry(entry);
+            ++cache.hits;
+            return 0;
+        }
+        // The output may be a link to another entry from an earlier hit, which must not be written through. A link has
+        // the modification time of the entry, so entries older than the input are copied instead, for build systems
+        // to see an output newer than its input.
+        std::error_code input_error{};
+        const auto entry_time = fs::last_write_time(entry, error);
+        const auto linked = !error && entry_time >= fs::last_write_time(input_file_name, input_error) && !input_error;
+        error.clear();
+        fs::remove(output_path, error);
+        if(linked) {
+            fs::create_hard_link(entry, output_path, error);
+        }
+        if(!linked || error) {
+            error.clear();
+            fs::copy_file(entry, output_path, fs::copy_options::overwrite_existing, error);
+        }
+        if(!error) {
+            touch_entry(entry);
+            ++cache.hits;
+            return 0;
+        }
+    }
+    ++cache.misses;
+
+    // Files with several geometries are converted geometry by geometry, so that an edit of one of them only
+    // reconverts that one.
+    auto spans = find_geometry_spans(contents);
+    int result{};
+    if(spans.size() > 1) {
+        result = convert_by_geometry(cache, collada_file, contents, spans, input_file_name, output_file_name, options,
+                hash_options(options));
+    } else {
+        const ParallelParseScope parallel_parse_scope{collada_file, options};
+        const auto parse_error = collada_file.Parse(contents.data(), contents.size());
+        std::string{}.swap(contents);
+        if(parse_error != tinyxml2::XMLError::XML_SUCCESS) {
+            report(options, "Failed to parse collada source file \"", input_file_name, "\".\n");
+            return 1;
+        }
+        result = convert_document(collada_file, input_file_name, output_file_name, options);
+    }
+    if(result != 0) {
+        return result;
+    }
+    // Entries are copied under a temporary name and renamed, so that concurrent conversions never see partial ones.
+    const auto temporary_entry = temporary_entry_name(entry);
+    if(fs::copy_file(output_path, temporary_entry, fs::copy_options::overwrite_existing, error)) {
+        fs::rename(temporary_entry, entry, error);
+    }
+    if(error) {
+        fs::remove(temporary_entry, error);
+    }
+    return 0;
+}
+
+void evict_cache_entries(ConversionCache& cache) {
+    namespace fs = std::filesystem;
+    if(cache.max_size == 0) {
+        return;
+    }
+    // An entry was last used when its stamp was touched, or when it was stored if it has none yet.
+    std::vector<std::tuple<fs::file_time_type, std::uintmax_t, fs::path>> entries{};
+    std::unordered_map<std::string, fs::file_time_type> stamp_times{};
+    std::uintmax_t total_size{};
+    std::error_code error{};
+    for(fs::directory_iterator entry{cache.directory, error}, end{}; !error && entry != end; entry.increment(error)) {
+        std::error_code entry_error{};
+        const auto extension = entry->path().extension();
+        if(extension == STAMP_SUFFIX) {
+            const auto time = entry->last_write_time(entry_error);
+            if(!entry_error) {
+                stamp_times.emplace(entry->path().stem().string(), time);
+            }
+            continue;
+        }
+        if((extension != ".obm" && extension != ".obms") || !entry->is_regular_file(entry_error)) {
+            continue;
+        }
+        const auto size = entry->file_size(entry_error);
+        const auto time = entry->last_write_time(entry_error);
+        if(!entry_error) {
+            entries.emplace_back(time, size, entry->path());
+            total_size += size;
+        }
+    }
+    for(auto& [time, size, path] : entries) {
+        if(const auto stamp_time = stamp_times.find(path.filename().string()); stamp_time != stamp_times.end()) {
+            time = std::max(time, stamp_time->second);
+            stamp_times.erase(stamp_time);
+        }
+    }
+    // Stamps left are those of entries evicted by another process.
+    for(const auto& [name, time] : stamp_times) {
+        fs::remove(stamp_name(cache.directory / name), error);
+    }
+    std::sort(entries.begin(), entries.end());
+    for(const auto& [time, size, path] : entries) {
+        if(total_size <= cache.max_size) {
+            break;
+        }
+        if(fs::remove(path, error)) {
+            fs::remove(stamp_name(path), error);
+            total_size -= size;
+            ++cache.evicted_count;
+            cache.evicted_bytes += size;
+        }
+    }
+}
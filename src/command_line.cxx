@@ -0,0 +1,199 @@
+#include <command_line.hxx>
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+#include <cache.hxx>
+#include <depfile.hxx>
+#include <out_of_core.hxx>
+
+bool uses_standard_streams(const CommandLine& command_line) {
+    return std::find(command_line.file_names.begin(), command_line.file_names.end(), STANDARD_STREAM_FILE_NAME)
+            != command_line.file_names.end();
+}
+
+bool parse_arguments(const int argc, const char* argv[], CommandLine& command_line) {
+    auto& options = command_line.options;
+    for(int i{1}; i < argc; ++i) {
+        const std::string_view argument{argv[i]};
+        if(argument == "--batch") {
+            command_line.batch = true;
+        } else if(argument == "--watch") {
+            command_line.watch = true;
+        } else if(argument == "--debounce" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                    command_line.debounce_milliseconds);
+            if(error != std::errc{} || end != value.data() + value.size()) {
+                return false;
+            }
+        } else if(argument == "--shard" && i + 1 < argc) {
+            // Shards are numbered from 1 on the command line: "--shard 3/40".
+            const std::string_view value{argv[++i]};
+            const auto separator = value.find('/');
+            if(separator == std::string_view::npos) {
+                return false;
+            }
+            std::size_t shard_number{};
+            const auto [number_end, number_error] = std::from_chars(value.data(), value.data() + separator,
+                    shard_number);
+            const auto [count_end, count_error] = std::from_chars(value.data() + separator + 1,
+                    value.data() + value.size(), command_line.shards_count);
+            if(number_error != std::errc{} || number_end != value.data() + separator || count_error != std::errc{}
+                    || count_end != value.data() + value.size() || shard_number == 0
+                    || shard_number > command_line.shards_count) {
+                return false;
+            }
+            command_line.shard_index = shard_number - 1;
+        } else if(argument == "--async-io" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            if(value == "io_uring") {
+                command_line.io_options.backend = IoBackend::io_uring;
+            } else if(value == "pread") {
+                command_line.io_options.backend = IoBackend::pread;
+            } else {
+                return false;
+            }
+            command_line.async_io = true;
+        } else if(argument == "--io-depth" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            auto& queue_depth = command_line.io_options.queue_depth;
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), queue_depth);
+            // Registered buffers are numbered on 16 bits.
+            if(error != std::errc{} || end != value.data() + value.size() || queue_depth == 0 || queue_depth > 4096) {
+                return false;
+            }
+            command_line.async_io = true;
+        } else if(argument == "--io-direct") {
+            command_line.io_options.direct = true;
+            command_line.async_io = true;
+        } else if(argument == "--summary" && i + 1 < argc) {
+            command_line.summary_file_name = argv[++i];
+        } else if(argument == "--cache-dir" && i + 1 < argc) {
+            command_line.cache_directory = argv[++i];
+        } else if(argument == "--cache-size" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                    command_line.cache_size_megabytes);
+            if(error != std::errc{} || end != value.data() + value.size()) {
+                return false;
+            }
+        } else if(argument == "--depfile" && i + 1 < argc) {
+            command_line.depfile_name = argv[++i];
+        } else if(argument == "--serve" && i + 1 < argc) {
+            command_line.serve_socket = argv[++i];
+        } else if(argument == "--client" && i + 1 < argc) {
+            command_line.client_socket = argv[++i];
+        } else if(argument == "--stats") {
+            command_line.stats = true;
+        } else if(argument == "--stage-stats") {
+            options.report_stages = true;
+        } else if(argument == "--restat") {
+            options.restat = true;
+        } else if(argument == "--merge-summaries") {
+            command_line.merge_summaries = true;
+        } else if(argument == "--bvh") {
+            options.build_bvh = true;
+        } else if(argument == "--tangents") {
+            options.generate_tangents = true;
+        } else if(argument == "--normals") {
+            options.generate_normals = true;
+        } else if(argument == "--crease-angle" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                    options.crease_angle_degrees);
+            if(error != std::errc{} || end != value.data() + value.size() || options.crease_angle_degrees < 0.0f) {
+                return false;
+            }
+        } else if(argument == "--weld") {
+            options.weld = true;
+        } else if(argument == "--weld-epsilon" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                    options.weld_epsilon);
+            if(error != std::errc{} || end != value.data() + value.size() || !(options.weld_epsilon >= 0.0f)) {
+                return false;
+            }
+            options.weld = true;
+        } else if(argument == "--max-memory" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            std::size_t megabytes{};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), megabytes);
+            if(error != std::errc{} || end != value.data() + value.size() || megabytes < MIN_MAX_MEMORY >> 20
+                    || megabytes > (static_cast<std::size_t>(-1) >> 20)) {
+                return false;
+            }
+            options.max_memory = megabytes << 20;
+        } else if(argument == "--spill-dir" && i + 1 < argc) {
+            options.spill_directory = argv[++i];
+        } else if(argument == "--threads" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.threads_count);
+            if(error != std::errc{} || end != value.data() + value.size() || options.threads_count == 0) {
+                return false;
+            }
+        } else if(argument.size() > 2 && argument.substr(0, 2) == "--") {
+            return false;
+        } else {
+            command_line.file_names.emplace_back(argument);
+        }
+    }
+    const auto serving = !command_line.serve_socket.empty() || !command_line.client_socket.empty();
+    if(command_line.merge_summaries) {
+        return command_line.file_names.size() >= 2 && !serving;
+    }
+    if(serving && (command_line.batch || command_line.watch)) {
+        return false;
+    }
+    // The server and the statistics request take no files.
+    if(!command_line.serve_socket.empty() || command_line.stats) {
+        return command_line.file_names.empty() && command_line.depfile_name.empty()
+                && command_line.serve_socket.empty() != command_line.client_socket.empty()
+                && command_line.stats != command_line.client_socket.empty();
+    }
+    if(!command_line.batch && (command_line.shards_count != 1 || !command_line.summary_file_name.empty()
+            || command_line.async_io)) {
+        return false;
+    }
+    // Conversions through the cache, or compared with their previous output, read and write the files themselves.
+    if(command_line.async_io && (!command_line.cache_directory.empty() || options.restat)) {
+        return false;
+    }
+    // Out-of-core conversions read the source through a window of their own, which the cache, the depfile and the I/O
+    // thread would read whole.
+    if(options.max_memory != 0 && (!command_line.cache_directory.empty() || !command_line.depfile_name.empty()
+            || command_line.async_io)) {
+        return false;
+    }
+    if(options.max_memory == 0 && !options.spill_directory.empty()) {
+        return false;
+    }
+    if((command_line.batch || command_line.watch) && !command_line.depfile_name.empty()) {
+        return false;
+    }
+    if(command_line.batch && command_line.watch) {
+        return false;
+    }
+    // The standard streams can only be read and written once, by this process: not by the cache, which copies the
+    // output, the depfile, which reads the input again, or a server.
+    if(uses_standard_streams(command_line) && (command_line.batch || command_line.watch
+            || !command_line.cache_directory.empty() || !command_line.depfile_name.empty()
+            || !command_line.client_socket.empty())) {
+        return false;
+    }
+    return command_line.file_names.size() == 2;
+}
+
+int convert_command_line(const CommandLine& command_line, tinyxml2::XMLDocument& collada_file, ConversionCache* cache) {
+    const auto& file_names = command_line.file_names;
+    const auto exit_code = cache != nullptr
+            ? convert_cached(*cache, collada_file, file_names[0], file_names[1], command_line.options)
+            : convert(collada_file, file_names[0], file_names[1], command_line.options);
+    if(exit_code == 0 && !command_line.depfile_name.empty()
+            && !write_depfile(command_line.depfile_name, file_names[1], file_names[0])) {
+        std::cerr << "Failed to write to file \"" << command_line.depfile_name << "\".\n";
+        return 7;
+    }
+    return exit_code;
+}
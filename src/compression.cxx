@@ -0,0 +1,533 @@
+#include <compression.hxx>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t PREFETCH_BLOCK_SIZE = 1 << 20;
+// Blocks read ahead of the decompression at most.
+constexpr std::size_t PREFETCH_BLOCKS_COUNT = 4;
+constexpr auto READ_FAILED = static_cast<std::size_t>(-1);
+
+constexpr std::uint32_t ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr std::uint32_t ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr std::uint32_t ZIP_END_SIGNATURE = 0x06054b50;
+constexpr std::uint32_t ZIP64_END_SIGNATURE = 0x06064b50;
+constexpr std::uint32_t ZIP64_END_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr std::size_t ZIP_LOCAL_HEADER_SIZE = 30;
+constexpr std::size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+constexpr std::size_t ZIP_END_SIZE = 22;
+constexpr std::size_t ZIP64_END_SIZE = 56;
+constexpr std::size_t ZIP64_END_LOCATOR_SIZE = 20;
+constexpr std::size_t ZIP_MAX_COMMENT_SIZE = 0xffff;
+constexpr std::uint16_t ZIP64_EXTRA_FIELD = 0x0001;
+constexpr std::uint16_t ZIP_ENCRYPTED_FLAG = 0x0001;
+constexpr std::uint16_t ZIP_STORED = 0;
+constexpr std::uint16_t ZIP_DEFLATED = 8;
+constexpr std::string_view ZAE_MANIFEST = "manifest.xml";
+
+enum class StreamFormat {
+    gzip,
+    deflate,
+    stored,
+};
+
+std::uint64_t load_little_endian(const char* bytes, const std::size_t size) {
+    std::uint64_t value{};
+    for(std::size_t i{}; i < size; ++i) {
+        value |= std::uint64_t{static_cast<unsigned char>(bytes[i])} << (8 * i);
+    }
+    return value;
+}
+
+std::uint16_t load_u16(const std::string& bytes, const std::size_t position) {
+    return static_cast<std::uint16_t>(load_little_endian(bytes.data() + position, 2));
+}
+
+std::uint32_t load_u32(const std::string& bytes, const std::size_t position) {
+    return static_cast<std::uint32_t>(load_little_endian(bytes.data() + position, 4));
+}
+
+std::uint64_t load_u64(const std::string& bytes, const std::size_t position) {
+    return load_little_endian(bytes.data() + position, 8);
+}
+
+bool read_at(std::ifstream& file, const std::uint64_t offset, const std::size_t size, std::string& bytes) {
+    bytes.resize(size);
+    file.clear();
+    return static_cast<bool>(file.seekg(static_cast<std::streamoff>(offset))
+            .read(bytes.data(), static_cast<std::streamsize>(size)));
+}
+
+// Reads [offset, offset + size) of a file on a thread of its own, at most PREFETCH_BLOCKS_COUNT blocks ahead of the
+// consumer, so that reading the compressed bytes overlaps with their decompression.
+struct BlockPrefetcher {
+    BlockPrefetcher(const std::string& file_name, const std::uint64_t offset, const std::uint64_t size)
+            : file{file_name, std::ios::binary}, remaining{size} {
+        if(!file.is_open() || !file.seekg(static_cast<std::streamoff>(offset))) {
+            done = failed = true;
+            return;
+        }
+        thread = std::thread{[this] { read_blocks(); }};
+    }
+
+    BlockPrefetcher(const BlockPrefetcher&) = delete;
+    BlockPrefetcher& operator=(const BlockPrefetcher&) = delete;
+
+    ~BlockPrefetcher() {
+        {
+            const std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        changed.notify_all();
+        if(thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // Replaces block, which the prefetcher reuses, with the next one. Returns false past the last one or once
+    // reading failed.
+    bool next(std::vector<char>& block) {
+        std::unique_lock lock{mutex};
+        if(block.capacity() != 0) {
+            free_blocks.push_back(std::move(block));
+        }
+        changed.wait(lock, [&] { return !blocks.empty() || done; });
+        if(blocks.empty() || failed) {
+            return false;
+        }
+        block = std::move(blocks.front());
+        blocks.pop_front();
+        changed.notify_all();
+        return true;
+    }
+
+    bool read_failed() {
+        const std::lock_guard lock{mutex};
+        return failed;
+    }
+
+    void read_blocks() {
+        while(remaining != 0) {
+            std::vector<char> block{};
+            {
+                std::unique_lock lock{mutex};
+                changed.wait(lock, [&] { return blocks.size() < PREFETCH_BLOCKS_COUNT || stopping; });
+                if(stopping) {
+                    return;
+                }
+                if(!free_blocks.empty()) {
+                    block = std::move(free_blocks.back());
+                    free_blocks.pop_back();
+                }
+            }
+            const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, PREFETCH_BLOCK_SIZE));
+            block.resize(size);
+            const auto read = static_cast<bool>(file.read(block.data(), static_cast<std::streamsize>(size)));
+            const std::lock_guard lock{mutex};
+            if(!read) {
+                done = failed = true;
+                changed.notify_all();
+                return;
+            }
+            remaining -= size;
+            blocks.push_back(std::move(block));
+            changed.notify_all();
+        }
+        const std::lock_guard lock{mutex};
+        done = true;
+        changed.notify_all();
+    }
+
+    std::ifstream file;
+    std::uint64_t remaining;
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    std::deque<std::vector<char>> blocks{};
+    std::vector<std::vector<char>> free_blocks{};
+    bool done{};
+    bool failed{};
+    bool stopping{};
+    std::thread thread{};
+};
+
+// The text of a stream at [offset, offset + size) of a file, decompressed by Read straight into the caller's buffer.
+// Zip entries are checked against the size and CRC of their directory entry; gzip streams carry their own.
+struct InflatingReader final : tinyxml2::XMLReader {
+    InflatingReader(const std::string& file_name, const std::uint64_t offset, const std::uint64_t size,
+            const StreamFormat format, const std::uint64_t size_hint)
+            : file_name{file_name}, offset{offset}, size{size}, format{format}, size_hint{size_hint} {}
+
+    InflatingReader(const InflatingReader&) = delete;
+    InflatingReader& operator=(const InflatingReader&) = delete;
+
+    ~InflatingReader() override {
+        if(stream_initialized) {
+            inflateEnd(&stream);
+        }
+    }
+
+    bool Rewind() override {
+        prefetcher.reset();
+        prefetcher = std::make_unique<BlockPrefetcher>(file_name, offset, size);
+        stream.next_in = nullptr;
+        stream.avail_in = 0;
+        ended = member_ended = false;
+        text_crc = crc32(0, nullptr, 0);
+        text_size = 0;
+        if(format != StreamFormat::stored) {
+            if(stream_initialized) {
+                if(inflateReset(&stream) != Z_OK) {
+                    return false;
+                }
+            } else {
+                stream_initialized = inflateInit2(&stream, format == StreamFormat::gzip ? 16 + MAX_WBITS
+                        : -MAX_WBITS) == Z_OK;
+                if(!stream_initialized) {
+                    return false;
+                }
+            }
+        }
+        return !prefetcher->read_failed();
+    }
+
+    std::size_t SizeHint() const override {
+        return static_cast<std::size_t>(std::min<std::uint64_t>(size_hint, SIZE_MAX));
+    }
+
+    std::size_t Read(char* buffer, const std::size_t buffer_size) override {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = static_cast<uInt>(std::min<std::size_t>(buffer_size, UINT_MAX));
+        const auto requested = stream.avail_out;
+        while(stream.avail_out != 0 && !ended) {
+            if(stream.avail_in == 0) {
+                if(!prefetcher->next(block)) {
+                    // Only a stream that ended with its input ends the text, anything else is truncated.
+                    if(prefetcher->read_failed() || (format != StreamFormat::stored && !member_ended)) {
+                        return READ_FAILED;
+                    }
+                    ended = true;
+                    break;
+                }
+                stream.next_in = reinterpret_cast<Bytef*>(block.data());
+                stream.avail_in = static_cast<uInt>(block.size());
+            }
+            if(format == StreamFormat::stored) {
+                const auto count = std::min(stream.avail_in, stream.avail_out);
+                std::memcpy(stream.next_out, stream.next_in, count);
+                stream.next_in += count;
+                stream.avail_in -= count;
+                stream.next_out += count;
+                stream.avail_out -= count;
+                continue;
+            }
+            if(member_ended) {
+                // Another gzip member follows.
+                if(inflateReset(&stream) != Z_OK) {
+                    return READ_FAILED;
+                }
+                member_ended = false;
+            }
+            const auto result = inflate(&stream, Z_NO_FLUSH);
+            if(result == Z_STREAM_END) {
+                member_ended = format == StreamFormat::gzip;
+                ended = format == StreamFormat::deflate;
+            } else if(result != Z_OK && (result != Z_BUF_ERROR || stream.avail_in != 0)) {
+                return READ_FAILED;
+            }
+        }
+        const auto count = requested - stream.avail_out;
+        text_size += count;
+        if(format != StreamFormat::gzip) {
+            text_crc = crc32(text_crc, reinterpret_cast<const Bytef*>(buffer), count);
+            if(ended && (text_crc != expected_crc || text_size != expected_size)) {
+                return READ_FAILED;
+            }
+        }
+        return count;
+    }
+
+    const std::string file_name;
+    const std::uint64_t offset;
+    const std::uint64_t size;
+    const StreamFormat format;
+    const std::uint64_t size_hint;
+    // Of the text of a zip entry.
+    std::uint32_t expected_crc{};
+    std::uint64_t expected_size{};
+    std::unique_ptr<BlockPrefetcher> prefetcher{};
+    std::vector<char> block{};
+    z_stream stream{};
+    bool stream_initialized{};
+    bool member_ended{};
+    bool ended{};
+    std::uint32_t text_crc{};
+    std::uint64_t text_size{};
+};
+
+struct ZipEntry {
+    std::string name{};
+    std::uint16_t flags{};
+    std::uint16_t method{};
+    std::uint32_t crc{};
+    std::uint64_t compressed_size{};
+    std::uint64_t size{};
+    std::uint64_t local_header_offset{};
+};
+
+// Reads the central directory of a zip file, with the zip64 extensions of files over 4 GiB.
+bool list_zip_entries(std::ifstream& file, std::vector<ZipEntry>& entries) {
+    file.seekg(0, std::ios::end);
+    const auto file_size = static_cast<std::uint64_t>(file.tellg());
+    const auto tail_size = static_cast<std::size_t>(std::min<std::uint64_t>(file_size,
+            ZIP_END_SIZE + ZIP_MAX_COMMENT_SIZE));
+    std::string tail{};
+    if(tail_size < ZIP_END_SIZE || !read_at(file, file_size - tail_size, tail_size, tail)) {
+        return false;
+    }
+    auto end = tail_size - ZIP_END_SIZE;
+    while(load_u32(tail, end) != ZIP_END_SIGNATURE) {
+        if(end == 0) {
+            return false;
+        }
+        --end;
+    }
+    std::uint64_t entries_count = load_u16(tail, end + 10);
+    std::uint64_t directory_size = load_u32(tail, end + 12);
+    std::uint64_t directory_offset = load_u32(tail, end + 16);
+    if(end >= ZIP64_END_LOCATOR_SIZE && load_u32(tail, end - ZIP64_END_LOCATOR_SIZE) == ZIP64_END_LOCATOR_SIGNATURE) {
+        std::string zip64_end{};
+        if(!read_at(file, load_u64(tail, end - ZIP64_END_LOCATOR_SIZE + 8), ZIP64_END_SIZE, zip64_end)
+                || load_u32(zip64_end, 0) != ZIP64_END_SIGNATURE) {
+            return false;
+        }
+        entries_count = load_u64(zip64_end, 32);
+        directory_size = load_u64(zip64_end, 40);
+        directory_offset = load_u64(zip64_end, 48);
+    }
+    std::string directory{};
+    if(directory_offset > file_size || directory_size > file_size - directory_offset
+            || !read_at(file, directory_offset, static_cast<std::size_t>(directory_size), directory)) {
+        return false;
+    }
+    std::size_t position{};
+    for(std::uint64_t i{}; i < entries_count; ++i) {
+        if(directory.size() - position < ZIP_CENTRAL_HEADER_SIZE
+                || load_u32(directory, position) != ZIP_CENTRAL_HEADER_SIGNATURE) {
+            return false;
+        }
+        auto& entry = entries.emplace_back();
+        entry.flags = load_u16(directory, position + 8);
+        entry.method = load_u16(directory, position + 10);
+        entry.crc = load_u32(directory, position + 16);
+        entry.compressed_size = load_u32(directory, position + 20);
+        entry.size = load_u32(directory, position + 24);
+        const std::size_t name_size = load_u16(directory, position + 28);
+        const std::size_t extra_size = load_u16(directory, position + 30);
+        const std::size_t comment_size = load_u16(directory, position + 32);
+        entry.local_header_offset = load_u32(directory, position + 42);
+        const auto extra_begin = position + ZIP_CENTRAL_HEADER_SIZE + name_size;
+        const auto next = extra_begin + extra_size + comment_size;
+        if(next > directory.size()) {
+            return false;
+        }
+        entry.name = directory.substr(position + ZIP_CENTRAL_HEADER_SIZE, name_size);
+        // The zip64 field holds the 64-bit values of the fields saturated above, in their order.
+        for(auto field = extra_begin; field + 4 <= extra_begin + extra_size;) {
+            const auto field_size = load_u16(directory, field + 2);
+            if(load_u16(directory, field) == ZIP64_EXTRA_FIELD) {
+                auto value = field + 4;
+                for(auto size : {&entry.size, &entry.compressed_size, &entry.local_header_offset}) {
+                    if(*size == UINT32_MAX && value + 8 <= field + 4 + field_size) {
+                        *size = load_u64(directory, value);
+                        value += 8;
+                    }
+                }
+            }
+            field += 4 + field_size;
+        }
+        position = next;
+    }
+    return true;
+}
+
+std::unique_ptr<InflatingReader> open_zip_entry(const std::string& file_name, std::ifstream& file,
+        const ZipEntry& entry) {
+    std::string header{};
+    if((entry.flags & ZIP_ENCRYPTED_FLAG) != 0 || (entry.method != ZIP_STORED && entry.method != ZIP_DEFLATED)
+            || !read_at(file, entry.local_header_offset, ZIP_LOCAL_HEADER_SIZE, header)
+            || load_u32(header, 0) != ZIP_LOCAL_HEADER_SIGNATURE) {
+        return nullptr;
+    }
+    const auto data_offset = entry.local_header_offset + ZIP_LOCAL_HEADER_SIZE + load_u16(header, 26)
+            + load_u16(header, 28);
+    auto reader = std::make_unique<InflatingReader>(file_name, data_offset, entry.compressed_size,
+            entry.method == ZIP_STORED ? StreamFormat::stored : StreamFormat::deflate, entry.size);
+    reader->expected_crc = entry.crc;
+    reader->expected_size = entry.size;
+    return reader;
+}
+
+bool read_all(tinyxml2::XMLReader& reader, std::string& text) {
+    if(!reader.Rewind()) {
+        return false;
+    }
+    text.resize(std::max<std::size_t>(reader.SizeHint(), 1));
+    std::size_t size{};
+    while(true) {
+        if(size == text.size()) {
+            text.resize(2 * text.size());
+        }
+        const auto read = reader.Read(text.data() + size, text.size() - size);
+        if(read == READ_FAILED) {
+            return false;
+        }
+        if(read == 0) {
+            text.resize(size);
+            return true;
+        }
+        size += read;
+    }
+}
+
+bool ends_with(const std::string_view text, const std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+// The document of a .zae archive is the one its manifest names, or else the first .dae file at its root, or anywhere.
+std::unique_ptr<InflatingReader> open_zae_document(const std::string& file_name) {
+    std::ifstream file{file_name, std::ios::binary};
+    std::vector<ZipEntry> entries{};
+    if(!file.is_open() || !list_zip_entries(file, entries)) {
+        return nullptr;
+    }
+    const ZipEntry* document{};
+    const auto manifest = std::find_if(entries.begin(), entries.end(),
+            [](const ZipEntry& entry) { return entry.name == ZAE_MANIFEST; });
+    std::string manifest_text{};
+    if(const auto reader = manifest != entries.end() ? open_zip_entry(file_name, file, *manifest) : nullptr;
+            reader != nullptr && read_all(*reader, manifest_text)) {
+        tinyxml2::XMLDocument manifest_document{};
+        const auto root = manifest_document.Parse(manifest_text.data(), manifest_text.size()) == tinyxml2::XML_SUCCESS
+                ? manifest_document.FirstChildElement("dae_root") : nullptr;
+        std::string_view root_name{root != nullptr && root->GetText() != nullptr ? root->GetText() : ""};
+        if(root_name.substr(0, 2) == "./") {
+            root_name.remove_prefix(2);
+        }
+        const auto named = std::find_if(entries.begin(), entries.end(),
+                [&](const ZipEntry& entry) { return entry.name == root_name; });
+        document = named != entries.end() ? &*named : nullptr;
+    }
+    for(const auto at_root : {true, false}) {
+        for(const auto& entry : entries) {
+            if(document == nullptr && ends_with(entry.name, ".dae")
+                    && (!at_root || entry.name.find('/') == std::string::npos)) {
+                document = &entry;
+            }
+        }
+    }
+    return document != nullptr ? open_zip_entry(file_name, file, *document) : nullptr;
+}
+
+std::unique_ptr<InflatingReader> open_compressed_file(const std::string& file_name,
+        const SourceCompression compression) {
+    if(compression == SourceCompression::zae) {
+        return open_zae_document(file_name);
+    }
+    std::ifstream file{file_name, std::ios::binary | std::ios::ate};
+    if(!file.is_open()) {
+        return nullptr;
+    }
+    // A single member ends with the size of its text modulo 4 GiB; the text is rarely smaller than the stream.
+    const auto file_size = static_cast<std::uint64_t>(file.tellg());
+    std::string size_bytes{};
+    const auto text_size = file_size >= 4 && read_at(file, file_size - 4, 4, size_bytes) ? load_u32(size_bytes, 0) : 0;
+    return std::make_unique<InflatingReader>(file_name, 0, file_size, StreamFormat::gzip,
+            std::max<std::uint64_t>(text_size, file_size));
+}
+
+} // namespace
+
+SourceCompression detect_compression(const std::string_view file_name) {
+    std::ifstream file{std::string{file_name}, std::ios::binary};
+    char magic[4]{};
+    if(!file.read(magic, sizeof(magic))) {
+        return SourceCompression::none;
+    }
+    return compression_of_bytes({magic, sizeof(magic)});
+}
+
+SourceCompression compression_of_bytes(const std::string_view leading_bytes) {
+    if(leading_bytes.size() < 4) {
+        return SourceCompression::none;
+    }
+    if(leading_bytes[0] == '\x1f' && leading_bytes[1] == '\x8b') {
+        return SourceCompression::gzip;
+    }
+    const auto signature = load_little_endian(leading_bytes.data(), 4);
+    if(signature == ZIP_LOCAL_HEADER_SIGNATURE || signature == ZIP_END_SIGNATURE) {
+        return SourceCompression::zae;
+    }
+    return SourceCompression::none;
+}
+
+bool is_collada_file_name(const std::filesystem::path& path) {
+    const auto extension = path.extension();
+    return extension == ".dae" || extension == ".zae" || (extension == ".gz" && path.stem().extension() == ".dae");
+}
+
+std::filesystem::path without_compression_extension(const std::filesystem::path& path) {
+    auto stripped = path;
+    if(stripped.extension() == ".gz") {
+        stripped.replace_extension();
+    }
+    return stripped;
+}
+
+tinyxml2::XMLError load_compressed_file(tinyxml2::XMLDocument& collada_file, const std::string_view file_name,
+        const SourceCompression compression) {
+    const auto reader = open_compressed_file(std::string{file_name}, compression);
+    if(reader == nullptr) {
+        collada_file.Clear();
+        return tinyxml2::XML_ERROR_FILE_READ_ERROR;
+    }
+    return collada_file.LoadFile(reader.get());
+}
+
+bool read_compressed_file(const std::string_view file_name, const SourceCompression compression, std::string& text) {
+    const auto reader = open_compressed_file(std::string{file_name}, compression);
+    return reader != nullptr && read_all(*reader, text);
+}
+
+bool stream_compressed_file(const std::string_view file_name, const SourceCompression compression,
+        const std::function<bool(std::string_view block)>& consume) {
+    const auto reader = open_compressed_file(std::string{file_name}, compression);
+    if(reader == nullptr || !reader->Rewind()) {
+        return false;
+    }
+    std::vector<char> block(PREFETCH_BLOCK_SIZE);
+    while(true) {
+        const auto read = reader->Read(block.data(), block.size());
+        if(read == READ_FAILED) {
+            return false;
+        }
+        if(read == 0) {
+            return true;
+        }
+        if(!consume({block.data(), read})) {
+            return false;
+        }
+    }
+}
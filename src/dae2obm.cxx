@@ -1,201 +1,978 @@
 #include <dae2obm.hxx>
 
-#include <cstdlib>
+#include <cctype>
+#include <cstdio>
 #include <cstring>
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <chrono>
-#include <iostream>
+#include <climits>
+#include <filesystem>
+#include <numeric>
+#include <thread>
+#include <utility>
 
-int convert(const std::string_view input_file_name, const std::string_view output_file_name) {
-    tinyxml2::XMLDocument collada_file{};
-    const auto load_file_error = collada_file.LoadFile(input_file_name.data());
+#include <bounded_queue.hxx>
+#include <compression.hxx>
+#include <out_of_core.hxx>
+
+namespace {
+
+constexpr std::size_t STANDARD_INPUT_READ_SIZE = 1 << 20;
+
+// Reads until the end of the standard input, which can be neither sized nor seeked, in large reads into a buffer
+// growing by doubling.
+bool read_standard_input(std::string& text) {
+    std::size_t size{};
+    while(true) {
+        if(text.size() - size < STANDARD_INPUT_READ_SIZE) {
+            text.resize(std::max(2 * text.size(), size + STANDARD_INPUT_READ_SIZE));
+        }
+        const auto read = std::fread(text.data() + size, 1, STANDARD_INPUT_READ_SIZE, stdin);
+        size += read;
+        if(read < STANDARD_INPUT_READ_SIZE) {
+            text.resize(size);
+            return std::ferror(stdin) == 0;
+        }
+    }
+}
+
+bool write_standard_output(const std::string_view bytes) {
+    return std::fwrite(bytes.data(), 1, bytes.size(), stdout) == bytes.size();
+}
+
+// Whether the arrays of the geometries from geometry on hold at least minimum_bytes of text, counting only as far as
+// needed.
+bool has_array_text(const tinyxml2::XMLElement* geometry, const std::size_t minimum_bytes) {
+    std::size_t bytes{};
+    std::vector<const tinyxml2::XMLElement*> pending{};
+    for(; geometry != nullptr; geometry = geometry->NextSiblingElement()) {
+        pending.push_back(geometry);
+        while(!pending.empty()) {
+            const auto element = pending.back();
+            pending.pop_back();
+            bytes += element_text(element).size();
+            if(bytes >= minimum_bytes) {
+                return true;
+            }
+            for(auto child = element->FirstChildElement(); child != nullptr; child = child->NextSiblingElement()) {
+                pending.push_back(child);
+            }
+        }
+    }
+    return false;
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Time a stage of convert_pipelined spent working, and waiting on its queues.
+struct StageTimes {
+    const char* name{};
+    Clock::duration busy{};
+    Clock::duration waiting{};
+};
+
+// Adds the lifetime of the scope to the total.
+struct ScopedTimer {
+    explicit ScopedTimer(Clock::duration& total)
+            : total{total} {}
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        total += Clock::now() - start_time;
+    }
+
+    Clock::duration& total;
+    const Clock::time_point start_time{Clock::now()};
+};
+
+template<typename Item>
+bool timed_push(BoundedQueue<Item>& queue, Item&& item, StageTimes& times) {
+    const ScopedTimer timer{times.waiting};
+    return queue.push(std::move(item));
+}
+
+template<typename Item>
+bool timed_pop(BoundedQueue<Item>& queue, Item& item, StageTimes& times) {
+    const ScopedTimer timer{times.waiting};
+    return queue.pop(item);
+}
+
+// The busiest stage bounds the whole conversion: the others wait on it.
+void report_stage_times(const ConversionOptions& options, const std::string_view input_file_name,
+        const std::size_t meshes_count, const Clock::duration elapsed_time, const std::array<StageTimes, 3>& stages) {
+    const auto seconds = [](const Clock::duration duration) {
+        return std::chrono::duration<double>(duration).count();
+    };
+    report(options, "Stages of \"", input_file_name, "\" (", meshes_count, " meshes in ", seconds(elapsed_time), "s):");
+    for(const auto& stage : stages) {
+        const auto utilization = elapsed_time.count() != 0 ? 100.0 * seconds(stage.busy) / seconds(elapsed_time) : 0.0;
+        report(options, " ", stage.name, " ", seconds(stage.busy), "s busy (", static_cast<int>(utilization + 0.5),
+                "%), ", seconds(stage.waiting), "s waiting", &stage != &stages.back() ? "," : ".");
+    }
+    const auto bottleneck = std::max_element(stages.begin(), stages.end(),
+            [](const StageTimes& lhs, const StageTimes& rhs) { return lhs.busy < rhs.busy; });
+    report(options, " Bottleneck: ", bottleneck->name, ".\n");
+}
+
+std::size_t serialized_size(const Mesh& mesh) {
+    return sizeof(mesh.present_attributes) + 7 * sizeof(std::uint32_t) + sizeof(Bounds)
+            + mesh.positions.size() * sizeof(Vector3) + mesh.tex_coords.size() * sizeof(Vector2)
+            + mesh.normals.size() * sizeof(Vector3) + mesh.colors.size() * sizeof(Vector3)
+            + mesh.tangents.size() * sizeof(Vector4)
+            + (mesh.position_indices.size() + mesh.tex_coords_indices.size() + mesh.normal_indices.size()
+                    + mesh.color_indices.size() + mesh.tangent_indices.size()) * sizeof(std::uint32_t)
+            + mesh.bvh_nodes.size() * sizeof(BvhNode) + mesh.bvh_triangle_indices.size() * sizeof(std::uint32_t);
+}
+
+template<typename Bytes>
+void append_mesh(Bytes& section, const Mesh& mesh) {
+    static_assert(sizeof(Vector2) == 8 && sizeof(Vector3) == 12 && sizeof(Vector4) == 16 && sizeof(BvhNode) == 32,
+            "Vectors and nodes are written as they are laid out in memory");
+    const auto indices_count = static_cast<std::uint32_t>(mesh.position_indices.size());
+    const auto bvh_nodes_count = static_cast<std::uint32_t>(mesh.bvh_nodes.size());
+    append_value(section, mesh.present_attributes);
+    append_value(section, static_cast<std::uint32_t>(mesh.positions.size()));
+    append_value(section, static_cast<std::uint32_t>(mesh.tex_coords.size()));
+    append_value(section, static_cast<std::uint32_t>(mesh.normals.size()));
+    append_value(section, static_cast<std::uint32_t>(mesh.colors.size()));
+    append_value(section, static_cast<std::uint32_t>(mesh.tangents.size()));
+    append_value(section, indices_count);
+    append_value(section, mesh.bounds.aabb_min);
+    append_value(section, mesh.bounds.aabb_max);
+    append_value(section, mesh.bounds.sphere_center);
+    append_value(section, mesh.bounds.sphere_radius);
+    append_value(section, bvh_nodes_count);
+    append_values(section, mesh.positions);
+    append_values(section, mesh.tex_coords);
+    append_values(section, mesh.normals);
+    append_values(section, mesh.colors);
+    append_values(section, mesh.tangents);
+    append_values(section, mesh.position_indices);
+    append_values(section, mesh.tex_coords_indices);
+    append_values(section, mesh.normal_indices);
+    append_values(section, mesh.color_indices);
+    append_values(section, mesh.tangent_indices);
+    append_values(section, mesh.bvh_nodes);
+    append_values(section, mesh.bvh_triangle_indices);
+}
+
+} // namespace
+
+ParallelParseScope::ParallelParseScope(tinyxml2::XMLDocument& collada_file, const ConversionOptions& options)
+        : collada_file{collada_file}, options{options} {
+    collada_file.SetParallelParse("library_", this);
+}
+
+ParallelParseScope::~ParallelParseScope() {
+    collada_file.SetParallelParse(nullptr, nullptr);
+}
+
+int ParallelParseScope::Concurrency() const {
+    return static_cast<int>(std::min<std::size_t>(options.threads_count, INT_MAX));
+}
+
+void ParallelParseScope::Run(const int count, void (*task)(void* context, int index), void* context) {
+    const ExecutorScope executor_scope{options.executor};
+    // Chunks are taken in order by whichever thread is free, as their parse times vary.
+    std::atomic<int> next_chunk{};
+    const auto threads_count = std::min<std::size_t>(options.threads_count, static_cast<std::size_t>(count));
+    parallel_for(threads_count, threads_count, 1, [&](const std::size_t, const std::size_t) {
+        for(auto chunk = next_chunk++; chunk < count; chunk = next_chunk++) {
+            task(context, chunk);
+        }
+    });
+}
+
+void configure_document(tinyxml2::XMLDocument& collada_file) {
+    collada_file.SetPoolBlockSize(POOL_BLOCK_BYTES, true);
+}
+
+int convert(const std::string_view input_file_name, const std::string_view output_file_name,
+        const ConversionOptions& options) {
+    tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+    configure_document(collada_file);
+    return convert(collada_file, input_file_name, output_file_name, options);
+}
+
+int convert(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options) {
+    if(options.max_memory != 0) {
+        return convert_out_of_core(input_file_name, output_file_name, options);
+    }
+    const ParallelParseScope parallel_parse_scope{collada_file, options};
+    auto load_file_error = tinyxml2::XMLError::XML_ERROR_FILE_READ_ERROR;
+    if(input_file_name == STANDARD_STREAM_FILE_NAME) {
+        std::string text{};
+        if(read_standard_input(text)) {
+            load_file_error = collada_file.Parse(text.data(), text.size());
+        }
+    } else if(const auto compression = detect_compression(input_file_name); compression != SourceCompression::none) {
+        load_file_error = load_compressed_file(collada_file, input_file_name, compression);
+    } else {
+        load_file_error = collada_file.LoadFile(std::string{input_file_name}.c_str());
+    }
     if(load_file_error != tinyxml2::XMLError::XML_SUCCESS) {
-        std::cerr << "Failed to open collada source file \"" << input_file_name << "\"; exiting...\n";
+        report(options, "Failed to open collada source file \"", input_file_name, "\".\n");
         return 1;
     }
+    return convert_document(collada_file, input_file_name, output_file_name, options);
+}
+
+int convert_document(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const std::string_view output_file_name, const ConversionOptions& options) {
+    auto result = 0;
+    if(output_file_name == STANDARD_STREAM_FILE_NAME) {
+        result = convert_pipelined(collada_file, input_file_name, options, write_standard_output);
+        if(result == 0 && std::fflush(stdout) != 0) {
+            result = 7;
+        }
+    } else if(options.restat) {
+        // The output is compared with the file before anything is written, so every section is kept until the end.
+        std::vector<std::string> sections{};
+        auto header_written = false;
+        result = convert_pipelined(collada_file, input_file_name, options, [&](const std::string_view bytes) {
+            if(header_written) {
+                sections.emplace_back(bytes);
+            }
+            header_written = true;
+            return true;
+        });
+        if(result == 0 && !write_sections(output_file_name, sections, true)) {
+            result = 7;
+        }
+    } else {
+        // Written under a temporary name then renamed, so that a failed conversion leaves the previous output, and a
+        // hard link to a cache entry is replaced rather than written through. Outputs that are not files, such as
+        // devices and pipes, are written in place.
+        namespace fs = std::filesystem;
+        const fs::path output_path{output_file_name};
+        std::error_code error{};
+        const auto status = fs::status(output_path, error);
+        const auto in_place = fs::exists(status) && !fs::is_regular_file(status);
+        const auto written_file_name = in_place ? output_path.string() : output_path.string() + ".part";
+        std::ofstream output_file{written_file_name, std::ios::binary | std::ios::trunc};
+        result = output_file.is_open() ? convert_pipelined(collada_file, input_file_name, options,
+                [&](const std::string_view bytes) {
+                    return static_cast<bool>(output_file.write(bytes.data(),
+                            static_cast<std::streamsize>(bytes.size())));
+                }) : 7;
+        output_file.close();
+        if(result == 0 && (!output_file || (!in_place && (fs::rename(written_file_name, output_path, error), error)))) {
+            result = 7;
+        }
+        if(result != 0 && !in_place) {
+            fs::remove(written_file_name, error);
+        }
+    }
+    if(result == 7) {
+        report(options, "Failed to write to file \"", output_file_name, "\".\n");
+    }
+    return result;
+}
+
+int convert_buffer(const std::string_view collada_text, std::pmr::string& obm_bytes, const ConversionOptions& options) {
+    tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+    configure_document(collada_file);
+    return convert_buffer(collada_file, collada_text, obm_bytes, options);
+}
+
+int convert_buffer(tinyxml2::XMLDocument& collada_file, const std::string_view collada_text,
+        std::pmr::string& obm_bytes, const ConversionOptions& options) {
+    const ParallelParseScope parallel_parse_scope{collada_file, options};
+    if(collada_file.Parse(collada_text.data(), collada_text.size()) != tinyxml2::XMLError::XML_SUCCESS) {
+        report(options, "Failed to parse collada source buffer.\n");
+        return 1;
+    }
+    obm_bytes.clear();
+    const auto result = convert_pipelined(collada_file, "<buffer>", options, [&](const std::string_view bytes) {
+        obm_bytes.append(bytes.data(), bytes.size());
+        return true;
+    });
+    if(result != 0) {
+        obm_bytes.clear();
+    }
+    return result;
+}
+
+int convert_pipelined(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const ConversionOptions& options, const std::function<bool(std::string_view bytes)>& write) {
+    const ExecutorScope executor_scope{options.executor};
     auto collada_root_node = collada_file.FirstChildElement("COLLADA");
     if(collada_root_node == nullptr) {
-        std::cerr << "Collada root node was not found; exiting...\n";
+        report(options, "Collada root node was not found in \"", input_file_name, "\".\n");
         return 2;
     }
-    const auto meshes = load_meshes(collada_root_node);
-    const auto write_success = write_meshes(output_file_name, meshes);
-    if(!write_success) {
-        std::cerr << "Failed to write to file \"" << output_file_name << "\"; exiting...";
+    const auto id_index = build_id_index(collada_root_node);
+    const auto geometries_library = collada_root_node->FirstChildElement("library_geometries");
+    auto geometry = geometries_library != nullptr ? geometries_library->FirstChildElement("geometry") : nullptr;
+    if(geometry == nullptr) {
+        report(options, "Error: No geometries found in geometries library.\n");
+        return 3;
+    }
+    std::size_t meshes_count{};
+    for(auto next = geometry; next != nullptr; next = next->NextSiblingElement()) {
+        ++meshes_count;
+    }
+    if(const auto count_error = check_meshes_count(meshes_count, input_file_name, options); count_error != 0) {
+        return count_error;
+    }
+    std::string bytes{};
+    append_file_header(bytes, meshes_count);
+    if(!write(bytes)) {
         return 7;
     }
-    return 0;
+
+    std::array<StageTimes, 3> stages{{{"load"}, {"post-process"}, {"write"}}};
+    auto& [load_times, post_process_times, write_times] = stages;
+    auto load_error = 0;
+    auto write_failed = false;
+    const auto load = [&](Mesh& mesh) {
+        const ScopedTimer timer{load_times.busy};
+        const auto mesh_id = geometry->Attribute("id");
+        const auto mesh_node = geometry->FirstChildElement("mesh");
+        if(mesh_node == nullptr) {
+            report(options, "Error: Geometry doesn't contain \"mesh\" node.\n");
+            load_error = 4;
+            return false;
+        }
+        load_error = load_mesh(mesh_node, mesh_id != nullptr ? mesh_id : "", id_index, options, mesh);
+        geometry = geometry->NextSiblingElement();
+        return load_error == 0;
+    };
+    // The post-process stage walks the geometries on its own for the ids of its meshes, as they are loaded in order.
+    auto post_process_geometry = geometry;
+    const auto post_process = [&](Mesh& mesh) {
+        const ScopedTimer timer{post_process_times.busy};
+        const auto mesh_id = post_process_geometry->Attribute("id");
+        post_process_mesh(mesh, mesh_id != nullptr ? mesh_id : "", options);
+        post_process_geometry = post_process_geometry->NextSiblingElement();
+    };
+    const auto serialize = [&](const Mesh& mesh) {
+        const ScopedTimer timer{write_times.busy};
+        serialize_mesh(mesh, bytes);
+        write_failed = !write(bytes);
+        return !write_failed;
+    };
+
+    const auto start_time = Clock::now();
+    const auto threaded = options.threads_count > 1 && !options.executor && meshes_count > 1
+            && has_array_text(geometry, meshes_count * PIPELINE_MIN_GEOMETRY_BYTES);
+    if(!threaded) {
+        while(geometry != nullptr) {
+            Mesh mesh{};
+            if(!load(mesh)) {
+                break;
+            }
+            post_process(mesh);
+            if(!serialize(mesh)) {
+                break;
+            }
+        }
+    } else {
+        // A failing stage cancels both queues, which stops the others.
+        BoundedQueue<Mesh> loaded{PIPELINE_QUEUE_CAPACITY};
+        BoundedQueue<Mesh> processed{PIPELINE_QUEUE_CAPACITY};
+        std::thread post_process_thread{[&] {
+            Mesh mesh{};
+            while(timed_pop(loaded, mesh, post_process_times)) {
+                post_process(mesh);
+                if(!timed_push(processed, std::move(mesh), post_process_times)) {
+                    break;
+                }
+            }
+            processed.close();
+        }};
+        std::thread write_thread{[&] {
+            Mesh mesh{};
+            while(timed_pop(processed, mesh, write_times)) {
+                if(!serialize(mesh)) {
+                    loaded.cancel();
+                    processed.cancel();
+                }
+            }
+        }};
+        while(geometry != nullptr) {
+            Mesh mesh{};
+            if(!load(mesh)) {
+                loaded.cancel();
+                processed.cancel();
+                break;
+            }
+            if(!timed_push(loaded, std::move(mesh), load_times)) {
+                break;
+            }
+        }
+        loaded.close();
+        post_process_thread.join();
+        write_thread.join();
+    }
+    if(options.report_stages) {
+        report_stage_times(options, input_file_name, meshes_count, Clock::now() - start_time, stages);
+    }
+    if(load_error != 0) {
+        return load_error;
+    }
+    return write_failed ? 7 : 0;
 }
 
-std::vector<Mesh> load_meshes(tinyxml2::XMLElement* collada_root_node) {
-    std::vector<Mesh> meshes{};
+int load_document(tinyxml2::XMLDocument& collada_file, const std::string_view input_file_name,
+        const ConversionOptions& options, std::vector<Mesh>& meshes) {
+    const ExecutorScope executor_scope{options.executor};
+    auto collada_root_node = collada_file.FirstChildElement("COLLADA");
+    if(collada_root_node == nullptr) {
+        report(options, "Collada root node was not found in \"", input_file_name, "\".\n");
+        return 2;
+    }
+    const auto id_index = build_id_index(collada_root_node);
+    const auto load_error = load_meshes(collada_root_node, id_index, options, meshes);
+    if(load_error != 0) {
+        return load_error;
+    }
     auto geometry = collada_root_node->FirstChildElement("library_geometries")->FirstChildElement("geometry");
+    for(auto& mesh : meshes) {
+        const auto mesh_id = geometry->Attribute("id");
+        post_process_mesh(mesh, mesh_id != nullptr ? mesh_id : "", options);
+        geometry = geometry->NextSiblingElement();
+    }
+    return 0;
+}
+
+IdIndex build_id_index(const tinyxml2::XMLElement* root_node) {
+    IdIndex id_index{};
+    std::vector<const tinyxml2::XMLElement*> pending{root_node};
+    while(!pending.empty()) {
+        const auto element = pending.back();
+        pending.pop_back();
+        const auto id = element->Attribute("id");
+        if(id != nullptr) {
+            id_index.emplace(id, element);
+        }
+        for(auto child = element->FirstChildElement(); child != nullptr; child = child->NextSiblingElement()) {
+            pending.emplace_back(child);
+        }
+    }
+    return id_index;
+}
+
+const tinyxml2::XMLElement* resolve_url(const IdIndex& id_index, const char* url) {
+    if(url == nullptr || url[0] != '#') {
+        return nullptr;
+    }
+    const auto element = id_index.find(std::string_view{url + 1});
+    return element != id_index.end() ? element->second : nullptr;
+}
+
+int load_meshes(tinyxml2::XMLElement* collada_root_node, const IdIndex& id_index, const ConversionOptions& options,
+        std::vector<Mesh>& meshes) {
+    const auto geometries_library = collada_root_node->FirstChildElement("library_geometries");
+    auto geometry = geometries_library != nullptr ? geometries_library->FirstChildElement("geometry") : nullptr;
     if(geometry == nullptr) {
-        std::cout << "No geometries found in geometries library; exiting...\n";
-        std::exit(3);
+        report(options, "Error: No geometries found in geometries library.\n");
+        return 3;
     }
     while(geometry != nullptr) {
-        const auto mesh_id = geometry->Attribute("id", nullptr);
+        const auto mesh_id = geometry->Attribute("id");
         const auto mesh_node = geometry->FirstChildElement("mesh");
         if(mesh_node == nullptr) {
-            std::cout << "Geometry doesn't contain \"mesh\" node; exiting...";
-            std::exit(4);
+            report(options, "Error: Geometry doesn't contain \"mesh\" node.\n");
+            return 4;
+        }
+        const auto load_error = load_mesh(mesh_node, mesh_id != nullptr ? mesh_id : "", id_index, options,
+                meshes.emplace_back());
+        if(load_error != 0) {
+            return load_error;
         }
-        meshes.emplace_back(load_mesh(mesh_node, mesh_id));
         geometry = geometry->NextSiblingElement();
     }
-    return meshes;
-}
-
-Mesh load_mesh(tinyxml2::XMLNode* mesh_node, const std::string_view mesh_id) {
-    Mesh mesh{};
-    auto vertex_attributes_node = mesh_node->FirstChildElement("source");
-    while(vertex_attributes_node != nullptr) {
-        const std::string vertex_attributes_node_id{vertex_attributes_node->Attribute("id")};
-        const std::string attribute_name{mesh_id};
-        if(vertex_attributes_node_id == attribute_name + "-positions") {
-            mesh.positions = load_vector_vector3_from_xml_node(vertex_attributes_node);
-        } else if(vertex_attributes_node_id == attribute_name + "-map-0") {
-            mesh.tex_coords = load_vector_vector2_from_xml_node(vertex_attributes_node);
-        } else if(vertex_attributes_node_id == attribute_name + "-normals") {
-            mesh.normals = load_vector_vector3_from_xml_node(vertex_attributes_node);
-        } else if(vertex_attributes_node_id == attribute_name + "-colors-Col") {
-            mesh.colors = load_vector_vector3_from_xml_node(vertex_attributes_node);
-        } else {
-            std::cerr << "Error: Unknown mesh attribute: " << vertex_attributes_node_id << ".\n";
-            std::exit(5);
-        }
-        vertex_attributes_node = vertex_attributes_node->NextSiblingElement("source");
-    }
-    const auto indices_node = mesh_node->FirstChildElement("polylist");
-    if(indices_node == nullptr) {
-        std::cerr << "Error: Indices node was not found; exiting...\n";
-        std::exit(6);
-    }
-    const std::size_t indices_count = indices_node->UnsignedAttribute("count");
-    check_present_attributes_and_load_indices(indices_node, indices_count, mesh.present_attributes,
-            mesh.position_indices, mesh.tex_coords_indices, mesh.normal_indices, mesh.color_indices);
-    return mesh;
-}
-
-std::vector<Vector2> load_vector_vector2_from_xml_node(const tinyxml2::XMLElement* node) {
-    std::vector<Vector2> vectors{};
-    const auto values_array_node{node->FirstChildElement("float_array")};
-    std::stringstream values_array_stream{values_array_node->GetText()};
-    while(!values_array_stream.eof()) {
-        vectors.emplace_back(load_vector2_from_sstream(values_array_stream));
-    }
-    return vectors;
-}
-
-std::vector<Vector3> load_vector_vector3_from_xml_node(const tinyxml2::XMLElement* node) {
-    std::vector<Vector3> vectors{};
-    const auto values_array_node{node->FirstChildElement("float_array")};
-    std::stringstream values_array_stream{values_array_node->GetText()};
-    while(!values_array_stream.eof()) {
-        vectors.emplace_back(load_vector3_from_sstream(values_array_stream));
-    }
-    return vectors;
-}
-
-bool check_present_attributes_and_load_indices(tinyxml2::XMLElement* indices_node, const std::size_t count,
-        uint8_t& attribs, std::vector<std::uint32_t>& position_indices, std::vector<std::uint32_t>& normal_indices,
-        std::vector<std::uint32_t>& tex_coords_indices, std::vector<std::uint32_t>& color_indices) {
-    // TODO: Check if attributes are present.
-    attribs = POSITIONS_PRESENT | TEX_COORDS_PRESENT | NORMALS_PRESENT | COLORS_PRESENT;
-    std::stringstream indices_stream{indices_node->FirstChildElement("p")->GetText()};
-    for(std::size_t i{}; i < count / 4; ++i) {
-        auto& posi = position_indices.emplace_back();
-        auto& txci = tex_coords_indices.emplace_back();
-        auto& nrmi = normal_indices.emplace_back();
-        auto& clri = color_indices.emplace_back();
-        indices_stream >> posi >> txci >> nrmi >> clri;
+    return 0;
+}
+
+int load_mesh(tinyxml2::XMLNode* mesh_node, const std::string_view mesh_id, const IdIndex& id_index,
+        const ConversionOptions& options, Mesh& mesh) {
+    SourceBindings bindings{};
+    // Every primitive element is triangulated on its own and appended to the mesh. Attributes missing from any of the
+    // primitives are dropped from the whole mesh.
+    mesh.present_attributes = POSITIONS_PRESENT | TEX_COORDS_PRESENT | NORMALS_PRESENT | COLORS_PRESENT;
+    bool primitive_found{};
+    auto primitive_node = mesh_node->FirstChildElement();
+    while(primitive_node != nullptr) {
+        PrimitiveType type{};
+        if(primitive_type_from_name(primitive_node->Name(), type)) {
+            Mesh primitive{};
+            if(!load_primitive(primitive_node, type, id_index, options, bindings, mesh, primitive)) {
+                report(options, "Error: Invalid inputs or indices in mesh \"", mesh_id, "\".\n");
+                return 8;
+            }
+            append_primitive(primitive, mesh);
+            primitive_found = true;
+        }
+        primitive_node = primitive_node->NextSiblingElement();
+    }
+    if(!primitive_found) {
+        report(options, "Error: Indices node was not found in mesh \"", mesh_id, "\".\n");
+        return 6;
+    }
+    if((mesh.present_attributes & TEX_COORDS_PRESENT) == 0) {
+        mesh.tex_coords.clear();
+        mesh.tex_coords_indices.clear();
+    }
+    if((mesh.present_attributes & NORMALS_PRESENT) == 0) {
+        mesh.normals.clear();
+        mesh.normal_indices.clear();
+    }
+    if((mesh.present_attributes & COLORS_PRESENT) == 0) {
+        mesh.colors.clear();
+        mesh.color_indices.clear();
+    }
+    return 0;
+}
+
+void post_process_mesh(Mesh& mesh, const std::string_view mesh_id, const ConversionOptions& options) {
+    if(options.weld) {
+        weld_mesh(mesh, options.weld_epsilon, options.threads_count);
+    }
+    // Tangents are generated from normals, so meshes without normals get them for tangents too.
+    if(options.generate_normals || options.generate_tangents) {
+        generate_normals(mesh, options.crease_angle_degrees, options.threads_count);
+    }
+    if(options.generate_tangents && !generate_tangents(mesh, options.threads_count)) {
+        report(options, "Warning: Mesh \"", mesh_id, "\" has no texture coordinates, its tangents were not "
+                "generated.\n");
+    }
+    mesh.bounds = compute_bounds(mesh.positions, options.threads_count);
+    if(options.build_bvh) {
+        build_bvh(mesh, options.threads_count);
+    }
+}
+
+bool primitive_type_from_name(const std::string_view name, PrimitiveType& type) {
+    if(name == "polylist" || name == "polygons") {
+        type = PrimitiveType::POLYGONS;
+    } else if(name == "triangles") {
+        type = PrimitiveType::TRIANGLES;
+    } else if(name == "tristrips") {
+        type = PrimitiveType::TRISTRIPS;
+    } else if(name == "trifans") {
+        type = PrimitiveType::TRIFANS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool load_primitive(const tinyxml2::XMLElement* primitive_node, const PrimitiveType type, const IdIndex& id_index,
+        const ConversionOptions& options, SourceBindings& bindings, Mesh& mesh, Mesh& primitive) {
+    // Every <input> occupies the slot given by its offset in each interleaved corner, several inputs may share a slot
+    // and the stride of a corner is the highest offset plus one. Inputs of the referenced <vertices> element share the
+    // slot of the VERTEX input, inputs declared on the primitive itself take precedence over them.
+    std::size_t stride{};
+    std::array<std::size_t, ATTRIBUTES_COUNT> offsets{};
+    std::array<const tinyxml2::XMLElement*, ATTRIBUTES_COUNT> sources{};
+    for(const auto vertices_pass : {true, false}) {
+        auto input = primitive_node->FirstChildElement("input");
+        while(input != nullptr) {
+            const std::string_view semantic{input->Attribute("semantic") ? input->Attribute("semantic") : ""};
+            const std::size_t offset = input->UnsignedAttribute("offset");
+            stride = std::max(stride, offset + 1);
+            if(semantic == "VERTEX" && vertices_pass) {
+                const auto vertices_node = resolve_url(id_index, input->Attribute("source"));
+                if(vertices_node == nullptr) {
+                    return false;
+                }
+                auto vertices_input = vertices_node->FirstChildElement("input");
+                while(vertices_input != nullptr) {
+                    const auto attribute = attribute_from_semantic(vertices_input->Attribute("semantic"), 0);
+                    if(attribute < ATTRIBUTES_COUNT) {
+                        offsets[attribute] = offset;
+                        sources[attribute] = resolve_url(id_index, vertices_input->Attribute("source"));
+                    }
+                    vertices_input = vertices_input->NextSiblingElement("input");
+                }
+            } else if(semantic != "VERTEX" && !vertices_pass) {
+                const auto attribute = attribute_from_semantic(semantic, input->UnsignedAttribute("set"));
+                if(attribute < ATTRIBUTES_COUNT && attribute != POSITIONS_ATTRIBUTE) {
+                    offsets[attribute] = offset;
+                    sources[attribute] = resolve_url(id_index, input->Attribute("source"));
+                }
+            }
+            input = input->NextSiblingElement("input");
+        }
+    }
+    if(sources[POSITIONS_ATTRIBUTE] == nullptr) {
+        return false;
+    }
+    std::array<SourceBinding, ATTRIBUTES_COUNT> source_bindings{};
+    for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+        if(sources[attribute] != nullptr) {
+            if(!bind_source(sources[attribute], attribute, id_index, bindings, mesh, source_bindings[attribute])) {
+                return false;
+            }
+            primitive.present_attributes |= static_cast<std::uint8_t>(1 << attribute);
+        }
+    }
+    // <polylist> sizes its polygons with <vcount>. In <polygons>, <tristrips> and <trifans> every <p> (or the outer
+    // boundary of a <ph>, whose holes are ignored) is one primitive, while <triangles> only needs its corners.
+    std::vector<std::uint32_t> values{};
+    std::vector<std::uint32_t> vertex_counts{};
+    const auto vcount_node = primitive_node->FirstChildElement("vcount");
+    if(vcount_node != nullptr && !load_uint32_array(element_text(vcount_node), vertex_counts)) {
+        return false;
+    }
+    auto p_node = primitive_node->FirstChildElement();
+    while(p_node != nullptr) {
+        const std::string_view name{p_node->Name()};
+        const auto indices_node = name == "ph" ? p_node->FirstChildElement("p") : p_node;
+        if((name == "p" || name == "ph") && indices_node != nullptr) {
+            const auto values_count = values.size();
+            if(!load_uint32_array(element_text(indices_node), values) || (values.size() - values_count) % stride != 0) {
+                return false;
+            }
+            if(vcount_node == nullptr && type != PrimitiveType::TRIANGLES) {
+                vertex_counts.emplace_back(static_cast<std::uint32_t>((values.size() - values_count) / stride));
+            }
+        }
+        p_node = p_node->NextSiblingElement();
+    }
+    const auto corners_count = values.size() / stride;
+    if(type == PrimitiveType::TRIANGLES ? corners_count % 3 != 0
+            : std::accumulate(vertex_counts.begin(), vertex_counts.end(), std::uint64_t{}) != corners_count) {
+        return false;
+    }
+    const std::array<std::vector<std::uint32_t>*, ATTRIBUTES_COUNT> indices{&primitive.position_indices,
+            &primitive.tex_coords_indices, &primitive.normal_indices, &primitive.color_indices};
+    for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+        if(sources[attribute] == nullptr) {
+            continue;
+        }
+        deinterleave_indices(values, stride, offsets[attribute], *indices[attribute]);
+        if(!check_indices_in_range(*indices[attribute], source_bindings[attribute].values_count)) {
+            return false;
+        }
+        if(source_bindings[attribute].first_value != 0) {
+            for(auto& index : *indices[attribute]) {
+                index += source_bindings[attribute].first_value;
+            }
+        }
+    }
+    if(type != PrimitiveType::TRIANGLES) {
+        const auto corners = triangulate(type, vertex_counts, primitive.position_indices, mesh.positions,
+                options.threads_count);
+        gather_indices(corners, primitive.position_indices, options.threads_count);
+        gather_indices(corners, primitive.tex_coords_indices, options.threads_count);
+        gather_indices(corners, primitive.normal_indices, options.threads_count);
+        gather_indices(corners, primitive.color_indices, options.threads_count);
     }
     return true;
 }
 
-Vector2 load_vector2_from_sstream(std::stringstream& stream) {
-    Vector2 vec{};
-    stream >> vec.x >> vec.y;
-    return vec;
+std::size_t attribute_from_semantic(const std::string_view semantic, const unsigned set) {
+    if(semantic == "POSITION") {
+        return POSITIONS_ATTRIBUTE;
+    } else if(semantic == "TEXCOORD" && set == 0) {
+        return TEX_COORDS_ATTRIBUTE;
+    } else if(semantic == "NORMAL") {
+        return NORMALS_ATTRIBUTE;
+    } else if(semantic == "COLOR" && set == 0) {
+        return COLORS_ATTRIBUTE;
+    }
+    return ATTRIBUTES_COUNT;
+}
+
+bool bind_source(const tinyxml2::XMLElement* source_node, const std::size_t attribute, const IdIndex& id_index,
+        SourceBindings& bindings, Mesh& mesh, SourceBinding& binding) {
+    // Sources shared by several primitives are loaded once, different sources for the same attribute are appended.
+    auto& attribute_bindings = bindings[attribute];
+    const auto bound = std::find_if(attribute_bindings.begin(), attribute_bindings.end(),
+            [source_node](const SourceBinding& bound_source) { return bound_source.source_node == source_node; });
+    if(bound != attribute_bindings.end()) {
+        binding = *bound;
+        return true;
+    }
+    const auto load = [&](auto& vectors) {
+        binding.first_value = static_cast<std::uint32_t>(vectors.size());
+        const auto success = load_vectors_from_source(source_node, id_index, vectors);
+        binding.values_count = static_cast<std::uint32_t>(vectors.size() - binding.first_value);
+        return success;
+    };
+    binding.source_node = source_node;
+    bool success{};
+    switch(attribute) {
+    case POSITIONS_ATTRIBUTE:
+        success = load(mesh.positions);
+        break;
+    case TEX_COORDS_ATTRIBUTE:
+        success = load(mesh.tex_coords);
+        break;
+    case NORMALS_ATTRIBUTE:
+        success = load(mesh.normals);
+        break;
+    case COLORS_ATTRIBUTE:
+        success = load(mesh.colors);
+        break;
+    }
+    attribute_bindings.emplace_back(binding);
+    return success;
 }
 
-Vector3 load_vector3_from_sstream(std::stringstream& stream) {
-    Vector3 vec{};
-    stream >> vec.x >> vec.y >> vec.z;
-    return vec;
+bool check_indices_in_range(const std::vector<std::uint32_t>& indices, const std::size_t values_count) {
+    return std::all_of(indices.begin(), indices.end(), [values_count](const std::uint32_t index) {
+        return index < values_count;
+    });
 }
 
-bool write_meshes(const std::string_view file_name, const std::vector<Mesh>& meshes) {
-    std::fstream output_file{file_name.data(), std::ios::out | std::ios::binary | std::ios::trunc};
-    if(!output_file.good()) {
+void gather_indices(const std::vector<std::uint32_t>& corners, std::vector<std::uint32_t>& indices,
+        const std::size_t threads_count) {
+    if(indices.empty()) {
+        return;
+    }
+    std::vector<std::uint32_t> gathered(corners.size());
+    parallel_for(threads_count, corners.size(), 1 << 16, [&](const std::size_t begin, const std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            gathered[i] = indices[corners[i]];
+        }
+    });
+    indices = std::move(gathered);
+}
+
+void append_primitive(const Mesh& primitive, Mesh& mesh) {
+    mesh.present_attributes &= primitive.present_attributes;
+    mesh.position_indices.insert(mesh.position_indices.end(), primitive.position_indices.begin(),
+            primitive.position_indices.end());
+    mesh.tex_coords_indices.insert(mesh.tex_coords_indices.end(), primitive.tex_coords_indices.begin(),
+            primitive.tex_coords_indices.end());
+    mesh.normal_indices.insert(mesh.normal_indices.end(), primitive.normal_indices.begin(),
+            primitive.normal_indices.end());
+    mesh.color_indices.insert(mesh.color_indices.end(), primitive.color_indices.begin(),
+            primitive.color_indices.end());
+}
+
+template<typename Vector>
+bool load_vectors_from_source(const tinyxml2::XMLElement* source_node, const IdIndex& id_index,
+        std::vector<Vector>& vectors) {
+    // The accessor describes how the flat array is split into elements; only the first components of every element
+    // are kept, so that for example RGBA colors load as RGB.
+    constexpr std::size_t components_count = sizeof(Vector) / sizeof(float);
+    const auto accessor_node = source_node->FirstChildElement("technique_common") != nullptr
+            ? source_node->FirstChildElement("technique_common")->FirstChildElement("accessor") : nullptr;
+    const auto array_node = accessor_node != nullptr
+            ? resolve_url(id_index, accessor_node->Attribute("source")) : source_node->FirstChildElement("float_array");
+    if(array_node == nullptr) {
         return false;
     }
-    const auto meshes_count = static_cast<std::uint8_t>(meshes.size());
-    output_file.write("OBMF", 4)
-            .write(reinterpret_cast<const char*>(&meshes_count), 1);
-    for(const auto& mesh : meshes) {
-        const auto positions_count = static_cast<std::uint32_t>(mesh.positions.size());
-        const auto attributes_count = static_cast<std::uint32_t>(mesh.tex_coords.size());
-        const auto positions_indices_count = static_cast<std::uint32_t>(mesh.position_indices.size());
-        const auto attributes_indices_count = static_cast<std::uint32_t>(mesh.tex_coords.size());
-        output_file.write(reinterpret_cast<const char*>(&mesh.present_attributes), sizeof(mesh.present_attributes))
-                .write(reinterpret_cast<const char*>(&positions_count), sizeof(positions_count))
-                .write(reinterpret_cast<const char*>(&attributes_count), sizeof(attributes_count))
-                .write(reinterpret_cast<const char*>(&positions_indices_count), sizeof(positions_indices_count))
-                .write(reinterpret_cast<const char*>(&attributes_indices_count), sizeof(attributes_indices_count));
-        for(const auto& position : mesh.positions) {
-            write_vector3(output_file, position);
+    std::vector<float> values{};
+    if(!load_float_array(element_text(array_node), values)) {
+        return false;
+    }
+    const std::size_t stride = accessor_node != nullptr ? accessor_node->UnsignedAttribute("stride", 1)
+            : components_count;
+    const std::size_t offset = accessor_node != nullptr ? accessor_node->UnsignedAttribute("offset") : 0;
+    const std::size_t count = accessor_node != nullptr ? accessor_node->UnsignedAttribute("count")
+            : values.size() / components_count;
+    if(stride < components_count || (count != 0 && offset + (count - 1) * stride + components_count > values.size())) {
+        return false;
+    }
+    vectors.reserve(vectors.size() + count);
+    for(std::size_t i{}; i < count; ++i) {
+        auto& vec = vectors.emplace_back();
+        std::memcpy(&vec, values.data() + offset + i * stride, sizeof(Vector));
+    }
+    return true;
+}
+
+std::string_view element_text(const tinyxml2::XMLElement* element) {
+    const char* text{};
+    std::size_t length{};
+    return element->GetTextSpan(&text, &length) ? std::string_view{text, length} : std::string_view{};
+}
+
+bool load_float_array(const std::string_view text_span, std::vector<float>& values) {
+    auto text = text_span.data();
+    const auto end = text + text_span.size();
+    while(true) {
+        while(text != end && std::isspace(static_cast<unsigned char>(*text))) {
+            ++text;
         }
-        for(const auto& tex_coords : mesh.tex_coords) {
-            write_vector2(output_file, tex_coords);
+        if(text == end) {
+            return true;
         }
-        for(const auto& normal : mesh.normals) {
-            write_vector3(output_file, normal);
+        auto& value = values.emplace_back();
+        const auto [next, error] = std::from_chars(text, end, value);
+        if(error != std::errc{}) {
+            return false;
         }
-        for(const auto& color : mesh.colors) {
-            write_vector3(output_file, color);
+        text = next;
+    }
+}
+
+bool load_uint32_array(const std::string_view text_span, std::vector<std::uint32_t>& values) {
+    auto text = text_span.data();
+    const auto end = text + text_span.size();
+    while(true) {
+        while(text != end && std::isspace(static_cast<unsigned char>(*text))) {
+            ++text;
         }
-        for(const auto& position_index : mesh.position_indices) {
-            const auto index = static_cast<std::uint32_t>(position_index);
-            output_file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        if(text == end) {
+            return true;
         }
-        for(const auto& tex_coords_index : mesh.tex_coords_indices) {
-            const auto index = static_cast<std::uint32_t>(tex_coords_index);
-            output_file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        auto& value = values.emplace_back();
+        const auto [next, error] = std::from_chars(text, end, value);
+        if(error != std::errc{}) {
+            return false;
         }
-        for(const auto& normal_index : mesh.normal_indices) {
-            const auto index = static_cast<std::uint32_t>(normal_index);
-            output_file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        text = next;
+    }
+}
+
+namespace {
+
+using DeinterleaveKernel = void (*)(const std::uint32_t* values, std::size_t corners_count, std::uint32_t* indices);
+
+template<std::size_t Stride, std::size_t Offset>
+void deinterleave_indices_kernel(const std::uint32_t* values, const std::size_t corners_count, std::uint32_t* indices) {
+    for(std::size_t i{}; i < corners_count; ++i) {
+        indices[i] = values[i * Stride + Offset];
+    }
+}
+
+template<std::size_t Stride, std::size_t... Offsets>
+constexpr std::array<DeinterleaveKernel, MAX_SPECIALIZED_STRIDE> make_deinterleave_kernels(
+        std::index_sequence<Offsets...>) {
+    return {{&deinterleave_indices_kernel<Stride, Offsets>...}};
+}
+
+template<std::size_t... Strides>
+constexpr std::array<std::array<DeinterleaveKernel, MAX_SPECIALIZED_STRIDE>, MAX_SPECIALIZED_STRIDE>
+make_deinterleave_kernel_table(std::index_sequence<Strides...>) {
+    return {{make_deinterleave_kernels<Strides + 1>(std::make_index_sequence<Strides + 1>{})...}};
+}
+
+// deinterleave_kernels[stride - 1][offset] handles every layout with up to MAX_SPECIALIZED_STRIDE inputs.
+constexpr auto deinterleave_kernels = make_deinterleave_kernel_table(
+        std::make_index_sequence<MAX_SPECIALIZED_STRIDE>{});
+
+} // namespace
+
+void deinterleave_indices(const std::vector<std::uint32_t>& values, const std::size_t stride, const std::size_t offset,
+        std::vector<std::uint32_t>& indices) {
+    const auto corners_count = values.size() / stride;
+    indices.resize(corners_count);
+    if(stride <= MAX_SPECIALIZED_STRIDE) {
+        deinterleave_kernels[stride - 1][offset](values.data(), corners_count, indices.data());
+        return;
+    }
+    for(std::size_t i{}; i < corners_count; ++i) {
+        indices[i] = values[i * stride + offset];
+    }
+}
+
+bool write_meshes(const std::string_view file_name, const std::vector<Mesh>& meshes, const bool keep_identical) {
+    if(file_name == STANDARD_STREAM_FILE_NAME) {
+        std::string bytes{};
+        if(!append_file_header(bytes, meshes.size())) {
+            return false;
         }
-        for(const auto& color_index : mesh.color_indices) {
-            const auto index = static_cast<std::uint32_t>(color_index);
-            output_file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        auto written = write_standard_output(bytes);
+        for(std::size_t i{}; written && i < meshes.size(); ++i) {
+            serialize_mesh(meshes[i], bytes);
+            written = write_standard_output(bytes);
         }
+        return std::fflush(stdout) == 0 && written;
     }
-    return true;
+    std::vector<std::string> sections(meshes.size());
+    for(std::size_t i{}; i < meshes.size(); ++i) {
+        serialize_mesh(meshes[i], sections[i]);
+    }
+    return write_sections(file_name, sections, keep_identical);
 }
 
-void write_vector2(std::fstream& file, const Vector2& vec) {
-    file.write(reinterpret_cast<const char*>(&vec.x), sizeof(float))
-            .write(reinterpret_cast<const char*>(&vec.y), sizeof(float));
+bool write_sections(const std::string_view file_name, const std::vector<std::string>& sections,
+        const bool keep_identical) {
+    std::string header{};
+    if(!append_file_header(header, sections.size())) {
+        return false;
+    }
+    std::vector<std::string_view> parts{header};
+    parts.insert(parts.end(), sections.begin(), sections.end());
+    if(file_name == STANDARD_STREAM_FILE_NAME) {
+        const auto written = std::all_of(parts.begin(), parts.end(), write_standard_output);
+        return std::fflush(stdout) == 0 && written;
+    }
+    if(keep_identical && file_equals(file_name, parts)) {
+        return true;
+    }
+    // The file is replaced rather than truncated, as it may be a hard link to a cache entry.
+    std::error_code error{};
+    std::filesystem::remove(std::filesystem::path{file_name}, error);
+    std::fstream output_file{std::string{file_name}, std::ios::out | std::ios::binary | std::ios::trunc};
+    if(!output_file.good()) {
+        return false;
+    }
+    for(const auto part : parts) {
+        output_file.write(part.data(), static_cast<std::streamsize>(part.size()));
+    }
+    return output_file.good();
+}
+
+int check_meshes_count(const std::size_t meshes_count, const std::string_view input_file_name,
+        const ConversionOptions& options) {
+    if(meshes_count > MAX_MESHES_COUNT) {
+        report(options, "Error: \"", input_file_name, "\" has ", meshes_count, " geometries, more than the ",
+                MAX_MESHES_COUNT, " meshes an OBM file holds.\n");
+        return 10;
+    }
+    return 0;
+}
+
+bool file_equals(const std::string_view file_name, const std::vector<std::string_view>& parts) {
+    std::ifstream file{std::string{file_name}, std::ios::binary | std::ios::ate};
+    if(!file.is_open()) {
+        return false;
+    }
+    std::size_t size{};
+    for(const auto part : parts) {
+        size += part.size();
+    }
+    if(static_cast<std::size_t>(file.tellg()) != size) {
+        return false;
+    }
+    file.seekg(0);
+    std::vector<char> buffer(1 << 20);
+    for(const auto part : parts) {
+        for(std::size_t offset{}; offset < part.size(); offset += buffer.size()) {
+            const auto chunk_size = std::min(buffer.size(), part.size() - offset);
+            if(!file.read(buffer.data(), static_cast<std::streamsize>(chunk_size))
+                    || std::memcmp(buffer.data(), part.data() + offset, chunk_size) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-void write_vector3(std::fstream& file, const Vector3& vec) {
-    file.write(reinterpret_cast<const char*>(&vec.x), sizeof(float))
-            .write(reinterpret_cast<const char*>(&vec.y), sizeof(float))
-            .write(reinterpret_cast<const char*>(&vec.z), sizeof(float));
+void serialize_mesh(const Mesh& mesh, std::string& section) {
+    section.clear();
+    section.reserve(serialized_size(mesh));
+    append_mesh(section, mesh);
 }
 
-int main(const int argc, const char* argv[]) {
-    if(argc != 3) {
-        std::cout << "Usage: dae2obm [src.dae] [dest.obm]\n";
-        return 0;
+bool serialize_meshes(const std::vector<Mesh>& meshes, std::pmr::string& bytes) {
+    bytes.clear();
+    if(meshes.size() > MAX_MESHES_COUNT) {
+        return false;
+    }
+    std::size_t size{5};
+    for(const auto& mesh : meshes) {
+        size += serialized_size(mesh);
     }
-    const auto start_time = std::chrono::steady_clock::now();
-    const auto exit_code = convert(argv[1], argv[2]);
-    const auto end_time = std::chrono::steady_clock::now();
-    const std::chrono::duration<float> elapsed_time = end_time - start_time;
-    std::cout << "Conversion time: " << elapsed_time.count() << "s.\n";
-    return exit_code;
+    bytes.reserve(size);
+    append_file_header(bytes, meshes.size());
+    for(const auto& mesh : meshes) {
+        append_mesh(bytes, mesh);
+    }
+    return true;
 }
@@ -0,0 +1,149 @@
+#include <depfile.hxx>
+
+#include <cctype>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include <compression.hxx>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while(!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while(!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int hex_digit(const char digit) {
+    if(digit >= '0' && digit <= '9') {
+        return digit - '0';
+    }
+    const auto lower = static_cast<char>(std::tolower(static_cast<unsigned char>(digit)));
+    return lower >= 'a' && lower <= 'f' ? lower - 'a' + 10 : -1;
+}
+
+// Turns an attribute value or element text naming a file into a path: XML entities and URI escapes are decoded, the
+// fragment and the file scheme removed. Returns an empty path for internal references and non-file URIs.
+std::string reference_to_path(std::string_view reference) {
+    reference = trim(reference);
+    reference = reference.substr(0, reference.find('#'));
+    if(reference.substr(0, 7) == "file://") {
+        reference.remove_prefix(7);
+    } else if(reference.find("://") != std::string_view::npos) {
+        return {};
+    }
+    constexpr std::pair<std::string_view, char> entities[] = {{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'},
+            {"&quot;", '"'}, {"&apos;", '\''}};
+    std::string path{};
+    for(std::size_t i{}; i < reference.size(); ++i) {
+        if(reference[i] == '&') {
+            const auto entity = std::find_if(std::begin(entities), std::end(entities), [&](const auto& candidate) {
+                return reference.compare(i, candidate.first.size(), candidate.first) == 0;
+            });
+            if(entity != std::end(entities)) {
+                path += entity->second;
+                i += entity->first.size() - 1;
+                continue;
+            }
+        } else if(reference[i] == '%' && i + 2 < reference.size() && hex_digit(reference[i + 1]) >= 0
+                && hex_digit(reference[i + 2]) >= 0) {
+            path += static_cast<char>(hex_digit(reference[i + 1]) * 16 + hex_digit(reference[i + 2]));
+            i += 2;
+            continue;
+        }
+        path += reference[i];
+    }
+    return path;
+}
+
+std::string escape_for_make(const std::string_view path) {
+    std::string escaped{};
+    for(const auto character : path) {
+        if(character == ' ' || character == '#' || character == '\\') {
+            escaped += '\\';
+        } else if(character == '$') {
+            escaped += '$';
+        }
+        escaped += character;
+    }
+    return escaped;
+}
+
+} // namespace
+
+std::vector<std::string> find_external_references(const std::string_view text, const std::string_view input_file_name) {
+    std::vector<std::string> references{};
+    for(auto position = text.find("<init_from"); position != std::string_view::npos;
+            position = text.find("<init_from", position + 1)) {
+        // COLLADA 1.5 wraps the file name in a ref element.
+        auto begin = text.find('>', position);
+        if(begin == std::string_view::npos || text[begin - 1] == '/') {
+            continue;
+        }
+        const auto content_begin = text.find_first_not_of(" \t\r\n", begin + 1);
+        if(content_begin != std::string_view::npos && text.compare(content_begin, 5, "<ref>") == 0) {
+            begin = content_begin + 4;
+        }
+        const auto end = text.find('<', begin + 1);
+        if(end != std::string_view::npos) {
+            references.emplace_back(reference_to_path(text.substr(begin + 1, end - begin - 1)));
+        }
+    }
+    for(const std::string_view attribute : {"url=\"", "source=\""}) {
+        for(auto position = text.find(attribute); position != std::string_view::npos;
+                position = text.find(attribute, position + 1)) {
+            const auto begin = position + attribute.size();
+            const auto end = text.find('"', begin);
+            if(position == 0 || !std::isspace(static_cast<unsigned char>(text[position - 1]))
+                    || end == std::string_view::npos) {
+                continue;
+            }
+            references.emplace_back(reference_to_path(text.substr(begin, end - begin)));
+        }
+    }
+
+    const auto directory = std::filesystem::path{input_file_name}.parent_path();
+    std::vector<std::string> paths{};
+    for(const auto& reference : references) {
+        if(!reference.empty()) {
+            const std::filesystem::path path{reference};
+            paths.emplace_back((path.is_absolute() ? path : directory / path).lexically_normal().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
+}
+
+bool write_depfile(const std::string_view depfile_name, const std::string_view output_file_name,
+        const std::string_view input_file_name) {
+    std::string text{};
+    if(const auto compression = detect_compression(input_file_name); compression != SourceCompression::none) {
+        if(!read_compressed_file(input_file_name, compression, text)) {
+            return false;
+        }
+    } else {
+        std::ifstream input_file{std::string{input_file_name}, std::ios::binary};
+        if(!input_file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents{};
+        contents << input_file.rdbuf();
+        text = contents.str();
+    }
+    std::ofstream depfile{std::string{depfile_name}, std::ios::trunc};
+    depfile << escape_for_make(output_file_name) << ": " << escape_for_make(input_file_name);
+    for(const auto& reference : find_external_references(text, input_file_name)) {
+        depfile << " \\\n    " << escape_for_make(reference);
+    }
+    depfile << '\n';
+    return depfile.good();
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <batch.hxx>
+#include <cache.hxx>
+#include <command_line.hxx>
+#include <server.hxx>
+#include <watch.hxx>
+
+int main(const int argc, const char* argv[]) {
+    CommandLine command_line{};
+    if(!parse_arguments(argc, argv, command_line)) {
+        std::cout << "Usage: dae2obm [--bvh] [--normals] [--crease-angle degrees] [--tangents] [--threads count]"
+                " [--weld] [--weld-epsilon distance] [--cache-dir dir] [--cache-size megabytes] [--restat]"
+                " [--stage-stats] [--max-memory megabytes] [--spill-dir dir] [--depfile file] [src.dae|-]"
+                " [dest.obm|-]\n"
+                "       dae2obm --batch [--shard index/count] [--summary file] [--async-io io_uring|pread]"
+                " [--io-depth count] [--io-direct] [options] [manifest|src_dir] [dest_dir]\n"
+                "       dae2obm --watch [--debounce milliseconds] [options] [src_dir] [dest_dir]\n"
+                "       dae2obm --merge-summaries [merged_summary] [summary...]\n"
+                "       dae2obm --serve socket [--threads count] [--cache-dir dir] [--cache-size megabytes]\n"
+                "       dae2obm --client socket [options] [src.dae] [dest.obm]\n"
+                "       dae2obm --client socket --stats\n";
+        return 0;
+    }
+    const auto& file_names = command_line.file_names;
+    if(command_line.merge_summaries) {
+        BatchSummary merged_summary{};
+        merged_summary.shards_count = 0;
+        for(std::size_t i{1}; i < file_names.size(); ++i) {
+            BatchSummary summary{};
+            if(!read_batch_summary(file_names[i], summary)) {
+                std::cerr << "Failed to read batch summary \"" << file_names[i] << "\".\n";
+                return 1;
+            }
+            merge_batch_summaries(summary, merged_summary);
+        }
+        print_batch_summary(merged_summary);
+        if(!write_batch_summary(file_names[0], merged_summary)) {
+            std::cerr << "Failed to write to file \"" << file_names[0] << "\".\n";
+            return 7;
+        }
+        return merged_summary.failures.empty() ? 0 : merged_summary.failures.front().first;
+    }
+    if(!command_line.client_socket.empty()) {
+        // File names are sent as absolute paths, the server running in another directory.
+        std::vector<std::string> arguments{};
+        for(int i{1}; i < argc; ++i) {
+            const std::string_view argument{argv[i]};
+            if(argument == "--client") {
+                ++i;
+                continue;
+            }
+            const auto is_file_name = argv[i] == command_line.depfile_name.data()
+                    || std::any_of(file_names.begin(), file_names.end(),
+                            [&](const std::string_view file_name) { return file_name.data() == argv[i]; });
+            std::error_code error{};
+            const auto path = is_file_name ? std::filesystem::absolute(argument, error) : std::filesystem::path{};
+            arguments.emplace_back(is_file_name && !error ? path.string() : std::string{argument});
+        }
+        std::string reply{};
+        if(send_request(command_line.client_socket, arguments, reply)) {
+            if(command_line.stats) {
+                std::cout << reply << '\n';
+                return 0;
+            }
+            int exit_code{};
+            double milliseconds{};
+            std::istringstream fields{reply};
+            if(!(fields >> exit_code >> milliseconds)) {
+                std::cerr << reply << '\n';
+                return 1;
+            }
+            std::cout << "Conversion time: " << milliseconds / 1000.0 << "s (server).\n";
+            return exit_code;
+        }
+        if(command_line.stats) {
+            std::cerr << "Failed to connect to socket \"" << command_line.client_socket << "\".\n";
+            return 1;
+        }
+        std::cerr << "No server on socket \"" << command_line.client_socket << "\", converting locally.\n";
+    }
+    ConversionCache cache{};
+    const auto use_cache = !command_line.cache_directory.empty();
+    if(use_cache) {
+        cache.directory = command_line.cache_directory;
+        cache.max_size = command_line.cache_size_megabytes << 20;
+        if(!open_conversion_cache(cache)) {
+            std::cerr << "Failed to open cache directory \"" << command_line.cache_directory << "\".\n";
+            return 1;
+        }
+    }
+    const auto report_cache = [&] {
+        if(cache.geometry_hits + cache.geometry_misses != 0) {
+            std::cout << "Geometry cache: " << cache.geometry_hits << " hits, " << cache.geometry_misses
+                    << " misses.\n";
+        }
+        evict_cache_entries(cache);
+        if(cache.evicted_count != 0) {
+            std::cout << "Evicted " << cache.evicted_count << " cache entries ("
+                    << static_cast<double>(cache.evicted_bytes) / 1e6 << " MB).\n";
+        }
+    };
+    if(command_line.watch) {
+        const std::chrono::milliseconds debounce_time(command_line.debounce_milliseconds);
+        watch_directory(file_names[0], file_names[1], command_line.options, debounce_time,
+                use_cache ? &cache : nullptr);
+        std::cerr << "Failed to watch directory \"" << file_names[0] << "\".\n";
+        return 1;
+    }
+    if(command_line.batch) {
+        std::vector<BatchJob> jobs{};
+        if(!collect_batch_jobs(file_names[0], file_names[1], jobs)) {
+            std::cerr << "Failed to list the files of \"" << file_names[0] << "\".\n";
+            return 1;
+        }
+        if(command_line.shards_count > 1) {
+            select_shard(jobs, command_line.shard_index, command_line.shards_count);
+        }
+        BatchSummary summary{};
+        const auto io = command_line.async_io ? std::make_unique<BatchIo>(command_line.io_options) : nullptr;
+        const auto exit_code = convert_batch(jobs, command_line.options, use_cache ? &cache : nullptr, io.get(),
+                summary);
+        print_batch_summary(summary);
+        if(io != nullptr) {
+            print_batch_io_stats(io->stats());
+        }
+        report_cache();
+        if(!command_line.summary_file_name.empty() && !write_batch_summary(command_line.summary_file_name, summary)) {
+            std::cerr << "Failed to write to file \"" << command_line.summary_file_name << "\".\n";
+            return 7;
+        }
+        return exit_code;
+    }
+    if(!command_line.serve_socket.empty()) {
+        serve(command_line.serve_socket, command_line.options.threads_count, use_cache ? &cache : nullptr);
+        std::cerr << "Failed to listen on socket \"" << command_line.serve_socket << "\".\n";
+        return 1;
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+    configure_document(collada_file);
+    const auto exit_code = convert_command_line(command_line, collada_file, use_cache ? &cache : nullptr);
+    const auto end_time = std::chrono::steady_clock::now();
+    const std::chrono::duration<float> elapsed_time = end_time - start_time;
+    // The output may be the standard output, which then only holds the converted file.
+    auto& messages = file_names[1] == STANDARD_STREAM_FILE_NAME ? std::cerr : std::cout;
+    messages << "Conversion time: " << elapsed_time.count() << "s" << (cache.hits != 0 ? " (cache hit)" : "") << ".\n";
+    report_cache();
+    return exit_code;
+}
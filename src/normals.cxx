@@ -0,0 +1,135 @@
+#include <normals.hxx>
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+namespace {
+
+constexpr std::size_t TRIANGLES_PER_TASK = 1 << 14;
+constexpr std::size_t POSITIONS_PER_TASK = 1 << 14;
+
+float corner_angle(const Vector3& corner, const Vector3& previous, const Vector3& next) {
+    const auto cosine = dot(normalize(previous - corner), normalize(next - corner));
+    return std::acos(std::clamp(cosine, -1.0f, 1.0f));
+}
+
+} // namespace
+
+bool generate_normals(Mesh& mesh, const float crease_angle_degrees, const std::size_t threads_count) {
+    if((mesh.present_attributes & NORMALS_PRESENT) != 0) {
+        return false;
+    }
+    const auto corners_count = mesh.position_indices.size();
+    const auto triangles_count = corners_count / 3;
+    const auto positions_count = mesh.positions.size();
+
+    // The cross product of two edges has the triangle area as its length, so weighting it by the corner angle gives
+    // the area and angle weighted contribution of every corner.
+    std::vector<Vector3> face_normals(triangles_count);
+    std::vector<Vector3> contributions(corners_count);
+    parallel_for(threads_count, triangles_count, TRIANGLES_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto triangle = begin; triangle < end; ++triangle) {
+            const auto corner = triangle * 3;
+            const std::array<Vector3, 3> positions{mesh.positions[mesh.position_indices[corner]],
+                    mesh.positions[mesh.position_indices[corner + 1]],
+                    mesh.positions[mesh.position_indices[corner + 2]]};
+            const auto face_normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
+            face_normals[triangle] = normalize(face_normal);
+            for(std::size_t i{}; i < 3; ++i) {
+                contributions[corner + i] = face_normal
+                        * corner_angle(positions[i], positions[(i + 2) % 3], positions[(i + 1) % 3]);
+            }
+        }
+    });
+
+    // Corners are bucketed by position with a counting sort, which keeps them in corner order. Every position then
+    // gathers the contributions of its corners in that order, so the sums do not depend on the thread count.
+    std::vector<std::uint32_t> bucket_sizes(positions_count);
+    for(const auto position : mesh.position_indices) {
+        ++bucket_sizes[position];
+    }
+    std::vector<std::uint64_t> bucket_starts{};
+    parallel_exclusive_scan(threads_count, bucket_sizes, bucket_starts);
+    std::vector<std::uint32_t> bucketed_corners(corners_count);
+    std::vector<std::uint64_t> bucket_ends(bucket_starts.begin(), bucket_starts.end() - 1);
+    for(std::uint32_t corner{}; corner < corners_count; ++corner) {
+        bucketed_corners[bucket_ends[mesh.position_indices[corner]]++] = corner;
+    }
+
+    // When every face at a position is within half the crease angle of the smooth normal, no two of them can be
+    // further apart than the crease angle and the smooth normal is exact. Only the remaining positions need their
+    // corners to gather the faces within the crease angle of their own face.
+    const auto crease_angle = crease_angle_degrees * 3.14159265358979f / 180.0f;
+    const auto half_crease_cosine = std::cos(std::min(crease_angle, 3.14159265358979f) * 0.5f);
+    const auto crease_cosine = std::cos(std::min(crease_angle, 3.14159265358979f));
+    std::vector<Vector3> smooth_normals(positions_count);
+    std::vector<std::uint8_t> creased_positions(positions_count);
+    parallel_for(threads_count, positions_count, POSITIONS_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto position = begin; position < end; ++position) {
+            Vector3 sum{};
+            for(auto i = bucket_starts[position]; i < bucket_starts[position + 1]; ++i) {
+                sum += contributions[bucketed_corners[i]];
+            }
+            smooth_normals[position] = normalize(sum);
+            for(auto i = bucket_starts[position]; i < bucket_starts[position + 1]; ++i) {
+                if(dot(face_normals[bucketed_corners[i] / 3], smooth_normals[position]) < half_crease_cosine) {
+                    creased_positions[position] = 1;
+                }
+            }
+        }
+    });
+    mesh.normals = std::move(smooth_normals);
+    mesh.normal_indices = mesh.position_indices;
+    mesh.present_attributes |= NORMALS_PRESENT;
+    if(std::find(creased_positions.begin(), creased_positions.end(), 1) == creased_positions.end()) {
+        return true;
+    }
+
+    std::vector<Vector3> creased_normals(corners_count);
+    parallel_for(threads_count, positions_count, POSITIONS_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto position = begin; position < end; ++position) {
+            if(!creased_positions[position]) {
+                continue;
+            }
+            for(auto i = bucket_starts[position]; i < bucket_starts[position + 1]; ++i) {
+                const auto& face_normal = face_normals[bucketed_corners[i] / 3];
+                Vector3 sum{};
+                for(auto j = bucket_starts[position]; j < bucket_starts[position + 1]; ++j) {
+                    if(dot(face_normals[bucketed_corners[j] / 3], face_normal) >= crease_cosine) {
+                        sum += contributions[bucketed_corners[j]];
+                    }
+                }
+                creased_normals[i] = normalize(sum);
+            }
+        }
+    });
+    // Corners of a position that gathered the same faces share their normal.
+    for(std::size_t position{}; position < positions_count; ++position) {
+        if(!creased_positions[position]) {
+            continue;
+        }
+        const auto first_normal = mesh.normals.size();
+        for(auto i = bucket_starts[position]; i < bucket_starts[position + 1]; ++i) {
+            const auto& normal = creased_normals[i];
+            auto index = first_normal;
+            while(index < mesh.normals.size() && (mesh.normals[index].x != normal.x
+                    || mesh.normals[index].y != normal.y || mesh.normals[index].z != normal.z)) {
+                ++index;
+            }
+            if(index == mesh.normals.size()) {
+                mesh.normals.emplace_back(normal);
+            }
+            mesh.normal_indices[bucketed_corners[i]] = static_cast<std::uint32_t>(index);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,1602 @@
+#include <out_of_core.hxx>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <compression.hxx>
+#include <external_sort.hxx>
+#include <spill_file.hxx>
+
+namespace {
+
+constexpr std::size_t MIN_WINDOW_BYTES = 1 << 20;
+constexpr std::size_t MAX_WINDOW_BYTES = 64 << 20;
+constexpr std::size_t MIN_POSITIONS_CACHE_BYTES = 256 << 10;
+constexpr std::size_t MAX_POSITIONS_CACHE_BYTES = 16 << 20;
+constexpr std::size_t POSITIONS_CACHE_BLOCK = 4096;
+// Spill files and spill readers alive at once at most, whose buffers come out of the budget: those of a mesh, of the
+// primitive being read and of a weld with its sorts.
+constexpr std::size_t SPILL_BUFFERS_COUNT = 32;
+// Bytes the window holds ahead of a tag, and of a number, which are longer only in broken documents.
+constexpr std::size_t MARKUP_LOOKAHEAD = 64 << 10;
+constexpr std::size_t NUMBER_LOOKAHEAD = 4 << 10;
+constexpr std::size_t COPY_BLOCK_BYTES = 1 << 20;
+// Memory a mesh takes to post-process in memory, in multiples of its serialized size: the mesh, its section and the
+// scratch of welding, or of the normals, tangents and hierarchy, which take more.
+constexpr std::size_t IN_MEMORY_FACTOR = 3;
+constexpr std::size_t IN_MEMORY_GENERATING_FACTOR = 6;
+// Scratch of a polygon per corner: its indices, position, projected point and ear clipping state, and triangles.
+constexpr std::size_t POLYGON_BYTES_PER_CORNER = ATTRIBUTES_COUNT * 4 + 12 + 8 + 8 + 12;
+constexpr std::size_t HEADER_BYTES = 5;
+constexpr std::size_t SECTION_HEADER_BYTES = 1 + 7 * sizeof(std::uint32_t) + sizeof(Bounds);
+constexpr auto NONE = static_cast<std::size_t>(-1);
+
+// What the conversion holds, against the limit of the options.
+struct MemoryBudget {
+    // Reserves nothing, and returns false, when the bytes do not fit.
+    bool reserve(const std::size_t bytes) {
+        if(bytes > limit - used) {
+            return false;
+        }
+        used += bytes;
+        peak = std::max(peak, used);
+        return true;
+    }
+
+    void release(const std::size_t bytes) {
+        used -= bytes;
+    }
+
+    std::size_t available() const {
+        return limit - used;
+    }
+
+    const std::size_t limit;
+    std::size_t used{};
+    std::size_t peak{};
+};
+
+// Bytes of the budget held for the lifetime of the scope, if they fit.
+struct BudgetReservation {
+    BudgetReservation(MemoryBudget& budget, const std::size_t bytes)
+            : budget{budget}, bytes{bytes}, reserved{budget.reserve(bytes)} {}
+
+    BudgetReservation(const BudgetReservation&) = delete;
+    BudgetReservation& operator=(const BudgetReservation&) = delete;
+
+    ~BudgetReservation() {
+        if(reserved) {
+            budget.release(bytes);
+        }
+    }
+
+    MemoryBudget& budget;
+    const std::size_t bytes;
+    const bool reserved;
+};
+
+// A read-only mapping of at most window_bytes of a file, moved along as the file is read, so that only the pages
+// around the read position are mapped, whatever the size of the file.
+struct MappedWindow {
+    MappedWindow(const int descriptor, const std::uint64_t file_size, const std::size_t window_bytes)
+            : descriptor{descriptor}, file_size{file_size}, window_bytes{window_bytes} {}
+
+    MappedWindow(const MappedWindow&) = delete;
+    MappedWindow& operator=(const MappedWindow&) = delete;
+
+    ~MappedWindow() {
+        unmap();
+    }
+
+    // The mapped bytes from position on: at least minimum of them, or all of them up to the end of the file.
+    bool view(const std::uint64_t position, const std::size_t minimum, std::string_view& bytes) {
+        const auto needed = std::min<std::uint64_t>(minimum, file_size - position);
+        if(mapping == nullptr || position < mapping_offset || position + needed > mapping_offset + mapping_size) {
+            unmap();
+            const auto page_size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+            mapping_offset = position / page_size * page_size;
+            mapping_size = static_cast<std::size_t>(std::min<std::uint64_t>(window_bytes, file_size - mapping_offset));
+            const auto address = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, descriptor,
+                    static_cast<off_t>(mapping_offset));
+            if(address == MAP_FAILED) {
+                return false;
+            }
+            mapping = static_cast<const char*>(address);
+            madvise(address, mapping_size, MADV_SEQUENTIAL);
+        }
+        const auto skipped = static_cast<std::size_t>(position - mapping_offset);
+        bytes = {mapping + skipped, mapping_size - skipped};
+        return true;
+    }
+
+    void unmap() {
+        if(mapping != nullptr) {
+            munmap(const_cast<char*>(mapping), mapping_size);
+            mapping = nullptr;
+        }
+    }
+
+    const int descriptor;
+    const std::uint64_t file_size;
+    const std::size_t window_bytes;
+    const char* mapping{};
+    std::uint64_t mapping_offset{};
+    std::size_t mapping_size{};
+};
+
+bool is_space(const char character) {
+    return character == ' ' || character == '\t' || character == '\n' || character == '\r' || character == '\v'
+            || character == '\f';
+}
+
+bool starts_with(const std::string_view text, const std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+void append_utf8(const std::uint32_t code_point, std::string& text) {
+    if(code_point < 0x80) {
+        text += static_cast<char>(code_point);
+    } else if(code_point < 0x800) {
+        text += static_cast<char>(0xc0 | (code_point >> 6));
+        text += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else if(code_point < 0x10000) {
+        text += static_cast<char>(0xe0 | (code_point >> 12));
+        text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        text += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else {
+        text += static_cast<char>(0xf0 | (code_point >> 18));
+        text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        text += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+}
+
+// Attribute values with their predefined and character entities replaced, as tinyxml2 reads them.
+void decode_entities(const std::string_view text, std::string& decoded) {
+    constexpr std::array<std::pair<std::string_view, char>, 5> entities{{{"lt", '<'}, {"gt", '>'}, {"amp", '&'},
+            {"quot", '"'}, {"apos", '\''}}};
+    decoded.clear();
+    for(std::size_t i{}; i < text.size(); ++i) {
+        const auto end = text[i] == '&' ? text.find(';', i) : std::string_view::npos;
+        if(end == std::string_view::npos) {
+            decoded += text[i];
+            continue;
+        }
+        const auto name = text.substr(i + 1, end - i - 1);
+        const auto entity = std::find_if(entities.begin(), entities.end(),
+                [&](const auto& candidate) { return candidate.first == name; });
+        std::uint32_t code_point{};
+        const auto hexadecimal = starts_with(name, "#x");
+        const auto digits = name.substr(hexadecimal ? 2 : 1);
+        if(entity != entities.end()) {
+            decoded += entity->second;
+        } else if(starts_with(name, "#") && !digits.empty() && std::from_chars(digits.data(),
+                digits.data() + digits.size(), code_point, hexadecimal ? 16 : 10).ptr == digits.data() + digits.size()
+                && code_point <= 0x10ffff) {
+            append_utf8(code_point, decoded);
+        } else {
+            decoded += text[i];
+            continue;
+        }
+        i = end;
+    }
+}
+
+struct XmlTag {
+    // The first attribute of the name, as tinyxml2::XMLElement::Attribute.
+    const char* attribute(const std::string_view name) const {
+        const auto found = std::find_if(attributes.begin(), attributes.end(),
+                [&](const auto& attribute) { return attribute.first == name; });
+        return found != attributes.end() ? found->second.c_str() : nullptr;
+    }
+
+    // As tinyxml2::XMLElement::UnsignedAttribute.
+    unsigned unsigned_attribute(const std::string_view name, const unsigned default_value = 0) const {
+        auto value = default_value;
+        const auto text = attribute(name);
+        return text != nullptr && tinyxml2::XMLUtil::ToUnsigned(text, &value) ? value : default_value;
+    }
+
+    std::string name{};
+    std::vector<std::pair<std::string, std::string>> attributes{};
+    // Written <name/>, without children or end tag.
+    bool empty{};
+};
+
+enum class Markup {
+    start,
+    end,
+    end_of_file,
+    // Broken markup, or a source that failed to read.
+    malformed,
+};
+
+// Reads the elements of a document in order, through the window. Comments, CDATA sections, processing instructions
+// and declarations are skipped, as is text but for the numbers read_numbers reads. End tags are checked against the
+// open elements, so that a document the scanner reads whole is well formed as far as elements go.
+struct XmlScanner {
+    explicit XmlScanner(MappedWindow& window)
+            : window{window} {}
+
+    Markup next(XmlTag& tag) {
+        while(!ended) {
+            if(!skip_text()) {
+                return failed ? Markup::malformed : Markup::end_of_file;
+            }
+            if(!ensure(MARKUP_LOOKAHEAD)) {
+                return Markup::malformed;
+            }
+            const std::string_view markup{cursor, static_cast<std::size_t>(end - cursor)};
+            std::string_view terminator{};
+            std::size_t prefix_size{2};
+            if(starts_with(markup, "<!--")) {
+                terminator = "-->";
+                prefix_size = 4;
+            } else if(starts_with(markup, "<![CDATA[")) {
+                terminator = "]]>";
+                prefix_size = 9;
+            } else if(starts_with(markup, "<?")) {
+                terminator = "?>";
+            } else if(starts_with(markup, "<!")) {
+                terminator = ">";
+            } else {
+                return starts_with(markup, "</") ? read_end_tag(tag) : read_start_tag(tag);
+            }
+            cursor += prefix_size;
+            if(!skip_past(terminator)) {
+                return Markup::malformed;
+            }
+        }
+        return Markup::end_of_file;
+    }
+
+    // Reads the numbers of the text at the cursor, up to the next markup, into sink, which returns false to stop.
+    // Returns false when a number is malformed, like load_float_array and load_uint32_array.
+    template<typename Value, typename Sink>
+    bool read_numbers(Sink&& sink) {
+        while(true) {
+            while(cursor != end && is_space(*cursor)) {
+                ++cursor;
+            }
+            if(static_cast<std::size_t>(end - cursor) < NUMBER_LOOKAHEAD && !at_view_end_of_file()
+                    && !ensure(NUMBER_LOOKAHEAD)) {
+                return false;
+            }
+            if(cursor == end || *cursor == '<') {
+                return true;
+            }
+            if(is_space(*cursor)) {
+                continue;
+            }
+            Value value{};
+            const auto [next, error] = std::from_chars(cursor, end, value);
+            // A number running to the end of the view could go on past it.
+            if(error != std::errc{} || (next == end && !at_view_end_of_file())) {
+                return false;
+            }
+            cursor = next;
+            if(!sink(value)) {
+                return false;
+            }
+        }
+    }
+
+    // Elements open around the cursor.
+    std::size_t depth() const {
+        return open_elements.size();
+    }
+
+    bool at_view_end_of_file() const {
+        return view_end == window.file_size;
+    }
+
+    // Makes at least minimum bytes available from the cursor on, or all of them up to the end of the file.
+    bool ensure(const std::size_t minimum) {
+        if(static_cast<std::size_t>(end - cursor) >= minimum || at_view_end_of_file()) {
+            return true;
+        }
+        const auto position = view_offset + static_cast<std::uint64_t>(cursor - begin);
+        std::string_view bytes{};
+        if(!window.view(position, minimum, bytes)) {
+            failed = true;
+            return false;
+        }
+        begin = cursor = bytes.data();
+        end = begin + bytes.size();
+        view_offset = position;
+        view_end = position + bytes.size();
+        return true;
+    }
+
+    // Moves to the next '<'. Returns false at the end of the file, or when it fails to read.
+    bool skip_text() {
+        while(true) {
+            if(const auto found = cursor != end ? std::memchr(cursor, '<', static_cast<std::size_t>(end - cursor))
+                    : nullptr; found != nullptr) {
+                cursor = static_cast<const char*>(found);
+                return true;
+            }
+            cursor = end;
+            if(at_view_end_of_file() || !ensure(MARKUP_LOOKAHEAD)) {
+                return false;
+            }
+        }
+    }
+
+    bool skip_past(const std::string_view terminator) {
+        while(true) {
+            const std::string_view bytes{cursor, static_cast<std::size_t>(end - cursor)};
+            if(const auto found = bytes.find(terminator); found != std::string_view::npos) {
+                cursor += found + terminator.size();
+                return true;
+            }
+            if(at_view_end_of_file()) {
+                return false;
+            }
+            // Keeps the bytes that could be the start of the terminator.
+            cursor = end - std::min(bytes.size(), terminator.size() - 1);
+            if(!ensure(MARKUP_LOOKAHEAD)) {
+                return false;
+            }
+        }
+    }
+
+    Markup read_start_tag(XmlTag& tag) {
+        auto position = cursor + 1;
+        const auto skip_spaces = [&] {
+            while(position != end && is_space(*position)) {
+                ++position;
+            }
+        };
+        const auto name_begin = position;
+        while(position != end && !is_space(*position) && *position != '/' && *position != '>') {
+            ++position;
+        }
+        if(position == name_begin) {
+            return Markup::malformed;
+        }
+        tag.name.assign(name_begin, position);
+        tag.attributes.clear();
+        tag.empty = false;
+        while(true) {
+            skip_spaces();
+            if(position == end) {
+                return Markup::malformed;
+            }
+            if(*position == '>') {
+                ++position;
+                break;
+            }
+            if(*position == '/') {
+                if(end - position < 2 || position[1] != '>') {
+                    return Markup::malformed;
+                }
+                position += 2;
+                tag.empty = true;
+                break;
+            }
+            const auto attribute_begin = position;
+            while(position != end && !is_space(*position) && *position != '=' && *position != '>'
+                    && *position != '/') {
+                ++position;
+            }
+            const std::string_view attribute_name{attribute_begin,
+                    static_cast<std::size_t>(position - attribute_begin)};
+            skip_spaces();
+            if(attribute_name.empty() || position == end || *position != '=') {
+                return Markup::malformed;
+            }
+            ++position;
+            skip_spaces();
+            if(position == end || (*position != '"' && *position != '\'')) {
+                return Markup::malformed;
+            }
+            const auto quote = *position++;
+            const auto value_end = static_cast<const char*>(std::memchr(position, quote,
+                    static_cast<std::size_t>(end - position)));
+            if(value_end == nullptr) {
+                return Markup::malformed;
+            }
+            auto& [name, value] = tag.attributes.emplace_back();
+            name = attribute_name;
+            decode_entities({position, static_cast<std::size_t>(value_end - position)}, value);
+            position = value_end + 1;
+        }
+        cursor = position;
+        if(!tag.empty) {
+            open_elements.push_back(tag.name);
+        }
+        return Markup::start;
+    }
+
+    Markup read_end_tag(XmlTag& tag) {
+        auto position = cursor + 2;
+        const auto name_begin = position;
+        while(position != end && !is_space(*position) && *position != '>') {
+            ++position;
+        }
+        const std::string_view name{name_begin, static_cast<std::size_t>(position - name_begin)};
+        while(position != end && is_space(*position)) {
+            ++position;
+        }
+        if(position == end || *position != '>') {
+            return Markup::malformed;
+        }
+        // tinyxml2 ends the document at an end tag outside of any element, ignoring the rest.
+        if(open_elements.empty()) {
+            ended = true;
+            return Markup::end_of_file;
+        }
+        if(open_elements.back() != name) {
+            return Markup::malformed;
+        }
+        tag.name = name;
+        tag.attributes.clear();
+        tag.empty = false;
+        open_elements.pop_back();
+        cursor = position + 1;
+        return Markup::end;
+    }
+
+    MappedWindow& window;
+    // The view of the window: [begin, end) holds the bytes at [view_offset, view_end) of the file.
+    const char* begin{};
+    const char* cursor{};
+    const char* end{};
+    std::uint64_t view_offset{};
+    std::uint64_t view_end{};
+    std::vector<std::string> open_elements{};
+    bool ended{};
+    bool failed{};
+};
+
+// Skips the rest of the element whose start tag was read last, up to its end tag.
+bool skip_element(XmlScanner& scanner, const XmlTag& tag) {
+    if(tag.empty) {
+        return true;
+    }
+    const auto depth = scanner.depth();
+    XmlTag child{};
+    while(scanner.depth() >= depth) {
+        const auto markup = scanner.next(child);
+        if(markup != Markup::start && markup != Markup::end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls child(tag) for every child element of the element whose start tag was read last, up to its end tag; child
+// reads the whole element and returns 0, or the error code that stops the conversion. Broken markup returns 1.
+template<typename Child>
+int for_each_child(XmlScanner& scanner, const XmlTag& tag, Child&& child) {
+    if(tag.empty) {
+        return 0;
+    }
+    const auto depth = scanner.depth();
+    XmlTag child_tag{};
+    while(true) {
+        switch(scanner.next(child_tag)) {
+        case Markup::start:
+            if(const auto result = child(child_tag); result != 0) {
+                return result;
+            }
+            break;
+        case Markup::end:
+            if(scanner.depth() < depth) {
+                return 0;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+}
+
+template<typename Function>
+auto visit_attribute_type(const std::size_t attribute, Function&& function) {
+    if(attribute == TEX_COORDS_ATTRIBUTE) {
+        return function(Vector2{});
+    }
+    return function(Vector3{});
+}
+
+std::array<SpillFile, ATTRIBUTES_COUNT> make_attribute_spill_files(const std::string& directory) {
+    return {{SpillFile{directory}, SpillFile{directory}, SpillFile{directory}, SpillFile{directory}}};
+}
+
+template<typename Value>
+struct ValueRecord {
+    Value value;
+    std::uint32_t id;
+};
+
+struct IdPair {
+    std::uint32_t first;
+    std::uint32_t second;
+};
+
+bool pair_less(const IdPair& lhs, const IdPair& rhs) {
+    return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+// Merges the bitwise identical values like weld_mesh, with external sorts rather than a hash table: the records of the
+// values are sorted by bits then id, so that every run of identical values starts with the value it keeps; the ids
+// of the kept values, sorted, give their new ids by rank; and the indices are remapped through the new id of every
+// value, in memory when that map fits in sort_bytes, or else by sorting the corners by index and back.
+template<typename Value>
+bool weld_spilled_values(SpillFile& values, SpillFile& indices, const std::size_t sort_bytes) {
+    const auto& directory = values.directory;
+    const auto values_count = values.count<Value>();
+    const auto value_less = [](const ValueRecord<Value>& lhs, const ValueRecord<Value>& rhs) {
+        const auto order = std::memcmp(&lhs.value, &rhs.value, sizeof(Value));
+        return order < 0 || (order == 0 && lhs.id < rhs.id);
+    };
+    SpillFile sorted_values{directory};
+    {
+        SpillFile records{directory};
+        SpillReader<Value> reader{values};
+        Value value{};
+        for(std::uint32_t id{}; reader.read(value); ++id) {
+            records.push_back(ValueRecord<Value>{value, id});
+        }
+        if(reader.failed || !external_sort<ValueRecord<Value>>(records, sorted_values, sort_bytes, value_less)) {
+            return false;
+        }
+    }
+    // (representative, id) for every value, and the ids of the representatives.
+    SpillFile representatives{directory};
+    SpillFile kept_ids{directory};
+    {
+        SpillReader<ValueRecord<Value>> reader{sorted_values};
+        ValueRecord<Value> record{};
+        ValueRecord<Value> first{};
+        for(auto any = false; reader.read(record); any = true) {
+            if(!any || std::memcmp(&record.value, &first.value, sizeof(Value)) != 0) {
+                first = record;
+                kept_ids.push_back(record.id);
+            }
+            representatives.push_back(IdPair{first.id, record.id});
+        }
+        if(reader.failed) {
+            return false;
+        }
+    }
+    sorted_values.clear();
+    SpillFile sorted_kept_ids{directory};
+    SpillFile by_representative{directory};
+    if(!external_sort<std::uint32_t>(kept_ids, sorted_kept_ids, sort_bytes, std::less<>{})
+            || !external_sort<IdPair>(representatives, by_representative, sort_bytes, pair_less)) {
+        return false;
+    }
+    kept_ids.clear();
+    representatives.clear();
+    // (id, new id) for every value, sorted by id.
+    SpillFile new_ids{directory};
+    {
+        SpillFile unsorted_new_ids{directory};
+        SpillReader<IdPair> reader{by_representative};
+        SpillReader<std::uint32_t> kept_reader{sorted_kept_ids};
+        IdPair pair{};
+        std::uint32_t kept_id{};
+        std::uint32_t rank{};
+        for(auto any = false; reader.read(pair);) {
+            while(!any || kept_id < pair.first) {
+                if(!kept_reader.read(kept_id)) {
+                    return false;
+                }
+                rank += any ? 1 : 0;
+                any = true;
+            }
+            unsorted_new_ids.push_back(IdPair{pair.second, rank});
+        }
+        by_representative.clear();
+        if(reader.failed || !external_sort<IdPair>(unsorted_new_ids, new_ids, sort_bytes, pair_less)) {
+            return false;
+        }
+    }
+    SpillFile welded{directory};
+    {
+        SpillReader<Value> reader{values};
+        SpillReader<std::uint32_t> kept_reader{sorted_kept_ids};
+        Value value{};
+        std::uint32_t kept_id{};
+        auto kept = kept_reader.read(kept_id);
+        for(std::uint32_t id{}; reader.read(value); ++id) {
+            if(kept && kept_id == id) {
+                welded.push_back(value);
+                kept = kept_reader.read(kept_id);
+            }
+        }
+        if(reader.failed || kept_reader.failed) {
+            return false;
+        }
+    }
+    sorted_kept_ids.clear();
+    SpillFile remapped{directory};
+    if(values_count * sizeof(std::uint32_t) <= sort_bytes) {
+        std::vector<std::uint32_t> map(static_cast<std::size_t>(values_count));
+        SpillReader<IdPair> map_reader{new_ids};
+        for(IdPair pair{}; map_reader.read(pair);) {
+            map[pair.first] = pair.second;
+        }
+        SpillReader<std::uint32_t> reader{indices};
+        for(std::uint32_t index{}; reader.read(index);) {
+            remapped.push_back(map[index]);
+        }
+        if(map_reader.failed || reader.failed) {
+            return false;
+        }
+    } else {
+        // (index, corner) sorted by index, joined with the map into (corner, new index), sorted back by corner.
+        SpillFile by_index{directory};
+        {
+            SpillFile corners{directory};
+            SpillReader<std::uint32_t> reader{indices};
+            std::uint32_t index{};
+            for(std::uint32_t corner{}; reader.read(index); ++corner) {
+                corners.push_back(IdPair{index, corner});
+            }
+            if(reader.failed || !external_sort<IdPair>(corners, by_index, sort_bytes, pair_less)) {
+                return false;
+            }
+        }
+        SpillFile by_corner{directory};
+        {
+            SpillFile unsorted_by_corner{directory};
+            SpillReader<IdPair> reader{by_index};
+            SpillReader<IdPair> map_reader{new_ids};
+            IdPair corner{};
+            IdPair mapping{};
+            for(auto any = false; reader.read(corner);) {
+                while(!any || mapping.first < corner.first) {
+                    if(!map_reader.read(mapping)) {
+                        return false;
+                    }
+                    any = true;
+                }
+                unsorted_by_corner.push_back(IdPair{corner.second, mapping.second});
+            }
+            by_index.clear();
+            if(reader.failed || !external_sort<IdPair>(unsorted_by_corner, by_corner, sort_bytes, pair_less)) {
+                return false;
+            }
+        }
+        SpillReader<IdPair> reader{by_corner};
+        for(IdPair pair{}; reader.read(pair);) {
+            remapped.push_back(pair.second);
+        }
+        if(reader.failed) {
+            return false;
+        }
+    }
+    if(welded.failed || remapped.failed) {
+        return false;
+    }
+    values = std::move(welded);
+    indices = std::move(remapped);
+    return true;
+}
+
+// Positions of the mesh being read, by index, for the polygons that are ear clipped: blocks of the positions spill
+// file in a direct-mapped cache.
+struct PositionsCache {
+    PositionsCache(const SpillFile& positions, const std::size_t cache_bytes)
+            : positions{positions},
+              blocks(std::max<std::size_t>(cache_bytes / (POSITIONS_CACHE_BLOCK * sizeof(Vector3)), 1)) {}
+
+    bool get(const std::uint32_t index, Vector3& position) {
+        const auto block_index = index / POSITIONS_CACHE_BLOCK;
+        auto& block = blocks[block_index % blocks.size()];
+        const auto offset = index % POSITIONS_CACHE_BLOCK;
+        // Positions are only ever appended, so a cached block only misses those appended after it was loaded.
+        if(block.index != block_index || offset >= block.positions.size()) {
+            const auto first = std::uint64_t{block_index} * POSITIONS_CACHE_BLOCK;
+            const auto count = positions.count<Vector3>();
+            if(first + offset >= count) {
+                return false;
+            }
+            block.positions.resize(static_cast<std::size_t>(std::min<std::uint64_t>(POSITIONS_CACHE_BLOCK,
+                    count - first)));
+            if(!positions.read(first * sizeof(Vector3), block.positions.data(),
+                    block.positions.size() * sizeof(Vector3))) {
+                return false;
+            }
+            block.index = block_index;
+        }
+        position = block.positions[offset];
+        return true;
+    }
+
+    void clear() {
+        for(auto& block : blocks) {
+            block.index = NONE;
+        }
+    }
+
+    struct Block {
+        std::size_t index{NONE};
+        std::vector<Vector3> positions{};
+    };
+
+    const SpillFile& positions;
+    std::vector<Block> blocks;
+};
+
+struct FloatArray {
+    std::uint64_t first_value{};
+    std::uint64_t values_count{};
+    bool valid{};
+};
+
+struct SourceInfo {
+    std::size_t first_array{NONE};
+    bool has_accessor{};
+    std::string accessor_source{};
+    unsigned stride{1};
+    unsigned offset{};
+    unsigned count{};
+};
+
+enum class ElementKind {
+    source,
+    vertices,
+    float_array,
+};
+
+struct ElementRef {
+    ElementKind kind{};
+    std::size_t index{};
+};
+
+struct SpilledBinding {
+    std::size_t source{};
+    std::uint32_t first_value{};
+    std::uint32_t values_count{};
+};
+
+struct PrimitiveInput {
+    std::string semantic{};
+    std::string source{};
+    unsigned offset{};
+    unsigned set{};
+};
+
+struct OutOfCoreConverter {
+    OutOfCoreConverter(const ConversionOptions& options, MemoryBudget& budget, XmlScanner& scanner,
+            std::ostream& output, const std::string& directory, const std::size_t cache_bytes)
+            : options{options}, budget{budget}, scanner{scanner}, output{output}, raw_floats{directory},
+              values{make_attribute_spill_files(directory)}, indices{make_attribute_spill_files(directory)},
+              corners{make_attribute_spill_files(directory)}, vertex_counts{directory}, p_counts{directory},
+              positions_cache{values[POSITIONS_ATTRIBUTE], cache_bytes} {}
+
+    int convert_document(const std::string_view input_file_name) {
+        XmlTag tag{};
+        auto collada_found = false;
+        while(true) {
+            const auto markup = scanner.next(tag);
+            if(markup == Markup::end_of_file) {
+                break;
+            }
+            if(markup != Markup::start) {
+                return 1;
+            }
+            if(collada_found || tag.name != "COLLADA") {
+                if(!skip_element(scanner, tag)) {
+                    return 1;
+                }
+                continue;
+            }
+            collada_found = true;
+            if(const auto result = convert_collada(tag, input_file_name); result != 0) {
+                return result;
+            }
+        }
+        if(!collada_found) {
+            report(options, "Collada root node was not found in \"", input_file_name, "\".\n");
+            return 2;
+        }
+        return 0;
+    }
+
+    int convert_collada(const XmlTag& tag, const std::string_view input_file_name) {
+        auto library_found = false;
+        auto geometry_found = false;
+        std::size_t geometries_count{};
+        auto result = for_each_child(scanner, tag, [&](const XmlTag& library) {
+            if(library_found || library.name != "library_geometries") {
+                return skip_element(scanner, library) ? 0 : 1;
+            }
+            library_found = true;
+            return for_each_child(scanner, library, [&](const XmlTag& geometry) {
+                // Every element from the first geometry on is taken for a geometry, as convert does.
+                if(!geometry_found && geometry.name != "geometry") {
+                    return skip_element(scanner, geometry) ? 0 : 1;
+                }
+                geometry_found = true;
+                // The header is written last, so geometries past the count it holds are only counted for the message.
+                if(++geometries_count > MAX_MESHES_COUNT) {
+                    return skip_element(scanner, geometry) ? 0 : 1;
+                }
+                return convert_geometry(geometry);
+            });
+        });
+        if(result == 0 && !geometry_found) {
+            report(options, "Error: No geometries found in geometries library.\n");
+            result = 3;
+        }
+        if(result == 0) {
+            result = check_meshes_count(geometries_count, input_file_name, options);
+        }
+        return result;
+    }
+
+    int convert_geometry(const XmlTag& tag) {
+        const auto id = tag.attribute("id");
+        const std::string mesh_id{id != nullptr ? id : ""};
+        auto mesh_found = false;
+        const auto result = for_each_child(scanner, tag, [&](const XmlTag& mesh) {
+            if(mesh_found || mesh.name != "mesh") {
+                return skip_element(scanner, mesh) ? 0 : 1;
+            }
+            mesh_found = true;
+            return convert_mesh(mesh, mesh_id);
+        });
+        if(result == 0 && !mesh_found) {
+            report(options, "Error: Geometry doesn't contain \"mesh\" node.\n");
+            return 4;
+        }
+        return result;
+    }
+
+    int convert_mesh(const XmlTag& tag, const std::string& mesh_id) {
+        clear_mesh();
+        auto result = for_each_child(scanner, tag, [&](const XmlTag& child) {
+            PrimitiveType type{};
+            if(child.name == "source") {
+                return read_source(child);
+            } else if(child.name == "vertices") {
+                return read_vertices(child);
+            } else if(primitive_type_from_name(child.name, type)) {
+                return read_primitive(child, type, mesh_id);
+            }
+            return skip_element(scanner, child) ? 0 : 1;
+        });
+        if(result != 0) {
+            return result;
+        }
+        if(!primitive_found) {
+            report(options, "Error: Indices node was not found in mesh \"", mesh_id, "\".\n");
+            return 6;
+        }
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            if((present_attributes & (1 << attribute)) == 0) {
+                values[attribute].clear();
+                indices[attribute].clear();
+            }
+        }
+        result = write_mesh(mesh_id);
+        ++meshes_count;
+        return result;
+    }
+
+    void clear_mesh() {
+        ids.clear();
+        arrays.clear();
+        sources.clear();
+        vertices.clear();
+        raw_floats.clear();
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            bindings[attribute].clear();
+            values[attribute].clear();
+            indices[attribute].clear();
+        }
+        positions_cache.clear();
+        present_attributes = POSITIONS_PRESENT | TEX_COORDS_PRESENT | NORMALS_PRESENT | COLORS_PRESENT;
+        primitive_found = false;
+    }
+
+    void add_id(const XmlTag& tag, const ElementKind kind, const std::size_t index) {
+        if(const auto id = tag.attribute("id"); id != nullptr) {
+            ids.emplace(id, ElementRef{kind, index});
+        }
+    }
+
+    // As resolve_url, among the elements of the mesh.
+    const ElementRef* resolve(const std::string& url) const {
+        if(url.empty() || url[0] != '#') {
+            return nullptr;
+        }
+        const auto found = ids.find(url.substr(1));
+        return found != ids.end() ? &found->second : nullptr;
+    }
+
+    int read_float_array(const XmlTag& tag) {
+        auto& array = arrays.emplace_back();
+        add_id(tag, ElementKind::float_array, arrays.size() - 1);
+        array.first_value = raw_floats.count<float>();
+        // A malformed array only fails the conversion once a source binds it, like in load_vectors_from_source.
+        array.valid = tag.empty || scanner.read_numbers<float>([&](const float value) {
+            return raw_floats.push_back(value);
+        });
+        array.values_count = raw_floats.count<float>() - array.first_value;
+        return !raw_floats.failed && skip_element(scanner, tag) ? 0 : 1;
+    }
+
+    int read_source(const XmlTag& tag) {
+        const auto index = sources.size();
+        sources.emplace_back();
+        add_id(tag, ElementKind::source, index);
+        auto technique_found = false;
+        return for_each_child(scanner, tag, [&](const XmlTag& child) {
+            if(child.name == "float_array") {
+                const auto array = arrays.size();
+                const auto result = read_float_array(child);
+                if(sources[index].first_array == NONE) {
+                    sources[index].first_array = array;
+                }
+                return result;
+            }
+            if(child.name != "technique_common" || technique_found) {
+                return skip_element(scanner, child) ? 0 : 1;
+            }
+            technique_found = true;
+            return for_each_child(scanner, child, [&](const XmlTag& accessor) {
+                if(accessor.name == "accessor" && !sources[index].has_accessor) {
+                    auto& source = sources[index];
+                    const auto accessor_source = accessor.attribute("source");
+                    source.has_accessor = true;
+                    source.accessor_source = accessor_source != nullptr ? accessor_source : "";
+                    source.stride = accessor.unsigned_attribute("stride", 1);
+                    source.offset = accessor.unsigned_attribute("offset");
+                    source.count = accessor.unsigned_attribute("count");
+                }
+                return skip_element(scanner, accessor) ? 0 : 1;
+            });
+        });
+    }
+
+    int read_vertices(const XmlTag& tag) {
+        const auto index = vertices.size();
+        vertices.emplace_back();
+        add_id(tag, ElementKind::vertices, index);
+        return for_each_child(scanner, tag, [&](const XmlTag& child) {
+            if(child.name == "input") {
+                const auto semantic = child.attribute("semantic");
+                const auto source = child.attribute("source");
+                vertices[index].emplace_back(PrimitiveInput{semantic != nullptr ? semantic : "",
+                        source != nullptr ? source : "", 0, 0});
+            }
+            return skip_element(scanner, child) ? 0 : 1;
+        });
+    }
+
+    // As load_vectors_from_source, from the raw floats into the values of the attribute.
+    template<typename Vector>
+    bool load_spilled_vectors(const SourceInfo& source, SpillFile& vectors) {
+        constexpr std::size_t components_count = sizeof(Vector) / sizeof(float);
+        auto array_index = source.first_array;
+        if(source.has_accessor) {
+            const auto target = resolve(source.accessor_source);
+            array_index = target != nullptr && target->kind == ElementKind::float_array ? target->index : NONE;
+        }
+        if(array_index == NONE || !arrays[array_index].valid) {
+            return false;
+        }
+        const auto& array = arrays[array_index];
+        const std::uint64_t stride = source.has_accessor ? source.stride : components_count;
+        const std::uint64_t offset = source.has_accessor ? source.offset : 0;
+        const std::uint64_t count = source.has_accessor ? source.count : array.values_count / components_count;
+        if(stride < components_count
+                || (count != 0 && offset + (count - 1) * stride + components_count > array.values_count)) {
+            return false;
+        }
+        const auto span = count != 0 ? (count - 1) * stride + components_count : 0;
+        SpillReader<float> reader{raw_floats, array.first_value + offset, span};
+        std::array<float, components_count> components{};
+        for(std::uint64_t i{}; i < count; ++i) {
+            for(std::uint64_t component{}; component < stride && (i + 1 < count || component < components_count);
+                    ++component) {
+                float value{};
+                if(!reader.read(value)) {
+                    return false;
+                }
+                if(component < components_count) {
+                    components[component] = value;
+                }
+            }
+            Vector vector{};
+            std::memcpy(&vector, components.data(), sizeof(Vector));
+            if(!vectors.push_back(vector)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // As bind_source.
+    bool bind_source(const std::size_t source, const std::size_t attribute, SpilledBinding& binding) {
+        auto& attribute_bindings = bindings[attribute];
+        const auto bound = std::find_if(attribute_bindings.begin(), attribute_bindings.end(),
+                [source](const SpilledBinding& bound_source) { return bound_source.source == source; });
+        if(bound != attribute_bindings.end()) {
+            binding = *bound;
+            return true;
+        }
+        binding.source = source;
+        const auto success = visit_attribute_type(attribute, [&](auto vector) {
+            using Vector = decltype(vector);
+            binding.first_value = static_cast<std::uint32_t>(values[attribute].count<Vector>());
+            const auto loaded = load_spilled_vectors<Vector>(sources[source], values[attribute]);
+            binding.values_count = static_cast<std::uint32_t>(values[attribute].count<Vector>()
+                    - binding.first_value);
+            return loaded;
+        });
+        attribute_bindings.emplace_back(binding);
+        return success;
+    }
+
+    // The slot of every input and the source of every attribute, as load_primitive sets them up.
+    struct PrimitiveLayout {
+        std::size_t stride{};
+        std::array<std::size_t, ATTRIBUTES_COUNT> offsets{};
+        std::array<std::size_t, ATTRIBUTES_COUNT> sources{NONE, NONE, NONE, NONE};
+        std::array<SpilledBinding, ATTRIBUTES_COUNT> bindings{};
+        std::uint8_t present_attributes{};
+    };
+
+    bool bind_inputs(const std::vector<PrimitiveInput>& inputs, PrimitiveLayout& layout) {
+        const auto source_of = [&](const std::string& url) {
+            const auto target = resolve(url);
+            if(target == nullptr) {
+                return NONE;
+            }
+            // Elements that are not sources fail to load, like in bind_source.
+            return target->kind == ElementKind::source ? target->index : NONE - 1;
+        };
+        for(const auto vertices_pass : {true, false}) {
+            for(const auto& input : inputs) {
+                layout.stride = std::max<std::size_t>(layout.stride, std::size_t{input.offset} + 1);
+                if(input.semantic == "VERTEX" && vertices_pass) {
+                    const auto target = resolve(input.source);
+                    if(target == nullptr) {
+                        return false;
+                    }
+                    if(target->kind != ElementKind::vertices) {
+                        continue;
+                    }
+                    for(const auto& vertices_input : vertices[target->index]) {
+                        const auto attribute = attribute_from_semantic(vertices_input.semantic, 0);
+                        if(attribute < ATTRIBUTES_COUNT) {
+                            layout.offsets[attribute] = input.offset;
+                            layout.sources[attribute] = source_of(vertices_input.source);
+                        }
+                    }
+                } else if(input.semantic != "VERTEX" && !vertices_pass) {
+                    const auto attribute = attribute_from_semantic(input.semantic, input.set);
+                    if(attribute < ATTRIBUTES_COUNT && attribute != POSITIONS_ATTRIBUTE) {
+                        layout.offsets[attribute] = input.offset;
+                        layout.sources[attribute] = source_of(input.source);
+                    }
+                }
+            }
+        }
+        if(layout.sources[POSITIONS_ATTRIBUTE] == NONE) {
+            return false;
+        }
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            if(layout.sources[attribute] == NONE) {
+                continue;
+            }
+            if(layout.sources[attribute] == NONE - 1
+                    || !bind_source(layout.sources[attribute], attribute, layout.bindings[attribute])) {
+                return false;
+            }
+            layout.present_attributes |= static_cast<std::uint8_t>(1 << attribute);
+        }
+        return true;
+    }
+
+    // As load_primitive, streaming: the values of every <p> are split into the corners of every attribute as they are
+    // read, checked and offset to the values of the mesh. Triangles go straight to the indices of the mesh, other
+    // primitives are triangulated one by one once all of their corners are read.
+    int read_primitive(const XmlTag& tag, const PrimitiveType type, const std::string& mesh_id) {
+        for(auto& attribute_corners : corners) {
+            attribute_corners.clear();
+        }
+        vertex_counts.clear();
+        p_counts.clear();
+        std::vector<PrimitiveInput> inputs{};
+        PrimitiveLayout layout{};
+        auto bound = false;
+        auto valid = true;
+        auto vcount_found = false;
+        std::uint64_t values_total{};
+        auto& destinations = type == PrimitiveType::TRIANGLES ? indices : corners;
+        const auto read_p = [&](const XmlTag& p) {
+            std::size_t slot{};
+            std::uint64_t values_count{};
+            const auto read = p.empty || scanner.read_numbers<std::uint32_t>([&](const std::uint32_t value) {
+                for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+                    if(layout.sources[attribute] == NONE || layout.offsets[attribute] != slot) {
+                        continue;
+                    }
+                    const auto& binding = layout.bindings[attribute];
+                    if(value >= binding.values_count) {
+                        return false;
+                    }
+                    if(!destinations[attribute].push_back(value + binding.first_value)) {
+                        return false;
+                    }
+                }
+                slot = slot + 1 == layout.stride ? 0 : slot + 1;
+                ++values_count;
+                return true;
+            });
+            values_total += values_count;
+            valid = valid && read && values_count % layout.stride == 0;
+            if(valid && type != PrimitiveType::TRIANGLES) {
+                valid = p_counts.push_back(static_cast<std::uint32_t>(values_count / layout.stride));
+            }
+            return skip_element(scanner, p) ? 0 : 1;
+        };
+        auto result = for_each_child(scanner, tag, [&](const XmlTag& child) {
+            if(!valid) {
+                return skip_element(scanner, child) ? 0 : 1;
+            }
+            if(child.name == "input") {
+                // The stride of the values is only known once every input is.
+                if(bound) {
+                    valid = false;
+                } else {
+                    const auto semantic = child.attribute("semantic");
+                    const auto source = child.attribute("source");
+                    inputs.emplace_back(PrimitiveInput{semantic != nullptr ? semantic : "",
+                            source != nullptr ? source : "", child.unsigned_attribute("offset"),
+                            child.unsigned_attribute("set")});
+                }
+                return skip_element(scanner, child) ? 0 : 1;
+            }
+            if(child.name == "vcount" && !vcount_found) {
+                vcount_found = true;
+                valid = child.empty || scanner.read_numbers<std::uint32_t>([&](const std::uint32_t count) {
+                    return vertex_counts.push_back(count);
+                });
+                return skip_element(scanner, child) ? 0 : 1;
+            }
+            if(child.name != "p" && child.name != "ph") {
+                return skip_element(scanner, child) ? 0 : 1;
+            }
+            if(!bound) {
+                bound = true;
+                valid = bind_inputs(inputs, layout);
+                if(!valid) {
+                    return skip_element(scanner, child) ? 0 : 1;
+                }
+            }
+            if(child.name == "p") {
+                return read_p(child);
+            }
+            // The outer boundary of a <ph>, its holes being ignored.
+            auto boundary_found = false;
+            return for_each_child(scanner, child, [&](const XmlTag& boundary) {
+                if(boundary.name != "p" || boundary_found || !valid) {
+                    return skip_element(scanner, boundary) ? 0 : 1;
+                }
+                boundary_found = true;
+                return read_p(boundary);
+            });
+        });
+        if(result != 0) {
+            return result;
+        }
+        if(valid && !bound) {
+            valid = bind_inputs(inputs, layout);
+        }
+        if(valid) {
+            const auto corners_count = values_total / layout.stride;
+            if(type == PrimitiveType::TRIANGLES) {
+                valid = corners_count % 3 == 0;
+            } else {
+                result = triangulate_corners(type, vcount_found ? vertex_counts : p_counts, corners_count, layout,
+                        valid);
+            }
+        }
+        if(result == 0 && !valid) {
+            report(options, "Error: Invalid inputs or indices in mesh \"", mesh_id, "\".\n");
+            result = 8;
+        }
+        if(result == 9) {
+            report(options, "Error: Polygons of mesh \"", mesh_id, "\" don't fit in the memory budget.\n");
+        }
+        if(result != 0) {
+            return result;
+        }
+        present_attributes &= layout.present_attributes;
+        primitive_found = true;
+        return 0;
+    }
+
+    // Triangulates the primitives sized by counts, one after the other, into the indices of the mesh. Clears valid
+    // when the counts do not add up to the corners.
+    int triangulate_corners(const PrimitiveType type, const SpillFile& counts, const std::uint64_t corners_count,
+            const PrimitiveLayout& layout, bool& valid) {
+        std::uint64_t counted_corners{};
+        {
+            SpillReader<std::uint32_t> reader{counts};
+            for(std::uint32_t count{}; reader.read(count);) {
+                counted_corners += count;
+            }
+            if(reader.failed) {
+                return 1;
+            }
+        }
+        if(counted_corners != corners_count) {
+            valid = false;
+            return 0;
+        }
+        std::vector<std::size_t> attributes{};
+        std::vector<SpillReader<std::uint32_t>> readers{};
+        readers.reserve(ATTRIBUTES_COUNT);
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            if(layout.sources[attribute] != NONE) {
+                attributes.push_back(attribute);
+                readers.emplace_back(corners[attribute]);
+            }
+        }
+        std::array<std::vector<std::uint32_t>, ATTRIBUTES_COUNT> polygon{};
+        std::vector<Vector3> corner_positions{};
+        std::vector<std::uint32_t> triangles{};
+        SpillReader<std::uint32_t> count_reader{counts};
+        for(std::uint32_t count{}; count_reader.read(count);) {
+            const BudgetReservation reservation{budget, std::size_t{count} * POLYGON_BYTES_PER_CORNER};
+            if(!reservation.reserved) {
+                return 9;
+            }
+            for(std::size_t i{}; i < attributes.size(); ++i) {
+                polygon[i].resize(count);
+                for(auto& index : polygon[i]) {
+                    if(!readers[i].read(index)) {
+                        return 1;
+                    }
+                }
+            }
+            if(type == PrimitiveType::POLYGONS && count > 3) {
+                corner_positions.resize(count);
+                for(std::uint32_t corner{}; corner < count; ++corner) {
+                    if(!positions_cache.get(polygon[0][corner], corner_positions[corner])) {
+                        return 1;
+                    }
+                }
+            }
+            triangulate_primitive(type, count, corner_positions, triangles);
+            for(std::size_t i{}; i < attributes.size(); ++i) {
+                for(const auto corner : triangles) {
+                    indices[attributes[i]].push_back(polygon[i][corner]);
+                }
+            }
+            // Large polygons give their scratch back.
+            if(count > POSITIONS_CACHE_BLOCK) {
+                polygon = {};
+                corner_positions = {};
+                triangles = {};
+            }
+        }
+        return count_reader.failed ? 1 : 0;
+    }
+
+    std::uint64_t section_size() const {
+        std::uint64_t size{SECTION_HEADER_BYTES};
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            size += values[attribute].size() + indices[attribute].size();
+        }
+        return size;
+    }
+
+    int write_mesh(const std::string& mesh_id) {
+        const auto generating = options.generate_normals || options.generate_tangents || options.build_bvh;
+        const auto in_memory_bytes = section_size() * (generating ? IN_MEMORY_GENERATING_FACTOR : IN_MEMORY_FACTOR);
+        if(in_memory_bytes <= budget.available()) {
+            const BudgetReservation reservation{budget, static_cast<std::size_t>(in_memory_bytes)};
+            return write_mesh_in_memory(mesh_id);
+        }
+        ++spilled_meshes_count;
+        if(generating || (options.weld && options.weld_epsilon > 0.0f)) {
+            report(options, "Error: Mesh \"", mesh_id, "\" doesn't fit in the memory budget for normals, tangents, "
+                    "hierarchies or welding with an epsilon.\n");
+            return 9;
+        }
+        if(options.weld) {
+            const auto sort_bytes = budget.available() / 2;
+            const BudgetReservation reservation{budget, sort_bytes};
+            for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+                if((present_attributes & (1 << attribute)) == 0) {
+                    continue;
+                }
+                const auto welded = visit_attribute_type(attribute, [&](auto vector) {
+                    return weld_spilled_values<decltype(vector)>(values[attribute], indices[attribute], sort_bytes);
+                });
+                if(!welded) {
+                    return 1;
+                }
+            }
+        }
+        Bounds bounds{};
+        const auto& positions = values[POSITIONS_ATTRIBUTE];
+        const auto bounded = compute_bounds_streamed(static_cast<std::size_t>(positions.count<Vector3>()),
+                options.threads_count, [&](const std::size_t first, const std::size_t count, Vector3* chunk) {
+                    return positions.read(first * sizeof(Vector3), chunk, count * sizeof(Vector3));
+                }, bounds);
+        if(!bounded) {
+            return 1;
+        }
+        std::string header{};
+        append_value(header, present_attributes);
+        for(std::size_t attribute{}; attribute < ATTRIBUTES_COUNT; ++attribute) {
+            const auto vector_size = attribute == TEX_COORDS_ATTRIBUTE ? sizeof(Vector2) : sizeof(Vector3);
+            append_value(header, static_cast<std::uint32_t>(values[attribute].size() / vector_size));
+        }
+        append_value(header, std::uint32_t{});
+        append_value(header, static_cast<std::uint32_t>(indices[POSITIONS_ATTRIBUTE].count<std::uint32_t>()));
+        append_value(header, bounds.aabb_min);
+        append_value(header, bounds.aabb_max);
+        append_value(header, bounds.sphere_center);
+        append_value(header, bounds.sphere_radius);
+        append_value(header, std::uint32_t{});
+        if(!output.write(header.data(), static_cast<std::streamsize>(header.size()))) {
+            return 7;
+        }
+        for(const auto spill_files : {&values, &indices}) {
+            for(const auto& spill_file : *spill_files) {
+                if(const auto result = copy_to_output(spill_file); result != 0) {
+                    return result;
+                }
+            }
+        }
+        return 0;
+    }
+
+    int copy_to_output(const SpillFile& spill_file) {
+        std::vector<char> block(SPILL_BUFFER_BYTES);
+        for(std::uint64_t offset{}; offset < spill_file.size(); offset += block.size()) {
+            const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(),
+                    spill_file.size() - offset));
+            if(!spill_file.read(offset, block.data(), size)) {
+                return 1;
+            }
+            if(!output.write(block.data(), static_cast<std::streamsize>(size))) {
+                return 7;
+            }
+        }
+        return 0;
+    }
+
+    int write_mesh_in_memory(const std::string& mesh_id) {
+        Mesh mesh{};
+        mesh.present_attributes = present_attributes;
+        const auto load = [](const SpillFile& spill_file, auto& vectors) {
+            vectors.resize(static_cast<std::size_t>(spill_file.size() / sizeof(vectors[0])));
+            return spill_file.read(0, vectors.data(), vectors.size() * sizeof(vectors[0]));
+        };
+        if(!load(values[POSITIONS_ATTRIBUTE], mesh.positions) || !load(values[TEX_COORDS_ATTRIBUTE], mesh.tex_coords)
+                || !load(values[NORMALS_ATTRIBUTE], mesh.normals) || !load(values[COLORS_ATTRIBUTE], mesh.colors)
+                || !load(indices[POSITIONS_ATTRIBUTE], mesh.position_indices)
+                || !load(indices[TEX_COORDS_ATTRIBUTE], mesh.tex_coords_indices)
+                || !load(indices[NORMALS_ATTRIBUTE], mesh.normal_indices)
+                || !load(indices[COLORS_ATTRIBUTE], mesh.color_indices)) {
+            return 1;
+        }
+        post_process_mesh(mesh, mesh_id, options);
+        std::string section{};
+        serialize_mesh(mesh, section);
+        return output.write(section.data(), static_cast<std::streamsize>(section.size())) ? 0 : 7;
+    }
+
+    const ConversionOptions& options;
+    MemoryBudget& budget;
+    XmlScanner& scanner;
+    std::ostream& output;
+    std::size_t meshes_count{};
+    std::size_t spilled_meshes_count{};
+
+    // Of the mesh being read.
+    std::unordered_map<std::string, ElementRef> ids{};
+    std::vector<FloatArray> arrays{};
+    std::vector<SourceInfo> sources{};
+    std::vector<std::vector<PrimitiveInput>> vertices{};
+    std::array<std::vector<SpilledBinding>, ATTRIBUTES_COUNT> bindings{};
+    SpillFile raw_floats;
+    std::array<SpillFile, ATTRIBUTES_COUNT> values;
+    std::array<SpillFile, ATTRIBUTES_COUNT> indices;
+    std::uint8_t present_attributes{};
+    bool primitive_found{};
+    // Of the primitive being read.
+    std::array<SpillFile, ATTRIBUTES_COUNT> corners;
+    SpillFile vertex_counts;
+    SpillFile p_counts;
+    PositionsCache positions_cache;
+};
+
+// Copies the source into the spill file when it cannot be mapped as it is: the standard input, or a compressed file.
+bool copy_source(const std::string_view input_file_name, MemoryBudget& budget, SpillFile& copy) {
+    if(input_file_name == STANDARD_STREAM_FILE_NAME) {
+        std::vector<char> block(COPY_BLOCK_BYTES);
+        while(true) {
+            const auto read = std::fread(block.data(), 1, block.size(), stdin);
+            if(!copy.append(block.data(), read)) {
+                return false;
+            }
+            if(read < block.size()) {
+                return std::ferror(stdin) == 0 && copy.flush();
+            }
+        }
+    }
+    // The decompressed block, and the compressed ones read ahead.
+    const BudgetReservation reservation{budget, 6 * COPY_BLOCK_BYTES};
+    return reservation.reserved && stream_compressed_file(input_file_name, detect_compression(input_file_name),
+            [&](const std::string_view block) { return copy.append(block.data(), block.size()); }) && copy.flush();
+}
+
+bool files_equal(const std::string& lhs_name, const std::string& rhs_name) {
+    std::ifstream lhs{lhs_name, std::ios::binary | std::ios::ate};
+    std::ifstream rhs{rhs_name, std::ios::binary | std::ios::ate};
+    if(!lhs.is_open() || !rhs.is_open() || lhs.tellg() != rhs.tellg()) {
+        return false;
+    }
+    lhs.seekg(0);
+    rhs.seekg(0);
+    std::vector<char> lhs_block(COPY_BLOCK_BYTES);
+    std::vector<char> rhs_block(COPY_BLOCK_BYTES);
+    while(true) {
+        lhs.read(lhs_block.data(), static_cast<std::streamsize>(lhs_block.size()));
+        rhs.read(rhs_block.data(), static_cast<std::streamsize>(rhs_block.size()));
+        const auto count = static_cast<std::size_t>(lhs.gcount());
+        if(count != static_cast<std::size_t>(rhs.gcount())
+                || std::memcmp(lhs_block.data(), rhs_block.data(), count) != 0) {
+            return false;
+        }
+        if(count < lhs_block.size()) {
+            return true;
+        }
+    }
+}
+
+// Copies the file to the standard output, or to an output that is not a file, such as a device, in place.
+bool copy_file_out(const std::string& file_name, const std::string_view output_file_name) {
+    std::ifstream file{file_name, std::ios::binary};
+    const auto to_standard_output = output_file_name == STANDARD_STREAM_FILE_NAME;
+    std::ofstream output_file{};
+    if(!to_standard_output) {
+        output_file.open(std::string{output_file_name}, std::ios::binary | std::ios::trunc);
+    }
+    if(!file.is_open() || (!to_standard_output && !output_file.is_open())) {
+        return false;
+    }
+    std::vector<char> block(COPY_BLOCK_BYTES);
+    while(file) {
+        file.read(block.data(), static_cast<std::streamsize>(block.size()));
+        const auto count = static_cast<std::size_t>(file.gcount());
+        const auto written = to_standard_output ? std::fwrite(block.data(), 1, count, stdout) == count
+                : static_cast<bool>(output_file.write(block.data(), static_cast<std::streamsize>(count)));
+        if(!written) {
+            return false;
+        }
+    }
+    return file.eof() && (to_standard_output ? std::fflush(stdout) == 0 : static_cast<bool>(output_file.flush()));
+}
+
+} // namespace
+
+int convert_out_of_core(const std::string_view input_file_name, const std::string_view output_file_name,
+        const ConversionOptions& options) {
+    namespace fs = std::filesystem;
+    const ExecutorScope executor_scope{options.executor};
+    std::error_code error{};
+    const auto directory = !options.spill_directory.empty() ? options.spill_directory
+            : fs::temp_directory_path(error).string();
+    MemoryBudget budget{options.max_memory};
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const auto window_bytes = std::clamp(options.max_memory / 8, MIN_WINDOW_BYTES, MAX_WINDOW_BYTES)
+            / page_size * page_size;
+    const auto cache_bytes = std::clamp(options.max_memory / 16, MIN_POSITIONS_CACHE_BYTES, MAX_POSITIONS_CACHE_BYTES);
+    if(!budget.reserve(window_bytes + cache_bytes + SPILL_BUFFERS_COUNT * SPILL_BUFFER_BYTES)) {
+        report(options, "Error: The memory budget is too small to convert \"", input_file_name, "\".\n");
+        return 9;
+    }
+
+    // The source, mapped as it is or copied to a spill file first.
+    SpillFile source_copy{directory};
+    auto descriptor = -1;
+    std::uint64_t source_size{};
+    if(input_file_name == STANDARD_STREAM_FILE_NAME || detect_compression(input_file_name) != SourceCompression::none) {
+        if(copy_source(input_file_name, budget, source_copy)) {
+            descriptor = source_copy.descriptor;
+            source_size = source_copy.size();
+        }
+    } else if(descriptor = open(std::string{input_file_name}.c_str(), O_RDONLY | O_CLOEXEC); descriptor >= 0) {
+        struct stat status{};
+        source_size = fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) ? status.st_size : 0;
+    }
+    const auto source_opened = descriptor >= 0 && (source_size != 0 || source_copy.descriptor == descriptor);
+    if(!source_opened) {
+        if(descriptor >= 0 && descriptor != source_copy.descriptor) {
+            close(descriptor);
+        }
+        report(options, "Failed to open collada source file \"", input_file_name, "\".\n");
+        return 1;
+    }
+
+    // Written to a file in every case, as the header is written last: outputs that are not files get a copy of it.
+    const fs::path output_path{output_file_name};
+    const auto status = fs::status(output_path, error);
+    const auto copied_out = output_file_name == STANDARD_STREAM_FILE_NAME
+            || (fs::exists(status) && !fs::is_regular_file(status));
+    auto written_file_name = output_path.string() + ".part";
+    if(copied_out) {
+        written_file_name = directory + "/dae2obm-output-XXXXXX";
+        const auto output_descriptor = mkstemp(written_file_name.data());
+        if(output_descriptor >= 0) {
+            close(output_descriptor);
+        }
+    }
+    std::ofstream output_file{written_file_name, std::ios::binary | std::ios::trunc};
+    auto result = 7;
+    std::size_t meshes_count{};
+    std::size_t spilled_meshes_count{};
+    if(output_file.is_open() && output_file.write("OBMF", 4).put('\0')) {
+        MappedWindow window{descriptor, source_size, window_bytes};
+        XmlScanner scanner{window};
+        OutOfCoreConverter converter{options, budget, scanner, output_file, directory, cache_bytes};
+        result = converter.convert_document(input_file_name);
+        meshes_count = converter.meshes_count;
+        spilled_meshes_count = converter.spilled_meshes_count;
+    }
+    if(descriptor != source_copy.descriptor) {
+        close(descriptor);
+    }
+    if(result == 1) {
+        report(options, "Failed to open collada source file \"", input_file_name, "\".\n");
+    }
+    if(result == 0) {
+        std::string header{};
+        append_file_header(header, meshes_count);
+        output_file.seekp(0);
+        output_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        output_file.close();
+        if(!output_file) {
+            result = 7;
+        } else if(copied_out) {
+            result = copy_file_out(written_file_name, output_file_name) ? 0 : 7;
+        } else if(options.restat && files_equal(written_file_name, output_path.string())) {
+            fs::remove(written_file_name, error);
+        } else if(fs::rename(written_file_name, output_path, error), error) {
+            result = 7;
+        }
+    }
+    if(result != 0 || copied_out) {
+        fs::remove(written_file_name, error);
+    }
+    if(result == 7) {
+        report(options, "Failed to write to file \"", output_file_name, "\".\n");
+    }
+    if(options.report_stages) {
+        report(options, "Out-of-core conversion of \"", input_file_name, "\" (", meshes_count, " meshes, ",
+                spilled_meshes_count, " post-processed externally): ", budget.peak >> 20, " MB of the ",
+                options.max_memory >> 20, " MB budget used at most.\n");
+    }
+    return result;
+}
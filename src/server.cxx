@@ -0,0 +1,269 @@
+#include <server.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <command_line.hxx>
+#include <thread_pool.hxx>
+
+#ifdef __linux__
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Latencies kept for the percentiles; older requests are only counted.
+constexpr std::size_t MAX_LATENCY_SAMPLES = 64 * 1024;
+
+struct LatencyStats {
+    std::mutex mutex{};
+    // Milliseconds, used as a ring buffer once full.
+    std::vector<double> samples{};
+    std::size_t requests_count{};
+
+    void add(const double milliseconds) {
+        const std::lock_guard lock{mutex};
+        if(samples.size() < MAX_LATENCY_SAMPLES) {
+            samples.push_back(milliseconds);
+        } else {
+            samples[requests_count % MAX_LATENCY_SAMPLES] = milliseconds;
+        }
+        ++requests_count;
+    }
+
+    std::string report() {
+        std::vector<double> sorted_samples{};
+        std::size_t count{};
+        {
+            const std::lock_guard lock{mutex};
+            sorted_samples = samples;
+            count = requests_count;
+        }
+        std::sort(sorted_samples.begin(), sorted_samples.end());
+        const auto percentile = [&](const double fraction) {
+            if(sorted_samples.empty()) {
+                return 0.0;
+            }
+            const auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted_samples.size()));
+            return sorted_samples[std::min(index, sorted_samples.size() - 1)];
+        };
+        std::ostringstream text{};
+        text << "Requests: " << count << ", latency p50 " << percentile(0.5) << "ms, p90 " << percentile(0.9)
+                << "ms, p99 " << percentile(0.99) << "ms, max " << percentile(1.0) << "ms.";
+        return text.str();
+    }
+};
+
+struct ConnectionQueue {
+    std::mutex mutex{};
+    std::condition_variable ready{};
+    std::deque<int> descriptors{};
+};
+
+bool make_address(const std::string_view socket_path, sockaddr_un& address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if(socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+    return true;
+}
+
+int connect_to(const std::string_view socket_path) {
+    sockaddr_un address{};
+    if(!make_address(socket_path, address)) {
+        return -1;
+    }
+    const auto descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(descriptor >= 0 && connect(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        close(descriptor);
+        return -1;
+    }
+    return descriptor;
+}
+
+bool write_all(const int descriptor, std::string_view bytes) {
+    while(!bytes.empty()) {
+        const auto written = send(descriptor, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written <= 0) {
+            return false;
+        }
+        bytes.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+// Reads until the buffer holds a whole message ending with the terminator, and moves it out of the buffer, without
+// the terminator. Bytes read past the message stay in the buffer for the next one.
+bool read_message(const int descriptor, const std::string_view terminator, std::string& buffer, std::string& message) {
+    std::size_t searched{};
+    while(true) {
+        const auto end = buffer.find(terminator, searched);
+        if(end != std::string::npos) {
+            message.assign(buffer, 0, end);
+            buffer.erase(0, end + terminator.size());
+            return true;
+        }
+        searched = buffer.size() - std::min(buffer.size(), terminator.size() - 1);
+        char chunk[4096];
+        const auto size = read(descriptor, chunk, sizeof(chunk));
+        if(size < 0 && errno == EINTR) {
+            continue;
+        }
+        if(size <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(size));
+    }
+}
+
+} // namespace
+
+int serve(const std::string_view socket_path, const std::size_t workers_count, ConversionCache* cache) {
+    sockaddr_un address{};
+    if(!make_address(socket_path, address)) {
+        return 1;
+    }
+    // A socket file nobody listens on is left over by a server that did not exit cleanly.
+    if(const auto descriptor = connect_to(socket_path); descriptor >= 0) {
+        close(descriptor);
+        return 1;
+    }
+    unlink(address.sun_path);
+    const auto listen_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listen_descriptor < 0) {
+        return 1;
+    }
+    // Requests read and write files with the rights of the server, so only its user may connect: the socket file is
+    // created without rights for the group and others, before any other thread could create files.
+    const auto previous_mask = umask(S_IRWXG | S_IRWXO);
+    const auto bound = bind(listen_descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    umask(previous_mask);
+    if(!bound || chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0 || listen(listen_descriptor, SOMAXCONN) != 0) {
+        return 1;
+    }
+
+    // The parallel steps of every request run on these threads, started once.
+    ThreadPool thread_pool{default_threads_count()};
+    const auto executor = thread_pool.executor();
+    ConnectionQueue queue{};
+    LatencyStats stats{};
+    std::mutex eviction_mutex{};
+    const auto serve_request = [&](const std::string& request, tinyxml2::XMLDocument& collada_file) {
+        std::vector<std::string> arguments{};
+        for(std::size_t begin{}; begin < request.size();) {
+            const auto end = std::min(request.find('\0', begin), request.size());
+            arguments.emplace_back(request, begin, end - begin);
+            begin = end + 1;
+        }
+        if(arguments.size() == 1 && arguments[0] == "--stats") {
+            return stats.report();
+        }
+        std::vector<const char*> argv{"dae2obm"};
+        for(const auto& argument : arguments) {
+            argv.push_back(argument.c_str());
+        }
+        // The cache options of the request are ignored: its conversions go through the server's cache.
+        CommandLine command_line{};
+        if(!parse_arguments(static_cast<int>(argv.size()), argv.data(), command_line) || command_line.batch
+                || command_line.watch || command_line.merge_summaries || !command_line.serve_socket.empty()
+                || !command_line.client_socket.empty() || uses_standard_streams(command_line)) {
+            return std::string{"Invalid request."};
+        }
+        command_line.options.executor = executor;
+        const auto start_time = Clock::now();
+        const auto result = convert_command_line(command_line, collada_file, cache);
+        const std::chrono::duration<double, std::milli> latency = Clock::now() - start_time;
+        stats.add(latency.count());
+        if(cache != nullptr && cache->max_size != 0) {
+            const std::lock_guard lock{eviction_mutex};
+            evict_cache_entries(*cache);
+        }
+        return std::to_string(result) + ' ' + std::to_string(latency.count());
+    };
+    const auto run_worker = [&] {
+        tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+        configure_document(collada_file);
+        while(true) {
+            int descriptor{};
+            {
+                std::unique_lock lock{queue.mutex};
+                queue.ready.wait(lock, [&] { return !queue.descriptors.empty(); });
+                descriptor = queue.descriptors.front();
+                queue.descriptors.pop_front();
+            }
+            std::string buffer{};
+            std::string request{};
+            while(read_message(descriptor, std::string_view{"\0\0", 2}, buffer, request)
+                    && write_all(descriptor, serve_request(request, collada_file) + '\n')) {
+            }
+            close(descriptor);
+        }
+    };
+    for(std::size_t worker{}; worker < std::max<std::size_t>(workers_count, 1); ++worker) {
+        std::thread{run_worker}.detach();
+    }
+
+    std::cout << "Serving on \"" << socket_path << "\".\n";
+    while(true) {
+        const auto descriptor = accept4(listen_descriptor, nullptr, nullptr, SOCK_CLOEXEC);
+        if(descriptor < 0) {
+            if(errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE) {
+                continue;
+            }
+            return 1;
+        }
+        {
+            const std::lock_guard lock{queue.mutex};
+            queue.descriptors.push_back(descriptor);
+        }
+        queue.ready.notify_one();
+    }
+}
+
+bool send_request(const std::string_view socket_path, const std::vector<std::string>& arguments, std::string& reply) {
+    const auto descriptor = connect_to(socket_path);
+    if(descriptor < 0) {
+        return false;
+    }
+    std::string request{};
+    for(const auto& argument : arguments) {
+        request += argument;
+        request += '\0';
+    }
+    request += '\0';
+    std::string buffer{};
+    const auto replied = write_all(descriptor, request) && read_message(descriptor, "\n", buffer, reply);
+    close(descriptor);
+    return replied;
+}
+
+#else
+
+int serve(const std::string_view, const std::size_t, ConversionCache*) {
+    return 1;
+}
+
+bool send_request(const std::string_view, const std::vector<std::string>&, std::string&) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include <spill_file.hxx>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+bool write_all(const int descriptor, const char* bytes, std::size_t size, std::uint64_t offset) {
+    while(size != 0) {
+        const auto written = pwrite(descriptor, bytes, size, static_cast<off_t>(offset));
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+bool read_all(const int descriptor, char* bytes, std::size_t size, std::uint64_t offset) {
+    while(size != 0) {
+        const auto read = pread(descriptor, bytes, size, static_cast<off_t>(offset));
+        if(read < 0 && errno == EINTR) {
+            continue;
+        }
+        if(read <= 0) {
+            return false;
+        }
+        bytes += read;
+        size -= static_cast<std::size_t>(read);
+        offset += static_cast<std::uint64_t>(read);
+    }
+    return true;
+}
+
+// A file of the directory that no name refers to, so that it goes away with its descriptor.
+int create_unnamed_file(const std::string& directory) {
+#ifdef O_TMPFILE
+    if(const auto descriptor = open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600); descriptor >= 0) {
+        return descriptor;
+    }
+#endif
+    auto name = directory + "/dae2obm-spill-XXXXXX";
+    const auto descriptor = mkstemp(name.data());
+    if(descriptor >= 0) {
+        unlink(name.c_str());
+        fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    }
+    return descriptor;
+}
+
+} // namespace
+
+SpillFile::SpillFile(std::string directory)
+        : directory{std::move(directory)}, buffer(SPILL_BUFFER_BYTES) {}
+
+SpillFile::SpillFile(SpillFile&& other) noexcept
+        : directory{std::move(other.directory)}, buffer{std::move(other.buffer)}, buffered_size{other.buffered_size},
+          file_size{other.file_size}, descriptor{std::exchange(other.descriptor, -1)}, failed{other.failed} {
+    other.buffered_size = 0;
+    other.file_size = 0;
+}
+
+SpillFile& SpillFile::operator=(SpillFile&& other) noexcept {
+    if(this != &other) {
+        if(descriptor >= 0) {
+            close(descriptor);
+        }
+        directory = std::move(other.directory);
+        buffer = std::move(other.buffer);
+        buffered_size = std::exchange(other.buffered_size, 0);
+        file_size = std::exchange(other.file_size, 0);
+        descriptor = std::exchange(other.descriptor, -1);
+        failed = other.failed;
+    }
+    return *this;
+}
+
+SpillFile::~SpillFile() {
+    if(descriptor >= 0) {
+        close(descriptor);
+    }
+}
+
+bool SpillFile::append(const void* bytes, std::size_t size) {
+    auto source = static_cast<const char*>(bytes);
+    while(size != 0 && !failed) {
+        if(buffered_size == buffer.size() && !flush()) {
+            return false;
+        }
+        const auto count = std::min(size, buffer.size() - buffered_size);
+        std::memcpy(buffer.data() + buffered_size, source, count);
+        buffered_size += count;
+        source += count;
+        size -= count;
+    }
+    return !failed;
+}
+
+bool SpillFile::read(const std::uint64_t offset, void* bytes, const std::size_t size) const {
+    if(failed || offset > this->size() || size > this->size() - offset) {
+        return false;
+    }
+    auto destination = static_cast<char*>(bytes);
+    // The bytes before file_size are in the file, the others in the buffer.
+    const auto file_count = offset < file_size
+            ? static_cast<std::size_t>(std::min<std::uint64_t>(size, file_size - offset)) : 0;
+    if(file_count != 0 && !read_all(descriptor, destination, file_count, offset)) {
+        return false;
+    }
+    if(file_count != size) {
+        std::memcpy(destination + file_count, buffer.data() + (offset + file_count - file_size), size - file_count);
+    }
+    return true;
+}
+
+bool SpillFile::flush() {
+    if(failed) {
+        return false;
+    }
+    if(descriptor < 0) {
+        descriptor = create_unnamed_file(directory);
+    }
+    if(descriptor < 0 || !write_all(descriptor, buffer.data(), buffered_size, file_size)) {
+        failed = true;
+        return false;
+    }
+    file_size += buffered_size;
+    buffered_size = 0;
+    return true;
+}
+
+void SpillFile::clear() {
+    // Releases the blocks of the file, which could be large.
+    if(descriptor >= 0 && file_size != 0 && ftruncate(descriptor, 0) != 0) {
+        close(descriptor);
+        descriptor = -1;
+    }
+    buffered_size = 0;
+    file_size = 0;
+    failed = false;
+}
@@ -0,0 +1,359 @@
+#include <tangents.hxx>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+namespace {
+
+constexpr std::size_t TRIANGLES_PER_TASK = 1 << 14;
+constexpr std::size_t BUCKETS_PER_TASK = 1 << 14;
+constexpr auto NO_INDEX = static_cast<std::uint32_t>(-1);
+constexpr auto NO_TRIANGLE = static_cast<std::uint32_t>(-1);
+constexpr auto NO_GROUP = static_cast<std::uint32_t>(-1);
+
+// Triangle flags of the MikkTSpace reference implementation.
+constexpr std::uint8_t ORIENT_PRESERVING = 0b001;
+// The texture mapping of the triangle is degenerate, so it contributes no tangent and takes the orientation of the
+// first group it joins.
+constexpr std::uint8_t GROUP_WITH_ANY = 0b010;
+// Two corners of the triangle are the same vertex.
+constexpr std::uint8_t MARK_DEGENERATE = 0b100;
+
+// The tests and arithmetic of the reference implementation, which the results have to match bit for bit.
+bool not_zero(const float value) {
+    return std::abs(value) > std::numeric_limits<float>::min();
+}
+
+bool not_zero(const Vector3& vec) {
+    return not_zero(vec.x) || not_zero(vec.y) || not_zero(vec.z);
+}
+
+Vector3 normalized(const Vector3& vec) {
+    return vec * (1.0f / length(vec));
+}
+
+// The vector projected onto the plane of the normal, normalized unless it vanishes.
+Vector3 project(const Vector3& vec, const Vector3& normal) {
+    const auto projected = vec - normal * dot(normal, vec);
+    return not_zero(projected) ? normalized(projected) : projected;
+}
+
+std::uint32_t float_bits(const float value) {
+    // Adding zero turns -0 into 0, the two comparing equal.
+    const auto zeroed = value + 0.0f;
+    std::uint32_t bits{};
+    std::memcpy(&bits, &zeroed, sizeof(bits));
+    return bits;
+}
+
+std::array<std::uint32_t, 2> value_key(const Vector2& vec) {
+    return {float_bits(vec.x), float_bits(vec.y)};
+}
+
+std::array<std::uint32_t, 3> value_key(const Vector3& vec) {
+    return {float_bits(vec.x), float_bits(vec.y), float_bits(vec.z)};
+}
+
+struct Buckets {
+    std::vector<std::uint32_t> items;
+    // Start of every bucket in items, and the end of the last one.
+    std::vector<std::uint64_t> starts;
+};
+
+// Sorts the items into buckets with a counting sort, which keeps them in item order.
+template<typename BucketOf>
+Buckets sort_into_buckets(const std::size_t threads_count, const std::size_t items_count,
+        const std::size_t buckets_count, const BucketOf& bucket_of) {
+    std::vector<std::uint32_t> item_buckets(items_count);
+    parallel_for(threads_count, items_count, BUCKETS_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto item = begin; item < end; ++item) {
+            item_buckets[item] = static_cast<std::uint32_t>(bucket_of(static_cast<std::uint32_t>(item)));
+        }
+    });
+    std::vector<std::uint32_t> bucket_sizes(buckets_count);
+    for(const auto bucket : item_buckets) {
+        ++bucket_sizes[bucket];
+    }
+    Buckets buckets{std::vector<std::uint32_t>(items_count), {}};
+    parallel_exclusive_scan(threads_count, bucket_sizes, buckets.starts);
+    std::vector<std::uint64_t> bucket_ends(buckets.starts.begin(), buckets.starts.end() - 1);
+    for(std::uint32_t item{}; item < items_count; ++item) {
+        buckets.items[bucket_ends[item_buckets[item]]++] = item;
+    }
+    return buckets;
+}
+
+// Sorts every bucket by key, so that items of equal key end up next to each other in item order.
+template<typename KeyOf>
+Buckets sort_buckets(const std::size_t threads_count, Buckets&& buckets, const KeyOf& key_of) {
+    parallel_for(threads_count, buckets.starts.size() - 1, BUCKETS_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto bucket = begin; bucket < end; ++bucket) {
+            if(buckets.starts[bucket + 1] - buckets.starts[bucket] < 2) {
+                continue;
+            }
+            std::sort(buckets.items.begin() + static_cast<std::ptrdiff_t>(buckets.starts[bucket]),
+                    buckets.items.begin() + static_cast<std::ptrdiff_t>(buckets.starts[bucket + 1]),
+                    [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+                const auto lhs_key = key_of(lhs);
+                const auto rhs_key = key_of(rhs);
+                return lhs_key != rhs_key ? lhs_key < rhs_key : lhs < rhs;
+            });
+        }
+    });
+    return std::move(buckets);
+}
+
+// Maps every item to the first item of equal key.
+template<typename KeyOf>
+std::vector<std::uint32_t> first_equal_items(const std::size_t threads_count, const Buckets& buckets,
+        const KeyOf& key_of) {
+    std::vector<std::uint32_t> first_items(buckets.items.size());
+    parallel_for(threads_count, buckets.starts.size() - 1, BUCKETS_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto bucket = begin; bucket < end; ++bucket) {
+            for(auto i = buckets.starts[bucket]; i < buckets.starts[bucket + 1]; ++i) {
+                const auto item = buckets.items[i];
+                const auto is_first = i == buckets.starts[bucket] || key_of(item) != key_of(buckets.items[i - 1]);
+                first_items[item] = is_first ? item : first_items[buckets.items[i - 1]];
+            }
+        }
+    });
+    return first_items;
+}
+
+// Maps every index of the values to the first index of an equal value, vertices being told apart by value. The values
+// go into an open-addressing table in index order, which keeps the first index of every value.
+template<typename Vector>
+std::vector<std::uint32_t> first_equal_indices(const std::vector<Vector>& values) {
+    std::vector<std::uint32_t> first_indices(values.size());
+    int table_bits{1};
+    while((std::size_t{1} << table_bits) < values.size() * 2) {
+        ++table_bits;
+    }
+    const auto table_mask = (std::size_t{1} << table_bits) - 1;
+    std::vector<std::uint32_t> table(table_mask + 1, NO_INDEX);
+    for(std::uint32_t index{}; index < values.size(); ++index) {
+        const auto key = value_key(values[index]);
+        std::uint64_t hash{};
+        for(const auto bits : key) {
+            hash = (hash ^ bits) * 0x9e3779b97f4a7c15;
+        }
+        auto slot = static_cast<std::size_t>(hash >> (64 - table_bits));
+        while(table[slot] != NO_INDEX && value_key(values[table[slot]]) != key) {
+            slot = (slot + 1) & table_mask;
+        }
+        if(table[slot] == NO_INDEX) {
+            table[slot] = index;
+        }
+        first_indices[index] = table[slot];
+    }
+    return first_indices;
+}
+
+std::uint32_t next_corner(const std::uint32_t corner) {
+    return corner % 3 == 2 ? corner - 2 : corner + 1;
+}
+
+std::uint32_t previous_corner(const std::uint32_t corner) {
+    return corner % 3 == 0 ? corner + 2 : corner - 1;
+}
+
+} // namespace
+
+bool generate_tangents(Mesh& mesh, const std::size_t threads_count) {
+    if((mesh.present_attributes & TEX_COORDS_PRESENT) == 0 || (mesh.present_attributes & NORMALS_PRESENT) == 0) {
+        return false;
+    }
+    const auto corners_count = static_cast<std::uint32_t>(mesh.position_indices.size());
+    const auto triangles_count = corners_count / 3;
+
+    // Corners are the same vertex when their position, normal and texture coordinates are equal, whatever their
+    // indices. Every corner maps to the first corner of its vertex.
+    const auto first_positions = first_equal_indices(mesh.positions);
+    const auto first_normals = first_equal_indices(mesh.normals);
+    const auto first_tex_coords = first_equal_indices(mesh.tex_coords);
+    const auto vertex_key = [&](const std::uint32_t corner) {
+        return std::make_pair(first_normals[mesh.normal_indices[corner]],
+                first_tex_coords[mesh.tex_coords_indices[corner]]);
+    };
+    const auto vertices = first_equal_items(threads_count, sort_buckets(threads_count,
+            sort_into_buckets(threads_count, corners_count, mesh.positions.size(), [&](const std::uint32_t corner) {
+                return first_positions[mesh.position_indices[corner]];
+            }), vertex_key), vertex_key);
+
+    // The tangent direction of every triangle comes from its texture mapping, with the sign of the mapping's
+    // orientation. Every corner contributes it projected onto the plane of its normal and weighted by its angle there.
+    std::vector<Vector3> contributions(corners_count);
+    std::vector<std::uint8_t> flags(triangles_count);
+    parallel_for(threads_count, triangles_count, TRIANGLES_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        for(auto triangle = begin; triangle < end; ++triangle) {
+            const auto corner = static_cast<std::uint32_t>(triangle * 3);
+            if(vertices[corner] == vertices[corner + 1] || vertices[corner + 1] == vertices[corner + 2]
+                    || vertices[corner] == vertices[corner + 2]) {
+                flags[triangle] = MARK_DEGENERATE;
+                continue;
+            }
+            std::array<Vector3, 3> positions{};
+            std::array<Vector2, 3> tex_coords{};
+            for(std::uint32_t i{}; i < 3; ++i) {
+                positions[i] = mesh.positions[mesh.position_indices[corner + i]];
+                tex_coords[i] = mesh.tex_coords[mesh.tex_coords_indices[corner + i]];
+            }
+            const auto edge1 = positions[1] - positions[0];
+            const auto edge2 = positions[2] - positions[0];
+            const Vector2 delta1{tex_coords[1].x - tex_coords[0].x, tex_coords[1].y - tex_coords[0].y};
+            const Vector2 delta2{tex_coords[2].x - tex_coords[0].x, tex_coords[2].y - tex_coords[0].y};
+            const auto signed_area = delta1.x * delta2.y - delta1.y * delta2.x;
+            const auto tangent = edge1 * delta2.y - edge2 * delta1.y;
+            const auto bitangent = edge1 * -delta2.x + edge2 * delta1.x;
+            flags[triangle] = (signed_area > 0.0f ? ORIENT_PRESERVING : 0) | GROUP_WITH_ANY;
+            if(not_zero(signed_area)) {
+                const auto area = std::abs(signed_area);
+                const auto tangent_length = length(tangent);
+                const auto bitangent_length = length(bitangent);
+                const auto sign = signed_area > 0.0f ? 1.0f : -1.0f;
+                if(not_zero(tangent_length / area) && not_zero(bitangent_length / area)) {
+                    flags[triangle] &= ~GROUP_WITH_ANY;
+                }
+                const auto face_tangent = not_zero(tangent_length) ? tangent * (sign / tangent_length) : Vector3{};
+                for(std::uint32_t i{}; (flags[triangle] & GROUP_WITH_ANY) == 0 && i < 3; ++i) {
+                    const auto& normal = mesh.normals[mesh.normal_indices[corner + i]];
+                    const auto edge1 = project(positions[(i + 2) % 3] - positions[i], normal);
+                    const auto edge2 = project(positions[(i + 1) % 3] - positions[i], normal);
+                    const auto cosine = std::clamp(dot(edge1, edge2), -1.0f, 1.0f);
+                    const auto angle = static_cast<float>(std::acos(static_cast<double>(cosine)));
+                    contributions[corner + i] = project(face_tangent, normal) * angle;
+                }
+            }
+        }
+    });
+
+    // Triangles are neighbours across an edge they share in opposite directions. Edges are bucketed by their lower
+    // vertex and sorted by their higher one, and when more than two triangles share an edge, they pair up in triangle
+    // order. Degenerate triangles go to a last bucket, which is left out.
+    std::vector<std::uint32_t> neighbors(corners_count, NO_TRIANGLE);
+    const auto edges = sort_buckets(threads_count, sort_into_buckets(threads_count, corners_count,
+            std::size_t{corners_count} + 1, [&](const std::uint32_t corner) {
+                return (flags[corner / 3] & MARK_DEGENERATE) != 0 ? corners_count
+                        : std::min(vertices[corner], vertices[next_corner(corner)]);
+            }), [&](const std::uint32_t corner) {
+                return std::max(vertices[corner], vertices[next_corner(corner)]);
+            });
+    parallel_for(threads_count, corners_count, BUCKETS_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto bucket = begin; bucket < end; ++bucket) {
+            for(auto i = edges.starts[bucket]; i < edges.starts[bucket + 1]; ++i) {
+                const auto corner = edges.items[i];
+                const auto higher_vertex = std::max(vertices[corner], vertices[next_corner(corner)]);
+                for(auto j = i + 1; neighbors[corner] == NO_TRIANGLE && j < edges.starts[bucket + 1]; ++j) {
+                    const auto other = edges.items[j];
+                    if(std::max(vertices[other], vertices[next_corner(other)]) != higher_vertex) {
+                        break;
+                    }
+                    if(neighbors[other] == NO_TRIANGLE && vertices[corner] == vertices[next_corner(other)]
+                            && vertices[other] == vertices[next_corner(corner)]) {
+                        neighbors[corner] = other / 3;
+                        neighbors[other] = corner / 3;
+                    }
+                }
+            }
+        }
+    });
+
+    // Every group is a vertex with the corners of the triangles that reach each other across the edges around it and
+    // have the same orientation, which all get the same tangent. Triangles with a degenerate mapping join the first
+    // group that reaches them. Groups are built in corner order, which makes them the same on every run.
+    std::vector<std::uint32_t> corner_groups(corners_count, NO_GROUP);
+    std::vector<std::uint8_t> group_orientations{};
+    std::vector<std::uint32_t> pending{};
+    for(std::uint32_t corner{}; corner < corners_count; ++corner) {
+        if((flags[corner / 3] & MARK_DEGENERATE) != 0 || corner_groups[corner] != NO_GROUP) {
+            continue;
+        }
+        const auto group = static_cast<std::uint32_t>(group_orientations.size());
+        const auto vertex = vertices[corner];
+        const auto orientation = static_cast<std::uint8_t>(flags[corner / 3] & ORIENT_PRESERVING);
+        group_orientations.emplace_back(orientation);
+        corner_groups[corner] = group;
+        pending.assign({neighbors[previous_corner(corner)], neighbors[corner]});
+        while(!pending.empty()) {
+            const auto triangle = pending.back();
+            pending.pop_back();
+            if(triangle == NO_TRIANGLE) {
+                continue;
+            }
+            auto triangle_corner = triangle * 3;
+            while(vertices[triangle_corner] != vertex) {
+                ++triangle_corner;
+            }
+            if(corner_groups[triangle_corner] != NO_GROUP) {
+                continue;
+            }
+            auto& triangle_flags = flags[triangle];
+            if((triangle_flags & GROUP_WITH_ANY) != 0 && corner_groups[triangle * 3] == NO_GROUP
+                    && corner_groups[triangle * 3 + 1] == NO_GROUP && corner_groups[triangle * 3 + 2] == NO_GROUP) {
+                triangle_flags = static_cast<std::uint8_t>((triangle_flags & ~ORIENT_PRESERVING) | orientation);
+            }
+            if((triangle_flags & ORIENT_PRESERVING) != orientation) {
+                continue;
+            }
+            corner_groups[triangle_corner] = group;
+            pending.emplace_back(neighbors[previous_corner(triangle_corner)]);
+            pending.emplace_back(neighbors[triangle_corner]);
+        }
+    }
+
+    // The tangent of a group is the sum of the contributions of its corners in triangle order, normalized. The corners
+    // of degenerate triangles go to a last bucket, which is left out.
+    const auto groups_count = group_orientations.size();
+    const auto group_corners = sort_into_buckets(threads_count, corners_count, groups_count + 1,
+            [&](const std::uint32_t corner) {
+                return corner_groups[corner] != NO_GROUP ? corner_groups[corner] : groups_count;
+            });
+    mesh.tangents.resize(groups_count);
+    parallel_for(threads_count, groups_count, BUCKETS_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto group = begin; group < end; ++group) {
+            Vector3 sum{};
+            for(auto i = group_corners.starts[group]; i < group_corners.starts[group + 1]; ++i) {
+                const auto corner = group_corners.items[i];
+                if((flags[corner / 3] & GROUP_WITH_ANY) == 0) {
+                    sum += contributions[corner];
+                }
+            }
+            const auto tangent = not_zero(sum) ? normalized(sum) : sum;
+            mesh.tangents[group] = {tangent.x, tangent.y, tangent.z, group_orientations[group] != 0 ? 1.0f : -1.0f};
+        }
+    });
+
+    // Corners of degenerate triangles take the tangent of the first other corner of their vertex, or else the default
+    // frame of the reference implementation.
+    std::vector<std::uint32_t> vertex_groups(corners_count, NO_GROUP);
+    for(std::uint32_t corner{}; corner < corners_count; ++corner) {
+        if(corner_groups[corner] != NO_GROUP && vertex_groups[vertices[corner]] == NO_GROUP) {
+            vertex_groups[vertices[corner]] = corner_groups[corner];
+        }
+    }
+    mesh.tangent_indices.resize(corners_count);
+    for(std::uint32_t corner{}; corner < corners_count; ++corner) {
+        auto group = corner_groups[corner] != NO_GROUP ? corner_groups[corner] : vertex_groups[vertices[corner]];
+        if(group == NO_GROUP) {
+            group = static_cast<std::uint32_t>(mesh.tangents.size());
+            mesh.tangents.push_back({1.0f, 0.0f, 0.0f, -1.0f});
+            vertex_groups[vertices[corner]] = group;
+        }
+        mesh.tangent_indices[corner] = group;
+    }
+    mesh.present_attributes |= TANGENTS_PRESENT;
+    return true;
+}
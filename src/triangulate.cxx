@@ -0,0 +1,198 @@
+#include <triangulate.hxx>
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+namespace {
+
+constexpr std::size_t POLYGONS_PER_TASK = 4096;
+
+std::size_t triangles_in_primitive(const std::uint32_t vertex_count) {
+    return vertex_count >= 3 ? vertex_count - 2 : 0;
+}
+
+// Newell's method, robust for non-planar and concave polygons.
+Vector3 polygon_normal(const std::uint32_t* position_indices, const std::uint32_t vertex_count,
+        const std::vector<Vector3>& positions) {
+    Vector3 normal{};
+    for(std::uint32_t i{}; i < vertex_count; ++i) {
+        const auto& current = positions[position_indices[i]];
+        const auto& next = positions[position_indices[(i + 1) % vertex_count]];
+        normal.x += (current.y - next.y) * (current.z + next.z);
+        normal.y += (current.z - next.z) * (current.x + next.x);
+        normal.z += (current.x - next.x) * (current.y + next.y);
+    }
+    return normal;
+}
+
+bool is_convex(const std::uint32_t* position_indices, const std::uint32_t vertex_count,
+        const std::vector<Vector3>& positions, const Vector3& normal) {
+    for(std::uint32_t i{}; i < vertex_count; ++i) {
+        const auto& previous = positions[position_indices[(i + vertex_count - 1) % vertex_count]];
+        const auto& current = positions[position_indices[i]];
+        const auto& next = positions[position_indices[(i + 1) % vertex_count]];
+        if(dot(cross(current - previous, next - current), normal) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void triangulate_fan(const std::uint32_t first_corner, const std::uint32_t vertex_count, std::uint32_t* triangles) {
+    for(std::uint32_t i{1}; i + 1 < vertex_count; ++i) {
+        *triangles++ = first_corner;
+        *triangles++ = first_corner + i;
+        *triangles++ = first_corner + i + 1;
+    }
+}
+
+void triangulate_strip(const std::uint32_t first_corner, const std::uint32_t vertex_count, std::uint32_t* triangles) {
+    for(std::uint32_t i{}; i + 2 < vertex_count; ++i) {
+        // Every other triangle of a strip has to be flipped to keep a consistent winding.
+        *triangles++ = first_corner + i + (i & 1);
+        *triangles++ = first_corner + i + 1 - (i & 1);
+        *triangles++ = first_corner + i + 2;
+    }
+}
+
+struct Point2 {
+    float u;
+    float v;
+};
+
+float signed_area(const Point2& a, const Point2& b, const Point2& c) {
+    return (b.u - a.u) * (c.v - a.v) - (b.v - a.v) * (c.u - a.u);
+}
+
+bool is_inside_triangle(const Point2& point, const Point2& a, const Point2& b, const Point2& c) {
+    return signed_area(a, b, point) >= 0.0f && signed_area(b, c, point) >= 0.0f && signed_area(c, a, point) >= 0.0f;
+}
+
+// Ear clipping in the plane of the polygon. Always emits vertex_count - 2 triangles: if no ear can be found (degenerate
+// or self-intersecting input), the remaining vertices are fanned.
+void triangulate_ear_clipping(const std::uint32_t first_corner, const std::uint32_t* position_indices,
+        const std::uint32_t vertex_count, const std::vector<Vector3>& positions, const Vector3& normal,
+        std::vector<Point2>& points, std::vector<std::uint32_t>& remaining, std::uint32_t* triangles) {
+    // Project onto the plane of the two axes least aligned with the normal, keeping the polygon counter-clockwise.
+    const Vector3 magnitude{std::abs(normal.x), std::abs(normal.y), std::abs(normal.z)};
+    points.resize(vertex_count);
+    for(std::uint32_t i{}; i < vertex_count; ++i) {
+        const auto& position = positions[position_indices[i]];
+        if(magnitude.z >= magnitude.x && magnitude.z >= magnitude.y) {
+            points[i] = normal.z >= 0.0f ? Point2{position.x, position.y} : Point2{position.y, position.x};
+        } else if(magnitude.y >= magnitude.x) {
+            points[i] = normal.y >= 0.0f ? Point2{position.z, position.x} : Point2{position.x, position.z};
+        } else {
+            points[i] = normal.x >= 0.0f ? Point2{position.y, position.z} : Point2{position.z, position.y};
+        }
+    }
+    remaining.resize(vertex_count);
+    for(std::uint32_t i{}; i < vertex_count; ++i) {
+        remaining[i] = i;
+    }
+    while(remaining.size() > 3) {
+        bool ear_found{};
+        for(std::size_t i{}; i < remaining.size() && !ear_found; ++i) {
+            const auto previous = remaining[(i + remaining.size() - 1) % remaining.size()];
+            const auto current = remaining[i];
+            const auto next = remaining[(i + 1) % remaining.size()];
+            if(signed_area(points[previous], points[current], points[next]) <= 0.0f) {
+                continue;
+            }
+            ear_found = std::none_of(remaining.begin(), remaining.end(), [&](const std::uint32_t other) {
+                return other != previous && other != current && other != next
+                        && is_inside_triangle(points[other], points[previous], points[current], points[next]);
+            });
+            if(ear_found) {
+                *triangles++ = first_corner + previous;
+                *triangles++ = first_corner + current;
+                *triangles++ = first_corner + next;
+                remaining.erase(remaining.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+        if(!ear_found) {
+            break;
+        }
+    }
+    for(std::size_t i{1}; i + 1 < remaining.size(); ++i) {
+        *triangles++ = first_corner + remaining[0];
+        *triangles++ = first_corner + remaining[i];
+        *triangles++ = first_corner + remaining[i + 1];
+    }
+}
+
+// Triangulates a primitive of at least 3 corners, the first of which is first_corner.
+void triangulate_primitive(const PrimitiveType type, const std::uint32_t first_corner,
+        const std::uint32_t* position_indices, const std::uint32_t vertex_count, const std::vector<Vector3>& positions,
+        std::vector<Point2>& points, std::vector<std::uint32_t>& remaining, std::uint32_t* triangles) {
+    if(type == PrimitiveType::TRISTRIPS) {
+        triangulate_strip(first_corner, vertex_count, triangles);
+        return;
+    }
+    if(type != PrimitiveType::POLYGONS || vertex_count == 3) {
+        triangulate_fan(first_corner, vertex_count, triangles);
+        return;
+    }
+    const auto normal = polygon_normal(position_indices, vertex_count, positions);
+    if(is_convex(position_indices, vertex_count, positions, normal)) {
+        triangulate_fan(first_corner, vertex_count, triangles);
+    } else {
+        triangulate_ear_clipping(first_corner, position_indices, vertex_count, positions, normal, points, remaining,
+                triangles);
+    }
+}
+
+} // namespace
+
+std::vector<std::uint32_t> triangulate(const PrimitiveType type, const std::vector<std::uint32_t>& vertex_counts,
+        const std::vector<std::uint32_t>& position_indices, const std::vector<Vector3>& positions,
+        const std::size_t threads_count) {
+    // Prefix sums over the vertex counts give every primitive its first source corner and its first output triangle,
+    // so that ranges of primitives can be triangulated independently.
+    std::vector<std::uint64_t> first_corners{};
+    parallel_exclusive_scan(threads_count, vertex_counts, first_corners);
+    std::vector<std::uint32_t> triangles_counts(vertex_counts.size());
+    std::transform(vertex_counts.begin(), vertex_counts.end(), triangles_counts.begin(), triangles_in_primitive);
+    std::vector<std::uint64_t> first_triangles{};
+    parallel_exclusive_scan(threads_count, triangles_counts, first_triangles);
+    std::vector<std::uint32_t> triangles(first_triangles.back() * 3);
+    parallel_for(threads_count, vertex_counts.size(), POLYGONS_PER_TASK,
+            [&](const std::size_t begin, const std::size_t end) {
+        std::vector<Point2> points{};
+        std::vector<std::uint32_t> remaining{};
+        for(auto primitive = begin; primitive < end; ++primitive) {
+            const auto vertex_count = vertex_counts[primitive];
+            if(vertex_count < 3) {
+                continue;
+            }
+            const auto first_corner = static_cast<std::uint32_t>(first_corners[primitive]);
+            triangulate_primitive(type, first_corner, position_indices.data() + first_corner, vertex_count, positions,
+                    points, remaining, triangles.data() + first_triangles[primitive] * 3);
+        }
+    });
+    return triangles;
+}
+
+void triangulate_primitive(const PrimitiveType type, const std::uint32_t vertex_count,
+        const std::vector<Vector3>& corner_positions, std::vector<std::uint32_t>& triangles) {
+    triangles.resize(triangles_in_primitive(vertex_count) * 3);
+    if(vertex_count < 3) {
+        return;
+    }
+    std::vector<std::uint32_t> position_indices{};
+    std::vector<Point2> points{};
+    std::vector<std::uint32_t> remaining{};
+    // Only the ear clipping of concave polygons needs the positions by index.
+    if(type == PrimitiveType::POLYGONS && vertex_count > 3) {
+        position_indices.resize(vertex_count);
+        for(std::uint32_t i{}; i < vertex_count; ++i) {
+            position_indices[i] = i;
+        }
+    }
+    triangulate_primitive(type, 0, position_indices.data(), vertex_count, corner_positions, points, remaining,
+            triangles.data());
+}
@@ -0,0 +1,240 @@
+#include <watch.hxx>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <batch.hxx>
+#include <compression.hxx>
+
+#ifdef __linux__
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t FILE_EVENTS = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+struct FileState {
+    bool queued{};
+    bool converting{};
+    bool changed_again{};
+    // First change of the pending save, which the printed latency is measured from.
+    Clock::time_point first_change{};
+};
+
+// Files waiting for a worker, with their state. A file is never converted by two workers at once: changes arriving
+// during its conversion set changed_again, and the worker queues it again when it is done.
+struct ConversionQueue {
+    std::mutex mutex{};
+    std::condition_variable ready{};
+    std::deque<std::string> files{};
+    std::unordered_map<std::string, FileState> states{};
+
+    void push(const std::string& file, const Clock::time_point first_change) {
+        {
+            const std::lock_guard lock{mutex};
+            auto& state = states[file];
+            if(state.converting) {
+                if(!state.changed_again) {
+                    state.changed_again = true;
+                    state.first_change = first_change;
+                }
+                return;
+            }
+            if(state.queued) {
+                return;
+            }
+            state.queued = true;
+            state.first_change = first_change;
+            files.push_back(file);
+        }
+        ready.notify_one();
+    }
+};
+
+void add_watches(const int inotify_descriptor, const std::filesystem::path& directory,
+        std::unordered_map<int, std::filesystem::path>& watched_directories) {
+    const auto add_watch = [&](const std::filesystem::path& path) {
+        const auto watch_descriptor = inotify_add_watch(inotify_descriptor, path.c_str(), FILE_EVENTS);
+        if(watch_descriptor >= 0) {
+            watched_directories[watch_descriptor] = path;
+        }
+    };
+    add_watch(directory);
+    std::error_code error{};
+    for(std::filesystem::recursive_directory_iterator entry{directory, error}, end{}; !error && entry != end;
+            entry.increment(error)) {
+        if(entry->is_directory(error)) {
+            add_watch(entry->path());
+        }
+    }
+}
+
+// Whether the output is missing or not newer than its source. Timestamps too coarse to tell count as out of date.
+bool is_out_of_date(const std::string& input_file_name, const std::string& output_file_name) {
+    std::error_code error{};
+    const auto output_time = std::filesystem::last_write_time(output_file_name, error);
+    if(error) {
+        return true;
+    }
+    const auto input_time = std::filesystem::last_write_time(input_file_name, error);
+    return error || input_time >= output_time;
+}
+
+} // namespace
+
+int watch_directory(const std::string_view source_directory, const std::string_view output_directory,
+        const ConversionOptions& options, const std::chrono::milliseconds debounce_time, ConversionCache* cache) {
+    const std::filesystem::path source_path{source_directory};
+    const std::filesystem::path output_path{output_directory};
+    const auto inotify_descriptor = inotify_init1(IN_CLOEXEC);
+    if(inotify_descriptor < 0 || !std::filesystem::is_directory(source_path)) {
+        return 1;
+    }
+    std::unordered_map<int, std::filesystem::path> watched_directories{};
+    add_watches(inotify_descriptor, source_path, watched_directories);
+
+    ConversionQueue queue{};
+    auto job_options = options;
+    job_options.threads_count = 1;
+    const auto run_worker = [&] {
+        tinyxml2::XMLDocument collada_file{true, tinyxml2::PRESERVE_WHITESPACE, TRACK_LINES};
+        configure_document(collada_file);
+        while(true) {
+            std::string input_file_name{};
+            {
+                std::unique_lock lock{queue.mutex};
+                queue.ready.wait(lock, [&] { return !queue.files.empty(); });
+                input_file_name = std::move(queue.files.front());
+                queue.files.pop_front();
+                auto& state = queue.states[input_file_name];
+                state.queued = false;
+                state.converting = true;
+            }
+            const auto output_file_name = output_file_name_for(input_file_name, source_path, output_path);
+            std::error_code error{};
+            std::filesystem::create_directories(std::filesystem::path{output_file_name}.parent_path(), error);
+            const auto start_time = Clock::now();
+            const auto result = cache != nullptr
+                    ? convert_cached(*cache, collada_file, input_file_name, output_file_name, job_options)
+                    : convert(collada_file, input_file_name, output_file_name, job_options);
+            const auto end_time = Clock::now();
+            Clock::time_point first_change{};
+            bool changed_again{};
+            {
+                const std::lock_guard lock{queue.mutex};
+                auto& state = queue.states[input_file_name];
+                first_change = state.first_change;
+                changed_again = state.changed_again;
+                state.converting = false;
+                state.changed_again = false;
+            }
+            const std::chrono::duration<double, std::milli> conversion_time = end_time - start_time;
+            const std::chrono::duration<double, std::milli> latency = end_time - first_change;
+            if(result == 0) {
+                std::cout << "Reconverted \"" + input_file_name + "\" in " + std::to_string(conversion_time.count())
+                        + "ms, " + std::to_string(latency.count()) + "ms after the change.\n";
+            } else {
+                std::cerr << "Failed to convert \"" + input_file_name + "\" (error " + std::to_string(result)
+                        + ").\n";
+            }
+            if(changed_again) {
+                queue.push(input_file_name, first_change);
+            }
+        }
+    };
+    std::vector<std::thread> workers{};
+    for(std::size_t worker{}; worker < std::max<std::size_t>(options.threads_count, 1); ++worker) {
+        workers.emplace_back(run_worker);
+        workers.back().detach();
+    }
+
+    // Files are converted once they stop changing for the debounce time, so that a save written in several chunks is
+    // converted once it is complete.
+    std::unordered_map<std::string, std::pair<Clock::time_point, Clock::time_point>> pending_files{};
+    std::vector<char> events(64 * 1024);
+    std::cout << "Watching \"" << source_directory << "\".\n";
+    while(true) {
+        auto timeout = -1;
+        if(!pending_files.empty()) {
+            const auto quiet_since = std::min_element(pending_files.begin(), pending_files.end(),
+                    [](const auto& lhs, const auto& rhs) { return lhs.second.second < rhs.second.second; })
+                    ->second.second;
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(quiet_since + debounce_time
+                    - Clock::now());
+            timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 0));
+        }
+        pollfd descriptor{inotify_descriptor, POLLIN, 0};
+        if(poll(&descriptor, 1, timeout) > 0) {
+            const auto size = read(inotify_descriptor, events.data(), events.size());
+            const auto now = Clock::now();
+            bool overflowed{};
+            for(auto offset = std::ptrdiff_t{}; offset < size;) {
+                inotify_event event{};
+                std::copy_n(events.data() + offset, sizeof(event), reinterpret_cast<char*>(&event));
+                const std::string name{events.data() + offset + sizeof(event)};
+                offset += static_cast<std::ptrdiff_t>(sizeof(event) + event.len);
+                overflowed |= (event.mask & IN_Q_OVERFLOW) != 0;
+                const auto directory = watched_directories.find(event.wd);
+                if(directory == watched_directories.end() || event.len == 0) {
+                    continue;
+                }
+                const auto path = directory->second / name;
+                if(event.mask & IN_ISDIR) {
+                    if(event.mask & (IN_CREATE | IN_MOVED_TO)) {
+                        add_watches(inotify_descriptor, path, watched_directories);
+                    }
+                } else if(is_collada_file_name(path)) {
+                    const auto [file, inserted] = pending_files.try_emplace(path.string(), now, now);
+                    file->second.second = now;
+                }
+            }
+            // The kernel dropped events, so any file may have changed unseen and new directories may be unwatched.
+            // Every file whose output is out of date then goes through the debounce like a changed one.
+            if(overflowed) {
+                std::cerr << "Missed changes in \"" << source_directory << "\", rescanning it.\n";
+                add_watches(inotify_descriptor, source_path, watched_directories);
+                std::vector<BatchJob> jobs{};
+                collect_batch_jobs(source_directory, output_directory, jobs);
+                for(const auto& job : jobs) {
+                    if(is_out_of_date(job.input_file_name, job.output_file_name)) {
+                        const auto [file, inserted] = pending_files.try_emplace(job.input_file_name, now, now);
+                        file->second.second = now;
+                    }
+                }
+            }
+        }
+        const auto now = Clock::now();
+        for(auto file = pending_files.begin(); file != pending_files.end();) {
+            if(now - file->second.second >= debounce_time) {
+                queue.push(file->first, file->second.first);
+                file = pending_files.erase(file);
+            } else {
+                ++file;
+            }
+        }
+    }
+}
+
+#else
+
+int watch_directory(const std::string_view, const std::string_view, const ConversionOptions&,
+        const std::chrono::milliseconds, ConversionCache*) {
+    return 1;
+}
+
+#endif
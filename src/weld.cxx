@@ -0,0 +1,339 @@
+#include <weld.hxx>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <parallel.hxx>
+#include <vector_math.hxx>
+
+namespace {
+
+constexpr std::size_t BUCKET_BITS = 10;
+constexpr std::size_t BUCKETS_COUNT = std::size_t{1} << BUCKET_BITS;
+constexpr std::size_t VALUES_PER_TASK = 1 << 16;
+constexpr std::uint32_t EMPTY_SLOT = std::numeric_limits<std::uint32_t>::max();
+
+std::uint32_t mix(std::uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x7feb352dU;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bU;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+template<typename Value>
+std::uint32_t hash_bits(const Value& value) {
+    std::array<std::uint32_t, sizeof(Value) / sizeof(std::uint32_t)> words{};
+    std::memcpy(words.data(), &value, sizeof(Value));
+    std::uint32_t hash{0x9e3779b9U};
+    for(const auto word : words) {
+        hash = mix(hash ^ word);
+    }
+    return hash;
+}
+
+template<typename Value>
+bool same_bits(const Value& lhs, const Value& rhs) {
+    return std::memcmp(&lhs, &rhs, sizeof(Value)) == 0;
+}
+
+using Cell = std::array<std::int64_t, 3>;
+
+Cell cell_of(const Vector3& position, const float inverse_cell_size) {
+    constexpr auto limit = static_cast<float>(std::int64_t{1} << 62);
+    Cell cell{};
+    for(std::size_t axis{}; axis < 3; ++axis) {
+        const auto coordinate = std::floor(component(position, axis) * inverse_cell_size);
+        cell[axis] = coordinate == coordinate ? static_cast<std::int64_t>(std::clamp(coordinate, -limit, limit)) : 0;
+    }
+    return cell;
+}
+
+std::uint32_t hash_cell(const Cell& cell) {
+    std::uint32_t hash{0x9e3779b9U};
+    for(const auto coordinate : cell) {
+        hash = mix(hash ^ static_cast<std::uint32_t>(coordinate));
+        hash = mix(hash ^ static_cast<std::uint32_t>(static_cast<std::uint64_t>(coordinate) >> 32));
+    }
+    return hash;
+}
+
+std::size_t bucket_of(const std::uint32_t hash) {
+    return hash >> (32 - BUCKET_BITS);
+}
+
+// Ranges a pass over the values is split into: one per VALUES_PER_TASK values at most, so that small meshes are welded
+// on the calling thread rather than paying for threads started by every attribute.
+std::size_t ranges_count_for(const std::size_t values_count, const std::size_t threads_count) {
+    return std::max<std::size_t>(std::min(threads_count, values_count / VALUES_PER_TASK), 1);
+}
+
+// Stable parallel counting sort of the value ids by bucket: every thread counts its range, the per (bucket, range)
+// offsets are prefix summed and every thread scatters its range again.
+template<typename HashFunction>
+void bucket_ids(const std::size_t values_count, HashFunction&& hash, const std::size_t threads_count,
+        std::vector<std::uint32_t>& bucket_starts, std::vector<std::uint32_t>& ids) {
+    const auto ranges_count = ranges_count_for(values_count, threads_count);
+    const auto range_size = (values_count + ranges_count - 1) / ranges_count;
+    std::vector<std::uint32_t> counts(ranges_count * BUCKETS_COUNT);
+    const auto for_each_range = [&](auto&& function) {
+        parallel_for(ranges_count, ranges_count, 1, [&](const std::size_t first_range, const std::size_t last_range) {
+            for(auto range = first_range; range < last_range; ++range) {
+                const auto end = std::min((range + 1) * range_size, values_count);
+                for(auto id = range * range_size; id < end; ++id) {
+                    function(range, static_cast<std::uint32_t>(id));
+                }
+            }
+        });
+    };
+    for_each_range([&](const std::size_t range, const std::uint32_t id) {
+        ++counts[range * BUCKETS_COUNT + bucket_of(hash(id))];
+    });
+    std::vector<std::uint32_t> offsets(ranges_count * BUCKETS_COUNT);
+    bucket_starts.assign(BUCKETS_COUNT + 1, 0);
+    std::uint32_t offset{};
+    for(std::size_t bucket{}; bucket < BUCKETS_COUNT; ++bucket) {
+        bucket_starts[bucket] = offset;
+        for(std::size_t range{}; range < ranges_count; ++range) {
+            offsets[range * BUCKETS_COUNT + bucket] = offset;
+            offset += counts[range * BUCKETS_COUNT + bucket];
+        }
+    }
+    bucket_starts[BUCKETS_COUNT] = offset;
+    ids.resize(values_count);
+    for_each_range([&](const std::size_t range, const std::uint32_t id) {
+        ids[offsets[range * BUCKETS_COUNT + bucket_of(hash(id))]++] = id;
+    });
+}
+
+std::size_t table_size_for(const std::size_t count) {
+    std::size_t size{1};
+    while(size < count * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+// Returns for every value the id of the first bitwise identical value.
+template<typename Value>
+std::vector<std::uint32_t> find_identical_values(const std::vector<Value>& values, const std::size_t threads_count) {
+    std::vector<std::uint32_t> bucket_starts{};
+    std::vector<std::uint32_t> ids{};
+    bucket_ids(values.size(), [&](const std::uint32_t id) { return hash_bits(values[id]); }, threads_count,
+            bucket_starts, ids);
+    std::vector<std::uint32_t> representatives(values.size());
+    const auto ranges_count = ranges_count_for(values.size(), threads_count);
+    parallel_for(ranges_count, BUCKETS_COUNT, 1, [&](const std::size_t first_bucket, const std::size_t last_bucket) {
+        std::vector<std::uint32_t> table{};
+        for(auto bucket = first_bucket; bucket < last_bucket; ++bucket) {
+            const auto count = bucket_starts[bucket + 1] - bucket_starts[bucket];
+            const auto mask = table_size_for(count) - 1;
+            table.assign(mask + 1, EMPTY_SLOT);
+            for(auto i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; ++i) {
+                const auto id = ids[i];
+                auto slot = hash_bits(values[id]) & mask;
+                while(table[slot] != EMPTY_SLOT && !same_bits(values[table[slot]], values[id])) {
+                    slot = (slot + 1) & mask;
+                }
+                if(table[slot] == EMPTY_SLOT) {
+                    table[slot] = id;
+                }
+                representatives[id] = table[slot];
+            }
+        }
+    });
+    return representatives;
+}
+
+// Returns for every position the id of the first position of its cluster, positions closer than epsilon belonging to
+// the same cluster. Cells are twice epsilon wide, so the positions close to a position lie in its own cell or in the
+// adjacent cells on the sides of the cell half it lies in, which makes eight cells to search per position.
+std::vector<std::uint32_t> find_close_positions(const std::vector<Vector3>& positions, const float epsilon,
+        const std::size_t threads_count) {
+    const auto inverse_cell_size = 0.5f / epsilon;
+    const auto cell = [&](const std::uint32_t id) { return cell_of(positions[id], inverse_cell_size); };
+    std::vector<std::uint32_t> bucket_starts{};
+    std::vector<std::uint32_t> ids{};
+    bucket_ids(positions.size(), [&](const std::uint32_t id) { return hash_cell(cell(id)); }, threads_count,
+            bucket_starts, ids);
+
+    // Within every bucket the ids are ordered by cell, and a per-bucket open addressing table maps every cell to the
+    // first of its ids. The tables of all buckets live in one array so that any thread can query any cell. Most of
+    // the searched cells are empty, so a bitmap of the occupied cell hashes, small enough to stay in cache, rejects
+    // them before any table lookup.
+    std::vector<std::size_t> table_starts(BUCKETS_COUNT + 1);
+    for(std::size_t bucket{}; bucket < BUCKETS_COUNT; ++bucket) {
+        table_starts[bucket + 1] = table_starts[bucket]
+                + table_size_for(bucket_starts[bucket + 1] - bucket_starts[bucket]);
+    }
+    std::vector<std::uint32_t> tables(table_starts.back(), EMPTY_SLOT);
+    const auto occupancy_mask = table_size_for(positions.size() * 4) - 1;
+    std::vector<std::uint8_t> occupancy((occupancy_mask + 1) / 8);
+    const auto occupancy_bit = [&](const std::uint32_t hash) { return mix(hash) & occupancy_mask; };
+    const auto ranges_count = ranges_count_for(positions.size(), threads_count);
+    parallel_for(ranges_count, BUCKETS_COUNT, 1, [&](const std::size_t first_bucket, const std::size_t last_bucket) {
+        std::vector<std::pair<Cell, std::uint32_t>> entries{};
+        for(auto bucket = first_bucket; bucket < last_bucket; ++bucket) {
+            entries.clear();
+            for(auto i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; ++i) {
+                entries.emplace_back(cell(ids[i]), ids[i]);
+            }
+            std::sort(entries.begin(), entries.end());
+            const auto table = tables.data() + table_starts[bucket];
+            const auto mask = table_starts[bucket + 1] - table_starts[bucket] - 1;
+            for(std::size_t entry{}; entry < entries.size(); ++entry) {
+                const auto i = bucket_starts[bucket] + static_cast<std::uint32_t>(entry);
+                ids[i] = entries[entry].second;
+                if(entry != 0 && entries[entry].first == entries[entry - 1].first) {
+                    continue;
+                }
+                auto slot = hash_cell(entries[entry].first) & mask;
+                while(table[slot] != EMPTY_SLOT) {
+                    slot = (slot + 1) & mask;
+                }
+                table[slot] = i;
+            }
+        }
+    });
+    for(std::uint32_t id{}; id < positions.size(); ++id) {
+        const auto bit = occupancy_bit(hash_cell(cell(id)));
+        occupancy[bit / 8] |= static_cast<std::uint8_t>(1 << bit % 8);
+    }
+
+    // Positions are visited cell by cell, so the position's own cell is the run of ids around it; only the seven
+    // adjacent cells need lookups.
+    const auto epsilon_squared = epsilon * epsilon;
+    const auto close = [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+        const auto offset = positions[lhs] - positions[rhs];
+        return dot(offset, offset) <= epsilon_squared;
+    };
+    std::vector<std::uint32_t> representatives(positions.size());
+    parallel_for(ranges_count, BUCKETS_COUNT, 1, [&](const std::size_t first_bucket, const std::size_t last_bucket) {
+        for(auto bucket = first_bucket; bucket < last_bucket; ++bucket) {
+            auto run_start = bucket_starts[bucket];
+            Cell center{};
+            for(auto i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; ++i) {
+                const auto id = ids[i];
+                const auto id_cell = cell(id);
+                if(i == bucket_starts[bucket] || id_cell != center) {
+                    run_start = i;
+                    center = id_cell;
+                }
+                auto closest = id;
+                for(auto j = run_start; j < i; ++j) {
+                    if(close(ids[j], id)) {
+                        closest = ids[j];
+                        break;
+                    }
+                }
+                Cell sides{};
+                for(std::size_t axis{}; axis < 3; ++axis) {
+                    const auto coordinate = component(positions[id], axis) * inverse_cell_size;
+                    sides[axis] = coordinate - std::floor(coordinate) < 0.5f ? -1 : 1;
+                }
+                for(std::size_t neighbour_index{1}; neighbour_index < 8; ++neighbour_index) {
+                    auto neighbour = center;
+                    for(std::size_t axis{}; axis < 3; ++axis) {
+                        neighbour[axis] += neighbour_index >> axis & 1 ? sides[axis] : 0;
+                    }
+                    const auto hash = hash_cell(neighbour);
+                    const auto bit = occupancy_bit(hash);
+                    if((occupancy[bit / 8] & 1 << bit % 8) == 0) {
+                        continue;
+                    }
+                    const auto neighbour_bucket = bucket_of(hash);
+                    const auto table = tables.data() + table_starts[neighbour_bucket];
+                    const auto mask = table_starts[neighbour_bucket + 1] - table_starts[neighbour_bucket] - 1;
+                    auto slot = hash & mask;
+                    while(table[slot] != EMPTY_SLOT && cell(ids[table[slot]]) != neighbour) {
+                        slot = (slot + 1) & mask;
+                    }
+                    if(table[slot] == EMPTY_SLOT) {
+                        continue;
+                    }
+                    for(auto j = table[slot]; j < bucket_starts[neighbour_bucket + 1] && ids[j] < closest
+                            && cell(ids[j]) == neighbour; ++j) {
+                        if(close(ids[j], id)) {
+                            closest = ids[j];
+                            break;
+                        }
+                    }
+                }
+                representatives[id] = closest;
+            }
+        }
+    });
+    // Every position points to an earlier (or the same) position, so one ascending pass resolves the chains.
+    for(std::size_t id{}; id < positions.size(); ++id) {
+        representatives[id] = representatives[representatives[id]];
+    }
+    return representatives;
+}
+
+// Keeps the values that are their own representative, in order, and rewrites the indices to the kept values.
+template<typename Value>
+void compact_values(std::vector<Value>& values, std::vector<std::uint32_t>& representatives,
+        std::vector<std::uint32_t>& indices, const std::size_t threads_count) {
+    std::vector<std::uint8_t> kept(values.size());
+    for(std::size_t id{}; id < values.size(); ++id) {
+        kept[id] = representatives[id] == id;
+    }
+    std::vector<std::uint32_t> new_ids{};
+    parallel_exclusive_scan(threads_count, kept, new_ids);
+    std::vector<Value> kept_values(new_ids.back());
+    parallel_for(threads_count, values.size(), VALUES_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto id = begin; id < end; ++id) {
+            if(kept[id]) {
+                kept_values[new_ids[id]] = values[id];
+            }
+        }
+    });
+    parallel_for(threads_count, values.size(), VALUES_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto id = begin; id < end; ++id) {
+            representatives[id] = new_ids[representatives[id]];
+        }
+    });
+    parallel_for(threads_count, indices.size(), VALUES_PER_TASK, [&](const std::size_t begin, const std::size_t end) {
+        for(auto i = begin; i < end; ++i) {
+            indices[i] = representatives[indices[i]];
+        }
+    });
+    values = std::move(kept_values);
+}
+
+template<typename Value>
+void weld_values(std::vector<Value>& values, std::vector<std::uint32_t>& indices, const std::size_t threads_count) {
+    auto representatives = find_identical_values(values, threads_count);
+    compact_values(values, representatives, indices, threads_count);
+}
+
+} // namespace
+
+void weld_mesh(Mesh& mesh, const float epsilon, const std::size_t threads_count) {
+    if(epsilon > 0.0f) {
+        auto representatives = find_close_positions(mesh.positions, epsilon, threads_count);
+        compact_values(mesh.positions, representatives, mesh.position_indices, threads_count);
+    } else {
+        weld_values(mesh.positions, mesh.position_indices, threads_count);
+    }
+    if(mesh.present_attributes & TEX_COORDS_PRESENT) {
+        weld_values(mesh.tex_coords, mesh.tex_coords_indices, threads_count);
+    }
+    if(mesh.present_attributes & NORMALS_PRESENT) {
+        weld_values(mesh.normals, mesh.normal_indices, threads_count);
+    }
+    if(mesh.present_attributes & COLORS_PRESENT) {
+        weld_values(mesh.colors, mesh.color_indices, threads_count);
+    }
+    if(mesh.present_attributes & TANGENTS_PRESENT) {
+        weld_values(mesh.tangents, mesh.tangent_indices, threads_count);
+    }
+}
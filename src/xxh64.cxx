@@ -0,0 +1,112 @@
+#include <xxh64.hxx>
+
+#include <cstring>
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+constexpr std::uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr std::uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+constexpr std::uint64_t PRIME4 = 0x85ebca77c2b2ae63ULL;
+constexpr std::uint64_t PRIME5 = 0x27d4eb2f165667c5ULL;
+
+std::uint64_t rotate_left(const std::uint64_t value, const int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+std::uint64_t read64(const unsigned char* data) {
+    std::uint64_t value{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint32_t read32(const unsigned char* data) {
+    std::uint32_t value{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint64_t round(std::uint64_t lane, const std::uint64_t input) {
+    lane += input * PRIME2;
+    return rotate_left(lane, 31) * PRIME1;
+}
+
+std::uint64_t merge_lane(const std::uint64_t hash, const std::uint64_t lane) {
+    return (hash ^ round(0, lane)) * PRIME1 + PRIME4;
+}
+
+void consume_stripes(std::array<std::uint64_t, 4>& lanes, const unsigned char* data, const std::size_t stripes_count) {
+    for(std::size_t stripe{}; stripe < stripes_count; ++stripe, data += 32) {
+        lanes[0] = round(lanes[0], read64(data));
+        lanes[1] = round(lanes[1], read64(data + 8));
+        lanes[2] = round(lanes[2], read64(data + 16));
+        lanes[3] = round(lanes[3], read64(data + 24));
+    }
+}
+
+} // namespace
+
+Xxh64::Xxh64(const std::uint64_t seed)
+        : seed{seed}, lanes{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1} {
+}
+
+void Xxh64::update(const void* data, const std::size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    auto remaining = size;
+    total_size += size;
+    if(pending_size != 0) {
+        const auto copied = std::min(remaining, pending.size() - pending_size);
+        std::memcpy(pending.data() + pending_size, bytes, copied);
+        pending_size += copied;
+        bytes += copied;
+        remaining -= copied;
+        if(pending_size < pending.size()) {
+            return;
+        }
+        consume_stripes(lanes, pending.data(), 1);
+        pending_size = 0;
+    }
+    consume_stripes(lanes, bytes, remaining / 32);
+    bytes += remaining / 32 * 32;
+    pending_size = remaining % 32;
+    std::memcpy(pending.data(), bytes, pending_size);
+}
+
+std::uint64_t Xxh64::digest() const {
+    std::uint64_t hash{};
+    if(total_size >= 32) {
+        hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12)
+                + rotate_left(lanes[3], 18);
+        for(const auto lane : lanes) {
+            hash = merge_lane(hash, lane);
+        }
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += total_size;
+    std::size_t i{};
+    for(; i + 8 <= pending_size; i += 8) {
+        hash = rotate_left(hash ^ round(0, read64(pending.data() + i)), 27) * PRIME1 + PRIME4;
+    }
+    if(i + 4 <= pending_size) {
+        hash = rotate_left(hash ^ (read32(pending.data() + i) * PRIME1), 23) * PRIME2 + PRIME3;
+        i += 4;
+    }
+    for(; i < pending_size; ++i) {
+        hash = rotate_left(hash ^ (pending[i] * PRIME5), 11) * PRIME1;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::uint64_t xxh64(const void* data, const std::size_t size, const std::uint64_t seed) {
+    Xxh64 hash{seed};
+    hash.update(data, size);
+    return hash.digest();
+}
@@ -0,0 +1,75 @@
+// The mesh count of an OBM file header is one byte: a scene of MAX_MESHES_COUNT geometries converts with that count,
+// and a scene of more fails with error 10 instead of writing a count that wrapped around, in core and out of core.
+// Run with meson test.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <string>
+
+#include <dae2obm.hxx>
+#include <out_of_core.hxx>
+
+namespace {
+
+// A scene of single-triangle geometries.
+std::string make_document(const std::size_t geometries_count) {
+    std::string document{"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<COLLADA>\n  <library_geometries>\n"};
+    for(std::size_t geometry{}; geometry < geometries_count; ++geometry) {
+        const auto id = "mesh" + std::to_string(geometry);
+        document += "    <geometry id=\"" + id + "\"><mesh>\n"
+                "      <source id=\"" + id + "-positions\"><float_array id=\"" + id + "-array\" count=\"9\">"
+                "0 0 0 1 0 0 0 1 0</float_array><technique_common><accessor source=\"#" + id + "-array\" count=\"3\""
+                " stride=\"3\"><param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/>"
+                "<param name=\"Z\" type=\"float\"/></accessor></technique_common></source>\n"
+                "      <vertices id=\"" + id + "-vertices\"><input semantic=\"POSITION\" source=\"#" + id
+                + "-positions\"/></vertices>\n"
+                "      <triangles count=\"1\"><input semantic=\"VERTEX\" source=\"#" + id + "-vertices\" offset=\"0\"/>"
+                "<p>0 1 2</p></triangles>\n    </mesh></geometry>\n";
+    }
+    document += "  </library_geometries>\n</COLLADA>\n";
+    return document;
+}
+
+bool check(const bool condition, const char* description) {
+    if(!condition) {
+        std::fprintf(stderr, "Failed: %s.\n", description);
+    }
+    return condition;
+}
+
+} // namespace
+
+int main() {
+    ConversionOptions options{};
+    options.messages = nullptr;
+    std::pmr::string obm_bytes{};
+    auto passed = true;
+
+    auto result = convert_buffer(make_document(MAX_MESHES_COUNT), obm_bytes, options);
+    passed &= check(result == 0, "a scene of MAX_MESHES_COUNT geometries converts");
+    passed &= check(obm_bytes.size() > 5 && obm_bytes.compare(0, 4, "OBMF") == 0
+            && static_cast<std::uint8_t>(obm_bytes[4]) == MAX_MESHES_COUNT, "its header counts every mesh");
+
+    result = convert_buffer(make_document(MAX_MESHES_COUNT + 45), obm_bytes, options);
+    passed &= check(result == 10, "a scene of more geometries fails with error 10");
+    passed &= check(obm_bytes.empty(), "it leaves no bytes");
+
+    // Out of core, the header is written after the geometries were streamed to the output.
+    namespace fs = std::filesystem;
+    const auto input_path = fs::temp_directory_path() / "dae2obm-meshes-count.dae";
+    const auto output_path = fs::temp_directory_path() / "dae2obm-meshes-count.obm";
+    options.max_memory = MIN_MAX_MEMORY;
+    std::ofstream{input_path, std::ios::binary} << make_document(MAX_MESHES_COUNT + 45);
+    result = convert(input_path.string(), output_path.string(), options);
+    passed &= check(result == 10, "a scene of more geometries fails with error 10 out of core");
+    passed &= check(!fs::exists(output_path), "it leaves no output file");
+    std::error_code error{};
+    fs::remove(input_path, error);
+    fs::remove(output_path, error);
+
+    return passed ? 0 : 1;
+}